@@ -11,6 +11,7 @@
 #include "calc_parse.h"
 #include "poly.h"
 #include "poly_lib.h"
+#include "poly_mul.h"
 #include "stack.h"
 #include <ctype.h>
 #include <limits.h>
@@ -59,6 +60,15 @@ void InstMul(Stack *s)
     }
 }
 
+void InstMulAdd(Stack *s)
+{
+    Poly *p_first = StackPop(s);
+    Poly *p_second = StackPop(s);
+    PolyMulAddTo(StackPeek(s), p_first, p_second);
+    PolyDestroy(p_first);
+    PolyDestroy(p_second);
+}
+
 void InstNeg(Stack *s) { PolyNegTo(StackPeek(s)); }
 
 void InstSub(Stack *s)
@@ -182,6 +192,13 @@ static bool RunInstruction(Stack *stack, const Instruction inst)
             else
                 return true;
         }
+        else if (STR_EQ(inst.type, MUL_ADD))
+        {
+            if (StackHasEnoughElements(stack, 3))
+                InstMulAdd(stack);
+            else
+                return true;
+        }
         else if (!StackIsAlmostEmpty(stack))
         {
             if (STR_EQ(inst.type, ADD))
@@ -273,6 +290,9 @@ bool ParseAndExecuteLine(Stack *stack, size_t index)
     return c == '\n';
 }
 
+// testy biblioteki dołączają kalkulator bez jego funkcji main
+#ifndef CALC_NO_MAIN
+
 /**
  * Uruchamia kalkulator wielomianów
  * @return kod wyścia programu
@@ -288,4 +308,6 @@ int main(void)
     StackDestroy(&stack);
 
     return 0;
-}
\ No newline at end of file
+}
+
+#endif
@@ -65,6 +65,14 @@ void InstAdd(Stack *s);
  */
 void InstMul(Stack *s);
 
+/**
+ * Wykonuje instrukcję MUL_ADD, czyli bierze dwa wielomiany z wierzchołka stosu
+ * @p s i dodaje ich iloczyn do trzeciego wielomianu, który zostaje na
+ * wierzchołku. Działa jak MUL, a po nim ADD, ale nie tworzy iloczynu.
+ * @param[in,out] s : stos wielomianów
+ */
+void InstMulAdd(Stack *s);
+
 /**
  * Wykonuje instrukcję NEG, czyli neguje wielomianu z wierzchołka stosu @p s.
  * @param[in,out] s : stos wielomianów
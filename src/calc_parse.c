@@ -9,6 +9,7 @@
 
 #include "calc_parse.h"
 #include "poly.h"
+#include "poly_alloc.h"
 #include "poly_lib.h"
 #include <ctype.h>
 #include <limits.h>
@@ -30,11 +31,12 @@
     (Instruction) { .type = ERROR_TYPE, .x = 0 }
 
 /** liczba operacji bezparametrowych */
-#define INST_NO_ARG_SIZE 12
+#define INST_NO_ARG_SIZE 13
 
 /** lista nazw instrukcji bez parametrów */
 static const char *INST_NO_ARG_LIST[] = {
-    ZERO, IS_COEFF, IS_ZERO, CLONE, ADD, MUL, NEG, SUB, IS_EQ, DEG, PRINT, POP};
+    ZERO, IS_COEFF, IS_ZERO, CLONE, ADD, MUL, MUL_ADD, NEG, SUB, IS_EQ, DEG,
+    PRINT, POP};
 
 /** znak minusa */
 #define MINUS '-'
@@ -285,9 +287,8 @@ static size_t ParseMonos(ParsingStatus *status, Mono **monos)
             monos_cnt++;
             if (monos_cnt > monos_max)
             {
+                *monos = MonosRealloc(*monos, monos_max * MEM_SIZE_MULT);
                 monos_max *= MEM_SIZE_MULT;
-                *monos = realloc(*monos, monos_max * sizeof(Mono));
-                CHECK_PTR(*monos);
             }
             ParseMono(status, *monos + monos_cnt - 1);
             if (!status->is_correct)
@@ -297,7 +298,7 @@ static size_t ParseMonos(ParsingStatus *status, Mono **monos)
                 for (size_t i = 0; i < monos_cnt - 1; i++)
                     MonoDestroy(*monos + i);
 
-                free(*monos);
+                MonosFree(*monos);
                 return 0;
             }
         }
@@ -336,8 +337,7 @@ static void ParsePolyNonCoeff(ParsingStatus *status, bool is_in_mono, Poly *p)
         if (!status->is_correct)
             return;
 
-        Mono *monos = malloc(INIT_SIZE * sizeof(Mono));
-        CHECK_PTR(monos);
+        Mono *monos = MonosAlloc(INIT_SIZE);
         monos[0] = first_mono;
 
         size_t monos_cnt = ParseMonos(status, &monos);
@@ -364,11 +364,11 @@ static void ParsePolyNonCoeff(ParsingStatus *status, bool is_in_mono, Poly *p)
             for (size_t i = 0; i < monos_cnt; i++)
                 MonoDestroy(&monos[i]);
 
-            free(monos);
+            MonosFree(monos);
             return;
         }
 
-        *p = PolyOwnMonos(monos_cnt, monos);
+        *p = PolyOwnMonosArray(monos_cnt, monos);
     }
 }
 
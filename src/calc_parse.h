@@ -59,6 +59,8 @@
 #define ADD "ADD"
 /** Nazwa instrukcji MUL */
 #define MUL "MUL"
+/** Nazwa instrukcji MUL_ADD */
+#define MUL_ADD "MUL_ADD"
 /** Nazwa instrukcji SUB */
 #define SUB "SUB"
 /** Nazwa instrukcji IS_EQ */
@@ -9,19 +9,25 @@
 
 #include "poly.h"
 #include "calc.h"
+#include "poly_acc.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
 #include "poly_lib.h"
+#include "poly_mul.h"
+#include "poly_overflow.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
 void PolyDestroy(Poly *p)
 {
-    if (!PolyIsCoeff(p))
+    // jednomiany są usuwane razem z ostatnim odwołaniem do tablicy
+    if (!PolyIsCoeff(p) && MonosRelease(p->arr))
     {
         for (size_t i = 0; i < p->size; i++)
             MonoDestroy(&(p->arr[i]));
 
-        free(p->arr);
+        MonosFree(p->arr);
     }
 }
 
@@ -30,12 +36,15 @@ Poly PolyClone(const Poly *p)
     if (PolyIsCoeff(p))
         return PolyFromCoeff(p->coeff);
 
+    // tablica jest kopiowana dopiero przy modyfikacji (::PolyMakeUnique),
+    // a tablice pożyczone z areny są kopiowane od razu
+    if (MonosRetain(p->arr))
+        return *p;
+
     Poly cloned_p;
 
     cloned_p.size = p->size;
-    cloned_p.max_size = p->max_size;
-    cloned_p.arr = malloc(cloned_p.max_size * sizeof(Mono));
-    CHECK_PTR(cloned_p.arr);
+    cloned_p.arr = MonosAlloc(MonosCapacity(p->arr));
 
     for (size_t i = 0; i < p->size; i++)
         cloned_p.arr[i] = MonoClone(&p->arr[i]);
@@ -74,27 +83,45 @@ bool PolyIsEq(const Poly *p, const Poly *q)
     if (is_p_coeff) // obydwa są coeffami
         return p->coeff == q->coeff;
 
+    // współdzielona tablica
+    if (p->arr == q->arr && p->size == q->size)
+        return true;
+
+    // równe internowane wielomiany mają tę samą tablicę
+    if (MonosIsInterned(p->arr) && MonosIsInterned(q->arr))
+        return false;
+
     // obydwa nie są coeffami
-    if (p->size == q->size)
+    if (p->size != q->size)
+        return false;
+
+    // różne metadane wykluczają równość bez przechodzenia drzew, a równe
+    // mogą wynikać z kolizji skrótów
+    const PolyMeta *p_meta = PolyGetMeta(p);
+    const PolyMeta *q_meta = PolyGetMeta(q);
+    if (p_meta != NULL && q_meta != NULL &&
+        (p_meta->hash != q_meta->hash || p_meta->terms != q_meta->terms))
+        return false;
+
+    for (size_t i = 0; i < p->size; i++)
     {
-        bool is_eq = true;
-        for (size_t i = 0; i < p->size; i++)
-        {
-            if (p->arr[i].exp == q->arr[i].exp)
-                is_eq &= PolyIsEq(&p->arr[i].p, &q->arr[i].p);
-            else
-                return false;
-        }
-        return is_eq;
+        if (p->arr[i].exp != q->arr[i].exp ||
+            !PolyIsEq(&p->arr[i].p, &q->arr[i].p))
+            return false;
     }
 
-    return false;
+    return true;
 }
 
 poly_exp_t PolyDegBy(const Poly *p, size_t var_idx)
 {
     if (PolyIsZero(p))
         return -1;
+
+    const PolyMeta *meta = PolyGetMeta(p);
+    if (meta != NULL)
+        return var_idx < meta->vars ? meta->degs[var_idx] : 0;
+
     poly_exp_t max_exp = 0;
     PolyDegByHelp(p, var_idx, 0, &max_exp);
     return max_exp;
@@ -104,6 +131,11 @@ poly_exp_t PolyDeg(const Poly *p)
 {
     if (PolyIsZero(p))
         return -1;
+
+    const PolyMeta *meta = PolyGetMeta(p);
+    if (meta != NULL)
+        return meta->deg;
+
     poly_exp_t max_exp = 0;
     PolyDegHelp(p, &max_exp, 0);
     return max_exp;
@@ -119,8 +151,7 @@ poly_exp_t PolyDeg(const Poly *p)
  */
 static Mono *MonosCopyArray(size_t count, const Mono monos[], bool is_deep)
 {
-    Mono *monos_copy = malloc(count * sizeof(Mono));
-    CHECK_PTR(monos_copy);
+    Mono *monos_copy = MonosAlloc(count);
 
     for (size_t i = 0; i < count; i++)
     {
@@ -138,7 +169,7 @@ Poly PolyAddMonos(size_t count, const Mono monos[])
     if (count == 0 || monos == NULL)
         return PolyZero();
 
-    return PolyOwnMonos(count, MonosCopyArray(count, monos, false));
+    return PolyOwnMonosArray(count, MonosCopyArray(count, monos, false));
 }
 
 Poly PolyOwnMonos(size_t count, Mono *monos)
@@ -146,16 +177,34 @@ Poly PolyOwnMonos(size_t count, Mono *monos)
     if (count == 0)
     {
         if (monos != NULL)
-            free(monos);
+            PolyFree(monos);
         
         return PolyZero();
     }
     if (monos == NULL)
         return PolyZero();
 
-    MonosSort(monos, count);
+    // tablica przekazana przez użytkownika nie ma nagłówka z licznikiem
+    // odwołań, więc jednomiany są przenoszone do nowej tablicy
+    Mono *monos_copy = MonosCopyArray(count, monos, false);
+    PolyFree(monos);
 
-    return PolyFromMonos(count, monos);
+    return PolyOwnMonosArray(count, monos_copy);
+}
+
+Mono *PolyMallocMonos(size_t count)
+{
+    return MonosAlloc(count > 0 ? count : 1);
+}
+
+void PolyFreeMonos(Mono *monos) { MonosFree(monos); }
+
+Poly PolyAdoptMonos(size_t count, Mono *monos)
+{
+    if (monos == NULL)
+        return PolyZero();
+
+    return PolyOwnMonosArray(count, monos);
 }
 
 Poly PolyCloneMonos(size_t count, const Mono monos[])
@@ -163,7 +212,7 @@ Poly PolyCloneMonos(size_t count, const Mono monos[])
     if (count == 0 || monos == NULL)
         return PolyZero();
 
-    return PolyOwnMonos(count, MonosCopyArray(count, monos, true));
+    return PolyOwnMonosArray(count, MonosCopyArray(count, monos, true));
 }
 
 Poly PolyMul(const Poly *p, const Poly *q)
@@ -174,15 +223,48 @@ Poly PolyMul(const Poly *p, const Poly *q)
     if (PolyIsCoeff(q))
         return PolyMulByCoeff(p, q->coeff);
 
-    size_t monos_size = p->size * q->size;
-    Mono *monos = malloc(monos_size * sizeof(Mono));
-    CHECK_PTR(monos);
+    if (p == q)
+        return PolySqr(p);
+
+    // oszacowanie wyklucza przepełnienia także w iloczynach i sumach
+    // współczynników, więc jest wyznaczane raz, a cały iloczyn jest liczony
+    // bez sprawdzania (::PolyMulFastIsSafe)
+    if (PolyOverflowIsChecked() && PolyMulFastIsSafe(p, q))
+    {
+        bool was_safe = PolyOverflowSetProvenSafe(true);
+        Poly res_poly = PolyMul(p, q);
+        PolyOverflowSetProvenSafe(was_safe);
+
+        return res_poly;
+    }
+
+    // szybkie algorytmy nie wykrywają przepełnień
+    bool is_checked = PolyOverflowIsChecked();
+    if (!is_checked && PolyMulKroneckerIsWorth(p, q))
+        return PolyMulKronecker(p, q);
+
+    if (!is_checked && PolyMulParallelIsWorth(p, q))
+        return PolyMulParallel(p, q);
+
+    if (!is_checked && PolyIsDense(p) && PolyIsDense(q))
+        return PolyMulDense(p, q);
+
+    if ((size_t)p->size * q->size >= MUL_HEAP_MIN_PRODUCTS)
+        return PolyMulHeap(p, q);
+
+    size_t monos_size = (size_t)p->size * q->size;
+    Mono *monos = MonosAlloc(monos_size);
 
     for (size_t i = 0; i < p->size; i++)
         for (size_t j = 0; j < q->size; j++)
-            monos[i * q->size + j] = MonoMul(&p->arr[i], &q->arr[j]);
+            monos[i * q->size + j] =
+                (Mono){.exp = is_checked
+                                  ? ExpAdd(p->arr[i].exp, q->arr[j].exp)
+                                  : ExpAddUnchecked(p->arr[i].exp,
+                                                    q->arr[j].exp),
+                       .p = PolyMul(&p->arr[i].p, &q->arr[j].p)};
 
-    Poly res_poly = PolyOwnMonos(monos_size, monos);
+    Poly res_poly = PolyOwnMonosArray(monos_size, monos);
 
     return res_poly;
 }
@@ -192,36 +274,128 @@ Poly PolyAt(const Poly *p, poly_coeff_t x)
     if (PolyIsCoeff(p))
         return PolyClone(p);
 
-    Poly *polies = malloc(p->size * sizeof(Poly));
-    CHECK_PTR(polies);
+    PolyAccumulator acc = PolyAccumulatorNew();
+    bool is_checked = PolyOverflowIsChecked();
 
     for (size_t i = 0; i < p->size; i++)
-        polies[i] = PolyMulByCoeff(&p->arr[i].p, Power(x, p->arr[i].exp));
+    {
+        poly_coeff_t x_pow = is_checked ? PowerChecked(x, p->arr[i].exp)
+                                        : Power(x, p->arr[i].exp);
+        const Poly *coeff = &p->arr[i].p;
+        if (PolyIsCoeff(coeff))
+        {
+            poly_coeff_t c = is_checked
+                                 ? CoeffMul(coeff->coeff, x_pow)
+                                 : CoeffMulUnchecked(coeff->coeff, x_pow);
+            PolyAccumulatorAdd(&acc, PolyFromCoeff(c));
+            continue;
+        }
 
-    for (size_t i = 1; i < p->size; i++)
-        PolyAddTo(&polies[0], &polies[i]);
+        // jednomiany współczynnika trafiają do akumulatora bezpośrednio,
+        // bez przejściowej tablicy iloczynu współczynnika przez x_pow
+        for (size_t j = 0; j < coeff->size; j++)
+            PolyAccumulatorAddMono(
+                &acc, (Mono){.p = PolyMulByCoeff(&coeff->arr[j].p, x_pow),
+                             .exp = coeff->arr[j].exp});
+    }
 
-    Poly res_poly = polies[0];
+    return PolyAccumulatorFinalize(&acc);
+}
 
-    for (size_t i = 1; i < p->size; i++)
-        PolyDestroy(&polies[i]);
+/**
+ * Wylicza wartość wielomianu @f$p@f$, którego zmienne mają indeksy od
+ * @p idx (::PolyEval).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w @p x
+ * @param[in] x : wartości kolejnych zmiennych
+ * @param[in] idx : indeks zmiennej wielomianu @f$p@f$
+ * @return wartość wielomianu @f$p@f$
+ */
+static poly_coeff_t PolyEvalHelp(const Poly *p, size_t k,
+                                 const poly_coeff_t x[], size_t idx)
+{
+    if (PolyIsCoeff(p))
+        return p->coeff;
+
+    // zmienna bez wartości jest zerem
+    poly_coeff_t x_val = idx < k ? x[idx] : 0;
+
+    // jednomiany są przeglądane od najmniejszego wykładnika, a potęga x jest
+    // domnażana o różnicę kolejnych wykładników; jeśli się wyzeruje (modulo
+    // 2^64), wyższe potęgi też są zerami i pozostałe poddrzewa są pomijane;
+    // liczby bez znaku mają zdefiniowane przepełnienie
+    unsigned long res = 0;
+    unsigned long x_pow = 1;
+    poly_exp_t prev_exp = 0;
+    for (size_t i = p->size; i-- > 0;)
+    {
+        x_pow *= (unsigned long)Power(x_val, p->arr[i].exp - prev_exp);
+        if (x_pow == 0)
+            break;
 
-    free(polies);
+        res += x_pow * (unsigned long)PolyEvalHelp(&p->arr[i].p, k, x, idx + 1);
+        prev_exp = p->arr[i].exp;
+    }
 
-    return res_poly;
+    return (poly_coeff_t)res;
+}
+
+/**
+ * Wylicza wartość wielomianu @f$p@f$ tak jak ::PolyEvalHelp, zgłaszając
+ * przepełnienia (::PolyOverflowReport).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w @p x
+ * @param[in] x : wartości kolejnych zmiennych
+ * @param[in] idx : indeks zmiennej wielomianu @f$p@f$
+ * @return wartość wielomianu @f$p@f$
+ */
+static poly_coeff_t PolyEvalCheckedHelp(const Poly *p, size_t k,
+                                        const poly_coeff_t x[], size_t idx)
+{
+    if (PolyIsCoeff(p))
+        return p->coeff;
+
+    poly_coeff_t x_val = idx < k ? x[idx] : 0;
+
+    poly_coeff_t res = 0;
+    poly_coeff_t x_pow = 1;
+    poly_exp_t prev_exp = 0;
+    for (size_t i = p->size; i-- > 0;)
+    {
+        x_pow = CoeffMul(x_pow, PowerChecked(x_val, p->arr[i].exp - prev_exp));
+        if (x_pow == 0)
+            break;
+
+        poly_coeff_t val = PolyEvalCheckedHelp(&p->arr[i].p, k, x, idx + 1);
+        res = CoeffAdd(res, CoeffMul(x_pow, val));
+        prev_exp = p->arr[i].exp;
+    }
+
+    return res;
+}
+
+poly_coeff_t PolyEval(const Poly *p, size_t k, const poly_coeff_t x[])
+{
+    assert(p != NULL && (k == 0 || x != NULL));
+
+    // bez sprawdzania przepełnień pętla nie rozgałęzia się na nich
+    if (PolyOverflowIsChecked())
+        return PolyEvalCheckedHelp(p, k, x, 0);
+
+    return PolyEvalHelp(p, k, x, 0);
 }
 
 Poly PolyCompose(const Poly *p, size_t k, const Poly q[])
 {
     Poly res_poly = PolyClone(p);
-    Poly *q_copy = malloc(k * sizeof(Poly));
-    CHECK_PTR(q_copy);
+    PolyArenaMark mark = PolyScratchMark();
+    Poly *q_copy = PolyArenaAlloc(PolyScratch(), k * sizeof(Poly));
     for (size_t i = 0; i < k; i++)
         q_copy[i] = PolyClone(&q[i]);
 
     PolyComposeTo(&res_poly, k, q_copy);
 
-    free(q_copy);
+    PolyScratchRelease(mark);
 
     return res_poly;
 }
\ No newline at end of file
@@ -12,6 +12,8 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /** Minimalna alokowana pamięć. */
@@ -31,28 +33,41 @@ struct Mono;
 /**
  * To jest struktura przechowująca wielomian.
  * Wielomian jest albo liczbą całkowitą, czyli wielomianem stałym
- * (wtedy `arr == NULL`), albo niepustą listą jednomianów (wtedy `arr != NULL`).
+ * (wtedy `size == 0`), albo niepustą listą jednomianów (wtedy `size > 0`).
+ * Struktura jest upakowana do 12 bajtów, więc jednomian zajmuje 16 bajtów,
+ * a pojemność tablicy jednomianów jest zapisana w jej nagłówku.
+ *
+ * Zmienia to ABI względem wcześniejszych wersji: pole `max_size` zostało
+ * usunięte (pojemność zwraca ::MonosCapacity), `size` ma 32 bity, więc
+ * tablica mieści najwyżej @f$2^{32}-1@f$ jednomianów, a współczynnik nie
+ * jest już oznaczany przez `arr == NULL`, tylko przez `size == 0`
+ * (::PolyIsCoeff). Kod korzystający z tych pól trzeba przekompilować.
+ *
+ * Upakowany jest sam wielomian, nie jednomian: wielomian wyrównany
+ * naturalnie zajmowałby 16 bajtów, a jednomian 24. W tablicy jednomianów
+ * wskaźnik `arr` leży pod adresem podzielnym przez 8, bo jednomian ma 16
+ * bajtów, a nagłówek tablicy zachowuje wyrównanie. Rozmiary i położenie pól
+ * sprawdzają asercje statyczne pod definicją ::Mono.
  */
+#pragma pack(push, 4)
 typedef struct Poly
 {
     /**
      * To jest unia przechowująca współczynnik wielomianu lub
-     * liczbę jednomianów w wielomianie.
-     * Jeżeli `arr == NULL`, wtedy jest to współczynnik będący liczbą całkowitą.
+     * tablicę jego jednomianów.
+     * Jeżeli `size == 0`, wtedy jest to współczynnik będący liczbą całkowitą.
      * W przeciwnym przypadku jest to niepusta lista jednomianów.
      */
     union
     {
         poly_coeff_t coeff; ///< współczynnik
-        size_t size;        ///< rozmiar wielomianu, liczba jednomianów
+        struct Mono *arr;   ///< tablica przechowująca listę jednomianów
     };
 
-    /** ilość zaalokowanej pamięci */
-    size_t max_size;
-
-    /** To jest tablica przechowująca listę jednomianów. */
-    struct Mono *arr;
+    /** rozmiar wielomianu, liczba jednomianów; 0 dla współczynnika */
+    uint32_t size;
 } Poly;
+#pragma pack(pop)
 
 /**
  * To jest struktura przechowująca jednomian.
@@ -66,6 +81,12 @@ typedef struct Mono
     poly_exp_t exp; ///< wykładnik
 } Mono;
 
+static_assert(sizeof(Poly) == 12, "wielomian musi zajmować 12 bajtów");
+static_assert(offsetof(Poly, size) == 8, "rozmiar musi leżeć za unią");
+static_assert(sizeof(Mono) == 16, "jednomian musi zajmować 16 bajtów");
+static_assert(offsetof(Mono, p) == 0 && offsetof(Mono, exp) == 12,
+              "wykładnik musi leżeć za współczynnikiem jednomianu");
+
 /**
  * Daje wartość wykładnika jendomianu.
  * @param[in] m : jednomian
@@ -80,7 +101,7 @@ static inline poly_exp_t MonoGetExp(const Mono *m) { return m->exp; }
  */
 static inline Poly PolyFromCoeff(poly_coeff_t c)
 {
-    return (Poly){.coeff = c, .max_size = INIT_SIZE, .arr = NULL};
+    return (Poly){.coeff = c, .size = 0};
 }
 
 /**
@@ -112,7 +133,7 @@ static inline Mono MonoFromPoly(const Poly *p, poly_exp_t n)
 static inline bool PolyIsCoeff(const Poly *p)
 {
     assert(p != NULL);
-    return p->arr == NULL;
+    return p->size == 0;
 }
 
 /**
@@ -139,14 +160,17 @@ void PolyDestroy(Poly *p);
 static inline void MonoDestroy(Mono *m) { PolyDestroy(&m->p); }
 
 /**
- * Robi pełną, głęboką kopię wielomianu.
+ * Robi kopię wielomianu w czasie @f$\mathrm{O}(1)@f$: kopia współdzieli
+ * tablicę jednomianów z oryginałem, a funkcje modyfikujące wielomian w miejscu
+ * kopiują tylko te tablice, które zmieniają. Kopia wielomianu z areny
+ * (::PolyCloneInto) jest głęboka.
  * @param[in] p : wielomian
  * @return skopiowany wielomian
  */
 Poly PolyClone(const Poly *p);
 
 /**
- * Robi pełną, głęboką kopię jednomianu.
+ * Robi kopię jednomianu tak jak ::PolyClone.
  * @param[in] m : jednomian
  * @return skopiowany jednomian
  */
@@ -176,14 +200,49 @@ Poly PolyAddMonos(size_t count, const Mono monos[]);
  * Sumuje listę jednomianów i tworzy z nich wielomian. Przejmuje na własność
  * pamięć wskazywaną przez @p monos i jej zawartość. Może dowolnie modyfikować
  * zawartość tej pamięci. Zakładamy, że pamięć wskazywana przez @p monos
- * została zaalokowana na stercie. Jeśli @p count lub @p monos jest równe zeru
+ * została zaalokowana funkcją ::PolyMalloc (przy domyślnym alokatorze może
+ * to być też malloc). Jeśli @p count lub @p monos jest równe zeru
  * (NULL), tworzy wielomian tożsamościowo równy zeru.
+ *
+ * Taka tablica nie ma nagłówka z licznikiem odwołań, więc jednomiany są
+ * przenoszone do nowej tablicy, a @p monos jest zwalniana. Kosztuje to
+ * dodatkowy czas @f$O(\mathrm{count})@f$ i chwilowo dwa razy więcej pamięci.
+ * Tablicę przydzieloną funkcją ::PolyMallocMonos przejmuje bez kopiowania
+ * funkcja ::PolyAdoptMonos.
  * @param[in] count : liczba jednomianów
  * @param[in] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów
  */
 Poly PolyOwnMonos(size_t count, Mono *monos);
 
+/**
+ * Przydziela tablicę @p count jednomianów z nagłówkiem, w którym jest licznik
+ * odwołań. Tablicę wypełnia wywołujący i przekazuje ją funkcji
+ * ::PolyAdoptMonos. Nieprzekazaną tablicę zwalnia się funkcją
+ * ::PolyFreeMonos.
+ * @param[in] count : liczba jednomianów
+ * @return niewypełniona tablica jednomianów
+ */
+Mono *PolyMallocMonos(size_t count);
+
+/**
+ * Zwalnia tablicę przydzieloną funkcją ::PolyMallocMonos. Jednomiany nie są
+ * usuwane.
+ * @param[in] monos : tablica jednomianów albo NULL
+ */
+void PolyFreeMonos(Mono *monos);
+
+/**
+ * Sumuje listę jednomianów i tworzy z nich wielomian tak jak ::PolyOwnMonos,
+ * ale tablica @p monos musi pochodzić z ::PolyMallocMonos. Wielomian używa
+ * tej tablicy, więc nic nie jest kopiowane. Jeśli @p count lub @p monos jest
+ * równe zeru (NULL), tworzy wielomian tożsamościowo równy zeru.
+ * @param[in] count : liczba jednomianów, co najwyżej tyle, ile przydzielono
+ * @param[in] monos : tablica jednomianów
+ * @return wielomian będący sumą jednomianów
+ */
+Poly PolyAdoptMonos(size_t count, Mono *monos);
+
 /**
  * Sumuje listę jednomianów i tworzy z nich wielomian. Nie modyfikuje zawartości
  * tablicy @p monos. Jeśli jest to wymagane, to wykonuje pełne kopie jednomianów
@@ -223,7 +282,9 @@ Poly PolySub(const Poly *p, const Poly *q);
  * tożsamościowo równego zeru). Zmienne indeksowane są od 0.
  * Zmienna o indeksie 0 oznacza zmienną główną tego wielomianu.
  * Większe indeksy oznaczają zmienne wielomianów znajdujących się
- * we współczynnikach.
+ * we współczynnikach. Stopnie są zapamiętywane w metadanych wielomianu, więc
+ * kolejne wywołania dla niezmienionego wielomianu działają w czasie
+ * @f$\mathrm{O}(1)@f$.
  * @param[in] p : wielomian
  * @param[in] var_idx : indeks zmiennej
  * @return stopień wielomianu @p p z względu na zmienną o indeksie @p var_idx
@@ -232,13 +293,17 @@ poly_exp_t PolyDegBy(const Poly *p, size_t var_idx);
 
 /**
  * Zwraca stopień wielomianu (-1 dla wielomianu tożsamościowo równego zeru).
+ * Kolejne wywołania dla niezmienionego wielomianu działają w czasie
+ * @f$\mathrm{O}(1)@f$.
  * @param[in] p : wielomian
  * @return stopień wielomianu @p p
  */
 poly_exp_t PolyDeg(const Poly *p);
 
 /**
- * Sprawdza równość dwóch wielomianów.
+ * Sprawdza równość dwóch wielomianów. Wielomiany o różnych skrótach
+ * struktury zapamiętanych w metadanych są odrzucane w czasie
+ * @f$\mathrm{O}(1)@f$.
  * @param[in] p : wielomian @f$p@f$
  * @param[in] q : wielomian @f$q@f$
  * @return @f$p = q@f$
@@ -258,6 +323,21 @@ bool PolyIsEq(const Poly *p, const Poly *q);
  */
 Poly PolyAt(const Poly *p, poly_coeff_t x);
 
+/**
+ * Wylicza wartość liczbową wielomianu w punkcie @p x. Wstawia pod zmienne
+ * @f$x_0, \ldots, x_{k-1}@f$ wartości z tablicy @p x, a pod pozostałe
+ * zmienne zero, tak jak ::PolyCompose. Przechodzi drzewo wielomianu raz,
+ * potęgując wartości zmiennych przez różnice kolejnych wykładników, i nie
+ * przydziela pamięci. Poddrzewa mnożone przez potęgę równą zero są
+ * pomijane. Działa w czasie liniowym względem liczby jednomianów w drzewie,
+ * pomnożonej przez logarytm największej różnicy wykładników.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w @p x
+ * @param[in] x : wartości kolejnych zmiennych
+ * @return @f$p(x_0, \ldots, x_{k-1}, 0, \ldots)@f$
+ */
+poly_coeff_t PolyEval(const Poly *p, size_t k, const poly_coeff_t x[]);
+
 /**
  * Tworzy wielomian będący złożeniem wielomianu @f$p@f$ i wielomianów z tablicy
  * @p q. Oznacza to, że podstawia pod kolejne zmienne wielomianu @f$p@f$ kolejne
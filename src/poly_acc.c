@@ -0,0 +1,188 @@
+/** @file
+  Implementacja akumulatora sum wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_acc.h"
+#include "poly.h"
+#include "poly_alloc.h"
+#include "poly_lib.h"
+#include "poly_overflow.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+PolyAccumulator PolyAccumulatorNew(void)
+{
+    return (PolyAccumulator){.arr = NULL, .size = 0, .max_size = 0};
+}
+
+void PolyAccumulatorAddMono(PolyAccumulator *acc, Mono m)
+{
+    assert(acc != NULL);
+
+    if (PolyIsZero(&m.p))
+        return;
+
+    if (acc->size == acc->max_size)
+    {
+        size_t max_size =
+            acc->max_size == 0 ? INIT_SIZE : acc->max_size * MEM_SIZE_MULT;
+        acc->arr = MonosRealloc(acc->arr, max_size);
+        acc->max_size = max_size;
+    }
+
+    acc->arr[acc->size++] = m;
+}
+
+void PolyAccumulatorAdd(PolyAccumulator *acc, Poly p)
+{
+    assert(acc != NULL);
+
+    if (PolyIsCoeff(&p))
+    {
+        PolyAccumulatorAddMono(acc, (Mono){.p = p, .exp = 0});
+        return;
+    }
+
+    // jednomiany współdzielonej tablicy są kopiowane, a tablicę zwalnia
+    // ostatni właściciel
+    if (MonosIsShared(p.arr))
+    {
+        for (size_t i = 0; i < p.size; i++)
+            PolyAccumulatorAddMono(acc, MonoClone(&p.arr[i]));
+
+        PolyDestroy(&p);
+        return;
+    }
+
+    for (size_t i = 0; i < p.size; i++)
+        PolyAccumulatorAddMono(acc, p.arr[i]);
+
+    MonosFree(p.arr);
+}
+
+static Poly AccumulatorSum(PolyAccumulator *acc);
+
+/**
+ * Sumuje współczynniki jednomianów z tablicy @p monos, które mają ten sam
+ * wykładnik. Przejmuje na własność zawartość jednomianów.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ * @return suma współczynników jednomianów
+ */
+static Poly MonosSumCoeffs(size_t count, Mono *monos)
+{
+    bool are_coeffs = true;
+    for (size_t i = 0; i < count && are_coeffs; i++)
+        are_coeffs = PolyIsCoeff(&monos[i].p);
+
+    if (are_coeffs)
+    {
+        poly_coeff_t sum = 0;
+        if (PolyOverflowIsChecked())
+            for (size_t i = 0; i < count; i++)
+                sum = CoeffAdd(sum, monos[i].p.coeff);
+        else
+            for (size_t i = 0; i < count; i++)
+                sum = CoeffAddUnchecked(sum, monos[i].p.coeff);
+
+        return PolyFromCoeff(sum);
+    }
+
+    // współczynniki są wielomianami kolejnej zmiennej, więc sumuję je
+    // rekurencyjnie kolejnym akumulatorem
+    PolyAccumulator coeff_acc = PolyAccumulatorNew();
+    for (size_t i = 0; i < count; i++)
+        PolyAccumulatorAdd(&coeff_acc, monos[i].p);
+
+    return AccumulatorSum(&coeff_acc);
+}
+
+/**
+ * Wyznacza sumę jednomianów z akumulatora @p acc. Sortuje jednomiany, a
+ * współczynniki jednomianów o równych wykładnikach sumuje funkcją
+ * ::MonosSumCoeffs. Wynik zapisuje w tablicy akumulatora, zmniejszonej do
+ * pojemności ::PolyRequiredSize wyniku.
+ * @param[in,out] acc : akumulator
+ * @return suma jednomianów w postaci uproszczonej
+ */
+static Poly AccumulatorSum(PolyAccumulator *acc)
+{
+    if (acc->size == 0)
+    {
+        MonosFree(acc->arr);
+        return PolyZero();
+    }
+
+    MonosSort(acc->arr, acc->size);
+
+    size_t res_size = 0;
+    size_t group_start = 0;
+    while (group_start < acc->size)
+    {
+        size_t group_end = group_start + 1;
+        while (group_end < acc->size &&
+               acc->arr[group_end].exp == acc->arr[group_start].exp)
+            group_end++;
+
+        Mono m = acc->arr[group_start];
+        if (group_end - group_start > 1)
+            m.p = MonosSumCoeffs(group_end - group_start,
+                                 acc->arr + group_start);
+
+        if (!PolyIsZero(&m.p))
+            acc->arr[res_size++] = m;
+
+        group_start = group_end;
+    }
+
+    if (res_size == 0)
+    {
+        MonosFree(acc->arr);
+        return PolyZero();
+    }
+
+    if (res_size == 1 && acc->arr[0].exp == 0 && PolyIsCoeff(&acc->arr[0].p))
+    {
+        poly_coeff_t c = acc->arr[0].p.coeff;
+        MonosFree(acc->arr);
+        return PolyFromCoeff(c);
+    }
+
+    // po skróceniu się jednomianów tablica akumulatora bywa wielokrotnie
+    // większa od wyniku, który zostaje w niej na dłużej
+    if (PolyRequiredSize(res_size) < MonosCapacity(acc->arr))
+        acc->arr = MonosRealloc(acc->arr, PolyRequiredSize(res_size));
+
+    Poly res_poly;
+    res_poly.size = res_size;
+    res_poly.arr = acc->arr;
+
+    return res_poly;
+}
+
+Poly PolyAccumulatorFinalize(PolyAccumulator *acc)
+{
+    assert(acc != NULL);
+
+    Poly res_poly = AccumulatorSum(acc);
+    *acc = PolyAccumulatorNew();
+
+    return res_poly;
+}
+
+void PolyAccumulatorDestroy(PolyAccumulator *acc)
+{
+    assert(acc != NULL);
+
+    for (size_t i = 0; i < acc->size; i++)
+        MonoDestroy(&acc->arr[i]);
+
+    MonosFree(acc->arr);
+    *acc = PolyAccumulatorNew();
+}
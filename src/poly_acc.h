@@ -0,0 +1,71 @@
+/** @file
+  Interfejs akumulatora sum wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_ACC_H__
+#define __POLY_ACC_H__
+
+#include "poly.h"
+
+/**
+ * Akumulator sumy wielomianów.
+ * Zbiera jednomiany dodawanych wielomianów w tablicy dynamicznej bez ich
+ * sortowania i scalania. Suma jest wyznaczana dopiero przez
+ * ::PolyAccumulatorFinalize, jednym sortowaniem na każdym poziomie
+ * rekurencji, więc zsumowanie @f$n@f$ jednomianów kosztuje
+ * @f$\mathrm{O}(n\log n)@f$ zamiast wielokrotnego scalania wyniku.
+ */
+typedef struct
+{
+    /** tablica zebranych jednomianów */
+    Mono *arr;
+    /** liczba zebranych jednomianów */
+    size_t size;
+    /** liczba zaalokowanej pamięci w tablicy */
+    size_t max_size;
+} PolyAccumulator;
+
+/**
+ * Inicjalizuje i zwraca pusty akumulator. Nie alokuje pamięci.
+ * @return pusty akumulator
+ */
+PolyAccumulator PolyAccumulatorNew(void);
+
+/**
+ * Dodaje wielomian @f$p@f$ do akumulatora w zamortyzowanym czasie
+ * @f$\mathrm{O}(1)@f$ na jednomian. Przejmuje na własność wielomian @p p.
+ * @param[in,out] acc : akumulator
+ * @param[in] p : wielomian @f$p@f$ w postaci uproszczonej
+ */
+void PolyAccumulatorAdd(PolyAccumulator *acc, Poly p);
+
+/**
+ * Dodaje jednomian @f$m@f$ do akumulatora w zamortyzowanym czasie
+ * @f$\mathrm{O}(1)@f$. Przejmuje na własność jednomian @p m.
+ * @param[in,out] acc : akumulator
+ * @param[in] m : jednomian @f$m@f$ o współczynniku w postaci uproszczonej
+ */
+void PolyAccumulatorAddMono(PolyAccumulator *acc, Mono m);
+
+/**
+ * Zwraca sumę wszystkich wielomianów i jednomianów dodanych do akumulatora,
+ * w postaci uproszczonej. Zwalnia pamięć akumulatora, który staje się pusty.
+ * Pojemność tablic wyniku zależy od liczby ich jednomianów, a nie od liczby
+ * zebranych jednomianów, które mogły się skrócić.
+ * @param[in,out] acc : akumulator
+ * @return suma zebranych wielomianów
+ */
+Poly PolyAccumulatorFinalize(PolyAccumulator *acc);
+
+/**
+ * Usuwa z pamięci zawartość akumulatora bez wyznaczania sumy.
+ * @param[in,out] acc : akumulator
+ */
+void PolyAccumulatorDestroy(PolyAccumulator *acc);
+
+#endif
@@ -0,0 +1,919 @@
+/** @file
+  Implementacja przydzielania pamięci przez bibliotekę wielomianów
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_intern.h"
+#include "poly_lib.h"
+#include "poly_overflow.h"
+#include "poly_pool.h"
+#include <assert.h>
+#include <setjmp.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Początkowa pojemność zbioru śledzonych wskaźników */
+#define TRACKED_INIT_SIZE 64
+
+/**
+ * Przydziela pamięć funkcją malloc.
+ * @param[in] size : liczba bajtów
+ * @param[in] ctx : nieużywany kontekst
+ * @return przydzielona pamięć albo NULL
+ */
+static void *LibcMalloc(size_t size, void *ctx)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+/**
+ * Zmienia rozmiar pamięci funkcją realloc.
+ * @param[in] ptr : przydzielona pamięć
+ * @param[in] size : nowa liczba bajtów
+ * @param[in] ctx : nieużywany kontekst
+ * @return pamięć o nowym rozmiarze albo NULL
+ */
+static void *LibcRealloc(void *ptr, size_t size, void *ctx)
+{
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+/**
+ * Zwalnia pamięć funkcją free.
+ * @param[in] ptr : przydzielona pamięć
+ * @param[in] ctx : nieużywany kontekst
+ */
+static void LibcFree(void *ptr, void *ctx)
+{
+    (void)ctx;
+    free(ptr);
+}
+
+/** Funkcje, którymi biblioteka przydziela pamięć */
+typedef struct
+{
+    PolyMallocFn malloc_fn;   ///< funkcja przydzielająca pamięć
+    PolyReallocFn realloc_fn; ///< funkcja zmieniająca rozmiar pamięci
+    PolyFreeFn free_fn;       ///< funkcja zwalniająca pamięć
+    void *ctx;                ///< kontekst przekazywany funkcjom
+} Allocator;
+
+/** Ustawiony alokator */
+static Allocator allocator = {LibcMalloc, LibcRealloc, LibcFree, NULL};
+
+/** Zmiana licznika odwołań tablicy jednomianów sprzed funkcji PolyTry... */
+typedef struct
+{
+    void *header; ///< nagłówek tablicy
+    int delta;    ///< zmiana licznika
+} RefsChange;
+
+/**
+ * Stan funkcji PolyTry... wykonywanej przez bieżący wątek. Zbiór wskaźników
+ * przydzielonych w jej trakcie i jeszcze niezwolnionych jest tablicą
+ * z adresowaniem otwartym. Zmiany liczników odwołań tablic, które istniały
+ * przed nią, są zapisywane, żeby cofnąć je przy braku pamięci.
+ */
+typedef struct
+{
+    bool active;             ///< czy wątek wykonuje funkcję PolyTry...
+    jmp_buf env;             ///< miejsce powrotu przy braku pamięci
+    void **tracked;          ///< tablica zbioru śledzonych wskaźników
+    size_t size;             ///< liczba śledzonych wskaźników
+    size_t max_size;         ///< pojemność tablicy, potęga 2
+    RefsChange *changes;     ///< zmiany liczników odwołań
+    size_t changes_size;     ///< liczba zmian
+    size_t changes_max_size; ///< pojemność tablicy zmian
+} TryState;
+
+/** Stan funkcji PolyTry... bieżącego wątku */
+static _Thread_local TryState try_state;
+
+/**
+ * Reaguje na brak pamięci: przerywa bieżącą funkcję PolyTry..., a poza nią
+ * kończy program z kodem 1.
+ */
+static void AllocFailed(void)
+{
+    if (try_state.active)
+        longjmp(try_state.env, 1);
+
+    exit(1);
+}
+
+/**
+ * Wyznacza początkowe miejsce wskaźnika w zbiorze śledzonych wskaźników.
+ * @param[in] ptr : wskaźnik
+ * @return indeks w tablicy zbioru
+ */
+static size_t TrackedSlot(const void *ptr)
+{
+    uint64_t h = (uint64_t)(uintptr_t)ptr * UINT64_C(0x9E3779B97F4A7C15);
+    return (size_t)(h >> 32) & (try_state.max_size - 1);
+}
+
+/**
+ * Wstawia wskaźnik do zbioru śledzonych wskaźników, powiększając go w razie
+ * potrzeby.
+ * @param[in] ptr : wskaźnik
+ * @return czy udało się przydzielić pamięć na zbiór
+ */
+static bool TrackedInsert(void *ptr)
+{
+    if (2 * (try_state.size + 1) > try_state.max_size)
+    {
+        size_t old_max_size = try_state.max_size;
+        void **old_tracked = try_state.tracked;
+        size_t max_size = old_max_size == 0 ? TRACKED_INIT_SIZE
+                                            : old_max_size * MEM_SIZE_MULT;
+        void **tracked =
+            allocator.malloc_fn(max_size * sizeof(void *), allocator.ctx);
+        if (tracked == NULL)
+            return false;
+
+        memset(tracked, 0, max_size * sizeof(void *));
+        try_state.tracked = tracked;
+        try_state.max_size = max_size;
+        try_state.size = 0;
+        for (size_t i = 0; i < old_max_size; i++)
+            if (old_tracked[i] != NULL)
+                TrackedInsert(old_tracked[i]);
+
+        PolyFreeUntracked(old_tracked);
+    }
+
+    size_t i = TrackedSlot(ptr);
+    while (try_state.tracked[i] != NULL)
+        i = (i + 1) & (try_state.max_size - 1);
+
+    try_state.tracked[i] = ptr;
+    try_state.size++;
+
+    return true;
+}
+
+/**
+ * Sprawdza, czy wskaźnik należy do zbioru śledzonych wskaźników.
+ * @param[in] ptr : wskaźnik
+ * @return czy wskaźnik jest śledzony
+ */
+static bool TrackedContains(const void *ptr)
+{
+    if (try_state.size == 0)
+        return false;
+
+    size_t i = TrackedSlot(ptr);
+    while (try_state.tracked[i] != NULL)
+    {
+        if (try_state.tracked[i] == ptr)
+            return true;
+        i = (i + 1) & (try_state.max_size - 1);
+    }
+
+    return false;
+}
+
+/**
+ * Usuwa wskaźnik ze zbioru śledzonych wskaźników, jeśli w nim jest.
+ * Następne wskaźniki tego samego ciągu są przesuwane na zwolnione miejsce.
+ * @param[in] ptr : wskaźnik
+ */
+static void TrackedRemove(const void *ptr)
+{
+    if (try_state.size == 0)
+        return;
+
+    size_t mask = try_state.max_size - 1;
+    size_t i = TrackedSlot(ptr);
+    while (try_state.tracked[i] != ptr)
+    {
+        if (try_state.tracked[i] == NULL)
+            return;
+        i = (i + 1) & mask;
+    }
+
+    try_state.tracked[i] = NULL;
+    try_state.size--;
+
+    for (size_t j = (i + 1) & mask; try_state.tracked[j] != NULL;
+         j = (j + 1) & mask)
+    {
+        // wskaźnik może zająć zwolnione miejsce, jeśli nie leży ono
+        // cyklicznie między jego miejscem początkowym a bieżącym
+        size_t home = TrackedSlot(try_state.tracked[j]);
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            try_state.tracked[i] = try_state.tracked[j];
+            try_state.tracked[j] = NULL;
+            i = j;
+        }
+    }
+}
+
+/**
+ * Zaczyna śledzić pamięć przydzieloną w trakcie funkcji PolyTry...
+ * Jeśli zabraknie pamięci na zbiór, zwalnia ją i przerywa funkcję.
+ * @param[in] ptr : przydzielona pamięć
+ */
+static void AllocTrack(void *ptr)
+{
+    if (!TrackedInsert(ptr))
+    {
+        allocator.free_fn(ptr, allocator.ctx);
+        AllocFailed();
+    }
+}
+
+/**
+ * Zapisuje zmianę licznika odwołań tablicy jednomianów, jeśli bieżący wątek
+ * wykonuje funkcję PolyTry..., a tablica istniała przed nią. Wywoływana
+ * przed zmianą licznika, bo przy braku pamięci na zapis przerywa funkcję.
+ * @param[in] header : nagłówek tablicy
+ * @param[in] delta : zmiana licznika
+ */
+static void TryLogRefs(void *header, int delta)
+{
+    if (!try_state.active || TrackedContains(header))
+        return;
+
+    if (try_state.changes_size == try_state.changes_max_size)
+    {
+        size_t max_size = try_state.changes_max_size == 0
+                              ? TRACKED_INIT_SIZE
+                              : try_state.changes_max_size * MEM_SIZE_MULT;
+        RefsChange *changes =
+            allocator.malloc_fn(max_size * sizeof(RefsChange), allocator.ctx);
+        if (changes == NULL)
+            AllocFailed();
+
+        if (try_state.changes_size > 0)
+            memcpy(changes, try_state.changes,
+                   try_state.changes_size * sizeof(RefsChange));
+        PolyFreeUntracked(try_state.changes);
+        try_state.changes = changes;
+        try_state.changes_max_size = max_size;
+    }
+
+    try_state.changes[try_state.changes_size++] =
+        (RefsChange){.header = header, .delta = delta};
+}
+
+static void TryUndoRefs(void);
+
+void PolySetAllocator(PolyMallocFn malloc_fn, PolyReallocFn realloc_fn,
+                      PolyFreeFn free_fn, void *ctx)
+{
+    assert((malloc_fn == NULL) == (realloc_fn == NULL) &&
+           (malloc_fn == NULL) == (free_fn == NULL));
+
+    // wątki puli i bieżący wątek oddają pamięć podręczną poprzedniemu
+    // alokatorowi
+    size_t threads = PolyGetThreads();
+    PolySetThreads(1);
+    MonosPoolDestroy();
+    PolyScratchDestroy();
+    PolyInternClear();
+
+    if (malloc_fn == NULL)
+        allocator = (Allocator){LibcMalloc, LibcRealloc, LibcFree, NULL};
+    else
+        allocator = (Allocator){malloc_fn, realloc_fn, free_fn, ctx};
+
+    PolySetThreads(threads);
+}
+
+void *PolyMalloc(size_t size)
+{
+    void *ptr = PolyMallocUntracked(size);
+    if (try_state.active)
+        AllocTrack(ptr);
+
+    return ptr;
+}
+
+void *PolyRealloc(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return PolyMalloc(size);
+
+    void *new_ptr =
+        allocator.realloc_fn(ptr, size > 0 ? size : 1, allocator.ctx);
+    if (new_ptr == NULL)
+        AllocFailed();
+
+    // usunięcie zwalnia miejsce w zbiorze, więc wstawienie się powiedzie;
+    // pamięć sprzed funkcji PolyTry... nie jest śledzona
+    if (try_state.active && new_ptr != ptr && try_state.size > 0)
+    {
+        size_t size_before = try_state.size;
+        TrackedRemove(ptr);
+        if (try_state.size < size_before)
+            AllocTrack(new_ptr);
+    }
+
+    return new_ptr;
+}
+
+void PolyFree(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    if (try_state.active)
+        TrackedRemove(ptr);
+
+    allocator.free_fn(ptr, allocator.ctx);
+}
+
+void *PolyMallocUntracked(size_t size)
+{
+    void *ptr = allocator.malloc_fn(size > 0 ? size : 1, allocator.ctx);
+    if (ptr == NULL)
+        AllocFailed();
+
+    return ptr;
+}
+
+void PolyFreeUntracked(void *ptr)
+{
+    if (ptr != NULL)
+        allocator.free_fn(ptr, allocator.ctx);
+}
+
+bool PolyAllocIsTracking(void)
+{
+    return try_state.active;
+}
+
+/**
+ * Wykonuje operację, śledząc przydzielaną przez nią pamięć. Przy braku
+ * pamięci wraca tu z ::AllocFailed, zwalnia całą śledzoną pamięć i pamięć
+ * pomocniczą przydzieloną od początku operacji.
+ * @param[in] op : operacja
+ * @param[in,out] arg : argument operacji
+ * @return czy operacja się udała
+ */
+static bool AllocTry(void (*op)(void *arg), void *arg)
+{
+    assert(!try_state.active);
+
+    PolyArenaMark mark = PolyScratchMark();
+    bool was_safe = PolyOverflowSetProvenSafe(false);
+    bool success = false;
+
+    try_state.active = true;
+    if (setjmp(try_state.env) == 0)
+    {
+        op(arg);
+        success = true;
+    }
+    try_state.active = false;
+    // przerwany iloczyn nie przywraca stanu sprawdzania przepełnień
+    PolyOverflowSetProvenSafe(was_safe);
+
+    if (!success)
+    {
+        for (size_t i = 0; i < try_state.max_size; i++)
+            if (try_state.tracked[i] != NULL)
+                allocator.free_fn(try_state.tracked[i], allocator.ctx);
+
+        TryUndoRefs();
+        PolyScratchRelease(mark);
+    }
+
+    PolyFreeUntracked(try_state.tracked);
+    try_state.tracked = NULL;
+    try_state.size = 0;
+    try_state.max_size = 0;
+    PolyFreeUntracked(try_state.changes);
+    try_state.changes = NULL;
+    try_state.changes_size = 0;
+    try_state.changes_max_size = 0;
+
+    return success;
+}
+
+/** Argumenty i wynik operacji wykonywanej przez ::AllocTry */
+typedef struct
+{
+    const Poly *p;  ///< wielomian @f$p@f$
+    const Poly *q;  ///< wielomian @f$q@f$ albo tablica składanych wielomianów
+    size_t k;       ///< liczba składanych wielomianów
+    poly_coeff_t x; ///< wartość argumentu
+    Poly res;       ///< wynik
+} TryArgs;
+
+/**
+ * Klonuje wielomian w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TryClone(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolyClone(args->p);
+}
+
+/**
+ * Dodaje wielomiany w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TryAdd(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolyAdd(args->p, args->q);
+}
+
+/**
+ * Odejmuje wielomiany w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TrySub(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolySub(args->p, args->q);
+}
+
+/**
+ * Mnoży wielomiany w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TryMul(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolyMul(args->p, args->q);
+}
+
+/**
+ * Wylicza wartość wielomianu w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TryAt(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolyAt(args->p, args->x);
+}
+
+/**
+ * Składa wielomiany w ::AllocTry.
+ * @param[in,out] arg : argumenty operacji
+ */
+static void TryCompose(void *arg)
+{
+    TryArgs *args = arg;
+    args->res = PolyCompose(args->p, args->k, args->q);
+}
+
+bool PolyTryClone(const Poly *p, Poly *res)
+{
+    TryArgs args = {.p = p};
+    if (!AllocTry(TryClone, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTryAdd(const Poly *p, const Poly *q, Poly *res)
+{
+    TryArgs args = {.p = p, .q = q};
+    if (!AllocTry(TryAdd, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTrySub(const Poly *p, const Poly *q, Poly *res)
+{
+    TryArgs args = {.p = p, .q = q};
+    if (!AllocTry(TrySub, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTryMul(const Poly *p, const Poly *q, Poly *res)
+{
+    TryArgs args = {.p = p, .q = q};
+    if (!AllocTry(TryMul, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTryAt(const Poly *p, poly_coeff_t x, Poly *res)
+{
+    TryArgs args = {.p = p, .x = x};
+    if (!AllocTry(TryAt, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTryCompose(const Poly *p, size_t k, const Poly q[], Poly *res)
+{
+    TryArgs args = {.p = p, .q = q, .k = k};
+    if (!AllocTry(TryCompose, &args))
+        return false;
+
+    *res = args.res;
+    return true;
+}
+
+bool PolyTryComposeTo(Poly *p, size_t k, Poly q[])
+{
+    Poly res;
+    if (!PolyTryCompose(p, k, q, &res))
+        return false;
+
+    PolyDestroy(p);
+    for (size_t i = 0; i < k; i++)
+        PolyDestroy(&q[i]);
+
+    *p = res;
+    return true;
+}
+
+/** Bit słowa licznika odwołań oznaczający tablicę w tablicy internowania */
+#define MONOS_INTERNED (~(SIZE_MAX >> 1))
+
+/**
+ * Nagłówek tablicy jednomianów, leżący w pamięci tuż przed nią. Licznik
+ * odwołań jest równy zero dla tablic pożyczonych, np. przydzielonych z areny.
+ * Najwyższy bit słowa licznika to ::MONOS_INTERNED.
+ */
+typedef struct
+{
+    atomic_size_t refs;       ///< liczba wielomianów współdzielących tablicę
+    _Atomic(PolyMeta *) meta; ///< metadane wielomianu albo NULL
+    size_t max_size;          ///< pojemność tablicy
+} MonosHeader;
+
+static_assert(sizeof(MonosHeader) % alignof(poly_coeff_t) == 0,
+              "nagłówek musi zachowywać wyrównanie współczynników");
+
+/** Wolna tablica jednomianów na liście swojej klasy rozmiaru */
+typedef struct FreeMonos
+{
+    struct FreeMonos *next; ///< następna wolna tablica tej klasy
+} FreeMonos;
+
+/** Listy wolnych tablic jednomianów jednego wątku */
+typedef struct
+{
+    FreeMonos *lists[MONOS_POOL_CLASSES]; ///< listy wolnych tablic klas
+    size_t counts[MONOS_POOL_CLASSES];    ///< długości list
+    MonosPoolStats stats;                 ///< statystyki
+} MonosPool;
+
+/** Listy wolnych tablic jednomianów bieżącego wątku */
+static _Thread_local MonosPool pool;
+
+/**
+ * Zwraca nagłówek tablicy jednomianów.
+ * @param[in] arr : tablica jednomianów
+ * @return nagłówek tablicy
+ */
+static MonosHeader *MonosGetHeader(const Mono *arr)
+{
+    return (MonosHeader *)arr - 1;
+}
+
+/**
+ * Zwraca tablicę jednomianów leżącą za nagłówkiem.
+ * @param[in] header : nagłówek tablicy
+ * @return tablica jednomianów
+ */
+static Mono *MonosFromHeader(MonosHeader *header)
+{
+    return (Mono *)(header + 1);
+}
+
+/**
+ * Zwraca liczbę bajtów bloku z nagłówkiem i tablicą o pojemności
+ * @p max_size.
+ * @param[in] max_size : pojemność tablicy
+ * @return rozmiar bloku
+ */
+static size_t MonosBlockSize(size_t max_size)
+{
+    return sizeof(MonosHeader) + max_size * sizeof(Mono);
+}
+
+/**
+ * Wyznacza klasę rozmiaru tablicy o pojemności @p max_size.
+ * @param[in] max_size : pojemność tablicy
+ * @return klasa rozmiaru albo -1, jeśli pojemność nie należy do żadnej
+ */
+static int MonosPoolClass(size_t max_size)
+{
+    size_t class_size = INIT_SIZE;
+    for (int c = 0; c < MONOS_POOL_CLASSES; c++)
+    {
+        if (max_size == class_size)
+            return c;
+        class_size *= 2;
+    }
+
+    return -1;
+}
+
+/**
+ * Zdejmuje wolny blok z listy klasy @p c.
+ * @param[in] c : klasa rozmiaru
+ * @return wolny blok albo NULL, jeśli lista jest pusta
+ */
+static MonosHeader *MonosPoolTake(int c)
+{
+    FreeMonos *block = pool.lists[c];
+    if (block == NULL)
+        return NULL;
+
+    pool.lists[c] = block->next;
+    pool.counts[c]--;
+    pool.stats.hits++;
+
+    // blok z listy należy odtąd do bieżącej operacji
+    if (try_state.active)
+        AllocTrack(block);
+
+    return (MonosHeader *)block;
+}
+
+/**
+ * Odkłada blok tablicy na listę jej klasy rozmiaru, jeśli pojemność należy
+ * do jakiejś klasy, a lista nie jest pełna.
+ * @param[in] header : blok tablicy jednomianów
+ * @return czy blok został odłożony
+ */
+static bool MonosPoolPut(MonosHeader *header)
+{
+    int c = MonosPoolClass(header->max_size);
+    if (c < 0 || pool.counts[c] >= MONOS_POOL_MAX_FREE)
+        return false;
+
+    if (try_state.active)
+        TrackedRemove(header);
+
+    FreeMonos *block = (FreeMonos *)header;
+    block->next = pool.lists[c];
+    pool.lists[c] = block;
+    pool.counts[c]++;
+    pool.stats.recycled++;
+
+    return true;
+}
+
+Mono *MonosAlloc(size_t max_size)
+{
+    if (max_size > MONOS_MAX_SIZE)
+        AllocFailed();
+
+    pool.stats.allocs++;
+
+    int c = MonosPoolClass(max_size);
+    MonosHeader *header = c < 0 ? NULL : MonosPoolTake(c);
+    if (header == NULL)
+        header = PolyMalloc(MonosBlockSize(max_size));
+
+    atomic_init(&header->refs, 1);
+    atomic_init(&header->meta, NULL);
+    header->max_size = max_size;
+
+    return MonosFromHeader(header);
+}
+
+/**
+ * Zwalnia metadane tablicy jednomianów, której nikt poza wywołującym nie
+ * odczytuje.
+ * @param[in,out] header : nagłówek tablicy
+ */
+static void MonosDropMeta(MonosHeader *header)
+{
+    PolyMeta *meta = atomic_load_explicit(&header->meta, memory_order_relaxed);
+    if (meta != NULL)
+    {
+        PolyFree(meta);
+        atomic_store_explicit(&header->meta, NULL, memory_order_relaxed);
+    }
+}
+
+Mono *MonosRealloc(Mono *arr, size_t max_size)
+{
+    if (arr == NULL)
+        return MonosAlloc(max_size);
+
+    assert(!MonosIsShared(arr));
+
+    if (max_size > MONOS_MAX_SIZE)
+        AllocFailed();
+
+    pool.stats.allocs++;
+    pool.stats.reallocs++;
+    pool.stats.frees++;
+
+    // blok z listy zastępuje realloc tylko wtedy, gdy jest dostępny,
+    // w pozostałych przypadkach blok jest zwykłym blokiem z malloc
+    MonosHeader *header = MonosGetHeader(arr);
+    MonosDropMeta(header);
+    int c = MonosPoolClass(max_size);
+    MonosHeader *new_header = c < 0 ? NULL : MonosPoolTake(c);
+    if (new_header == NULL)
+    {
+        new_header = PolyRealloc(header, MonosBlockSize(max_size));
+        new_header->max_size = max_size;
+        return MonosFromHeader(new_header);
+    }
+
+    size_t old_max_size = header->max_size;
+    size_t kept = old_max_size < max_size ? old_max_size : max_size;
+    atomic_init(&new_header->refs, 1);
+    atomic_init(&new_header->meta, NULL);
+    new_header->max_size = max_size;
+    memcpy(MonosFromHeader(new_header), arr, kept * sizeof(Mono));
+    if (!MonosPoolPut(header))
+        PolyFree(header);
+
+    return MonosFromHeader(new_header);
+}
+
+void MonosFree(Mono *arr)
+{
+    if (arr == NULL)
+        return;
+
+    assert(!MonosIsShared(arr));
+
+    pool.stats.frees++;
+    MonosHeader *header = MonosGetHeader(arr);
+    MonosDropMeta(header);
+    if (!MonosPoolPut(header))
+        PolyFree(header);
+}
+
+size_t MonosCapacity(const Mono *arr)
+{
+    return MonosGetHeader(arr)->max_size;
+}
+
+/**
+ * Cofa zmiany liczników odwołań tablic sprzed przerwanej funkcji PolyTry...
+ */
+static void TryUndoRefs(void)
+{
+    for (size_t i = try_state.changes_size; i-- > 0;)
+    {
+        MonosHeader *header = try_state.changes[i].header;
+        if (try_state.changes[i].delta > 0)
+            atomic_fetch_sub_explicit(&header->refs, 1, memory_order_relaxed);
+        else
+            atomic_fetch_add_explicit(&header->refs, 1, memory_order_relaxed);
+    }
+}
+
+Mono *MonosArenaAlloc(PolyArena *arena, size_t count)
+{
+    MonosHeader *header = PolyArenaAlloc(arena, MonosBlockSize(count));
+    atomic_init(&header->refs, 0);
+    atomic_init(&header->meta, NULL);
+    header->max_size = count;
+
+    return MonosFromHeader(header);
+}
+
+bool MonosRetain(Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    size_t refs = atomic_load_explicit(&header->refs, memory_order_relaxed);
+    if ((refs & ~MONOS_INTERNED) == 0)
+        return false;
+
+    TryLogRefs(header, 1);
+    atomic_fetch_add_explicit(&header->refs, 1, memory_order_relaxed);
+
+    return true;
+}
+
+bool MonosRelease(Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    size_t refs = atomic_load_explicit(&header->refs, memory_order_acquire);
+    assert((refs & ~MONOS_INTERNED) != 0);
+
+    // jedyny właściciel nie musi zmniejszać licznika, bo tablica zaraz
+    // wróci do alokatora
+    if (refs == 1)
+        return true;
+
+    TryLogRefs(header, -1);
+    refs = atomic_fetch_sub_explicit(&header->refs, 1, memory_order_acq_rel);
+    return (refs & ~MONOS_INTERNED) == 1;
+}
+
+bool MonosIsShared(const Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    return atomic_load_explicit(&header->refs, memory_order_acquire) != 1;
+}
+
+size_t MonosRefCount(const Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    return atomic_load_explicit(&header->refs, memory_order_acquire) &
+           ~MONOS_INTERNED;
+}
+
+bool MonosIsInterned(const Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    return atomic_load_explicit(&header->refs, memory_order_acquire) &
+           MONOS_INTERNED;
+}
+
+void MonosSetInterned(Mono *arr, bool is_interned)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    if (is_interned)
+        atomic_fetch_or_explicit(&header->refs, MONOS_INTERNED,
+                                 memory_order_acq_rel);
+    else
+        atomic_fetch_and_explicit(&header->refs, ~MONOS_INTERNED,
+                                  memory_order_acq_rel);
+}
+
+const PolyMeta *MonosGetMeta(const Mono *arr)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    return atomic_load_explicit(&header->meta, memory_order_acquire);
+}
+
+PolyMeta *MonosMetaAlloc(const Mono *arr, size_t vars)
+{
+    size_t size = sizeof(PolyMeta) + vars * sizeof(poly_exp_t);
+
+    // tablica przydzielona przez przerwaną operację jest zwalniana bez
+    // usuwania metadanych, a metadane starszych tablic przeżywają operację
+    if (try_state.active && TrackedContains(MonosGetHeader(arr)))
+        return PolyMalloc(size);
+
+    return PolyMallocUntracked(size);
+}
+
+bool MonosSetMeta(const Mono *arr, PolyMeta *meta)
+{
+    MonosHeader *header = MonosGetHeader(arr);
+    if (MonosRefCount(arr) == 0)
+        return false;
+
+    // metadane wyznaczone równolegle przez inny wątek są takie same, więc
+    // wystarczy zachować pierwsze
+    PolyMeta *expected = NULL;
+    return atomic_compare_exchange_strong_explicit(&header->meta, &expected,
+                                                   meta, memory_order_acq_rel,
+                                                   memory_order_acquire);
+}
+
+void MonosClearMeta(Mono *arr)
+{
+    assert(!MonosIsShared(arr));
+
+    MonosDropMeta(MonosGetHeader(arr));
+}
+
+MonosPoolStats MonosPoolGetStats(void)
+{
+    return pool.stats;
+}
+
+void MonosPoolResetStats(void)
+{
+    pool.stats = (MonosPoolStats){0};
+}
+
+void MonosPoolDestroy(void)
+{
+    for (int c = 0; c < MONOS_POOL_CLASSES; c++)
+    {
+        while (pool.lists[c] != NULL)
+        {
+            FreeMonos *next = pool.lists[c]->next;
+            PolyFreeUntracked(pool.lists[c]);
+            pool.lists[c] = next;
+        }
+        pool.counts[c] = 0;
+    }
+}
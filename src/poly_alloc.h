@@ -0,0 +1,375 @@
+/** @file
+  Interfejs przydzielania pamięci przez bibliotekę wielomianów
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_ALLOC_H__
+#define __POLY_ALLOC_H__
+
+#include "poly.h"
+#include "poly_arena.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Liczba klas rozmiarów tablic jednomianów, które są ponownie używane.
+ * Klasa @f$c@f$ to tablice o pojemności @f$\mathrm{INIT\_SIZE}\cdot 2^c@f$.
+ */
+#define MONOS_POOL_CLASSES 6
+
+/** Największa pojemność tablicy jednomianów, ograniczona typem Poly::size */
+#define MONOS_MAX_SIZE UINT32_MAX
+
+/** Maksymalna liczba wolnych tablic przechowywanych w jednej klasie */
+#define MONOS_POOL_MAX_FREE 256
+
+/**
+ * Funkcja przydzielająca pamięć, odpowiednik malloc.
+ * @param[in] size : liczba bajtów
+ * @param[in,out] ctx : kontekst podany w ::PolySetAllocator
+ * @return przydzielona pamięć albo NULL w razie braku pamięci
+ */
+typedef void *(*PolyMallocFn)(size_t size, void *ctx);
+
+/**
+ * Funkcja zmieniająca rozmiar pamięci, odpowiednik realloc.
+ * @param[in] ptr : pamięć przydzielona wcześniej przez ten alokator
+ * @param[in] size : nowa liczba bajtów
+ * @param[in,out] ctx : kontekst podany w ::PolySetAllocator
+ * @return pamięć o nowym rozmiarze albo NULL w razie braku pamięci, kiedy
+ * @p ptr pozostaje ważny
+ */
+typedef void *(*PolyReallocFn)(void *ptr, size_t size, void *ctx);
+
+/**
+ * Funkcja zwalniająca pamięć, odpowiednik free.
+ * @param[in] ptr : pamięć przydzielona wcześniej przez ten alokator
+ * @param[in,out] ctx : kontekst podany w ::PolySetAllocator
+ */
+typedef void (*PolyFreeFn)(void *ptr, void *ctx);
+
+/**
+ * Ustawia funkcje, którymi biblioteka przydziela i zwalnia całą pamięć.
+ * Podanie samych wartości NULL przywraca funkcje z biblioteki standardowej.
+ * Zwalnia pamięć podręczną bieżącego wątku, opróżnia tablicę internowania
+ * (::PolyInternClear) i na chwilę kończy wątki puli (::PolySetThreads), żeby
+ * oddać pamięć poprzedniemu alokatorowi. Nie może być
+ * wywołana w trakcie operacji na wielomianach ani wtedy, gdy istnieją
+ * wielomiany lub areny utworzone przy poprzednim alokatorze.
+ *
+ * Jeśli alokator zwróci NULL poza funkcjami PolyTry..., program kończy się
+ * z kodem 1.
+ * @param[in] malloc_fn : funkcja przydzielająca pamięć
+ * @param[in] realloc_fn : funkcja zmieniająca rozmiar pamięci
+ * @param[in] free_fn : funkcja zwalniająca pamięć
+ * @param[in,out] ctx : kontekst przekazywany tym funkcjom
+ */
+void PolySetAllocator(PolyMallocFn malloc_fn, PolyReallocFn realloc_fn,
+                      PolyFreeFn free_fn, void *ctx);
+
+/**
+ * Przydziela pamięć ustawionym alokatorem. Nigdy nie zwraca NULL: przy braku
+ * pamięci przerywa bieżącą funkcję PolyTry..., a poza nimi kończy program
+ * z kodem 1.
+ * @param[in] size : liczba bajtów
+ * @return przydzielona pamięć
+ */
+void *PolyMalloc(size_t size);
+
+/**
+ * Zmienia rozmiar pamięci przydzielonej funkcją ::PolyMalloc. Przy braku
+ * pamięci zachowuje się jak ::PolyMalloc.
+ * @param[in] ptr : przydzielona pamięć albo NULL
+ * @param[in] size : nowa liczba bajtów
+ * @return pamięć o nowym rozmiarze
+ */
+void *PolyRealloc(void *ptr, size_t size);
+
+/**
+ * Zwalnia pamięć przydzieloną funkcją ::PolyMalloc lub ::PolyRealloc.
+ * @param[in] ptr : przydzielona pamięć albo NULL
+ */
+void PolyFree(void *ptr);
+
+/**
+ * Przydziela pamięć podręczną biblioteki (bloki aren, listy wolnych tablic),
+ * która nie jest zwalniana przy przerwaniu funkcji PolyTry..., bo jej
+ * właścicielem nie jest przerwana operacja.
+ * @param[in] size : liczba bajtów
+ * @return przydzielona pamięć
+ */
+void *PolyMallocUntracked(size_t size);
+
+/**
+ * Zwalnia pamięć przydzieloną funkcją ::PolyMallocUntracked.
+ * @param[in] ptr : przydzielona pamięć albo NULL
+ */
+void PolyFreeUntracked(void *ptr);
+
+/**
+ * Sprawdza, czy bieżący wątek wykonuje funkcję PolyTry..., która śledzi
+ * przydzieloną pamięć. Takie operacje działają sekwencyjnie.
+ * @return czy pamięć jest śledzona
+ */
+bool PolyAllocIsTracking(void);
+
+/**
+ * Klonuje wielomian tak jak ::PolyClone, ale przy braku pamięci zwalnia
+ * wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[out] res : klon wielomianu, ustawiany tylko w razie powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTryClone(const Poly *p, Poly *res);
+
+/**
+ * Dodaje wielomiany tak jak ::PolyAdd, ale przy braku pamięci zwalnia
+ * wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] res : @f$p + q@f$, ustawiany tylko w razie powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTryAdd(const Poly *p, const Poly *q, Poly *res);
+
+/**
+ * Odejmuje wielomiany tak jak ::PolySub, ale przy braku pamięci zwalnia
+ * wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] res : @f$p - q@f$, ustawiany tylko w razie powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTrySub(const Poly *p, const Poly *q, Poly *res);
+
+/**
+ * Mnoży wielomiany tak jak ::PolyMul, ale przy braku pamięci zwalnia
+ * wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * Działa na jednym wątku.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] res : @f$p \cdot q@f$, ustawiany tylko w razie powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTryMul(const Poly *p, const Poly *q, Poly *res);
+
+/**
+ * Wylicza wartość wielomianu tak jak ::PolyAt, ale przy braku pamięci
+ * zwalnia wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @param[out] res : @f$p(x, x_0, x_1, \ldots)@f$, ustawiany tylko w razie
+ * powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTryAt(const Poly *p, poly_coeff_t x, Poly *res);
+
+/**
+ * Składa wielomiany tak jak ::PolyCompose, ale przy braku pamięci zwalnia
+ * wszystko, co przydzieliła, i zwraca false zamiast kończyć program.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba składanych wielomianów
+ * @param[in] q : tablica składanych wielomianów
+ * @param[out] res : złożenie, ustawiane tylko w razie powodzenia
+ * @return czy operacja się udała
+ */
+bool PolyTryCompose(const Poly *p, size_t k, const Poly q[], Poly *res);
+
+/**
+ * Składa wielomiany w miejscu tak jak ::PolyComposeTo. W razie powodzenia
+ * zastępuje @f$p@f$ złożeniem i przejmuje na własność wielomiany @p q,
+ * a przy braku pamięci zwalnia wszystko, co przydzieliła, zostawia @f$p@f$
+ * i @p q bez zmian i zwraca false. Wymaga pamięci na kopię @f$p@f$.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] k : liczba składanych wielomianów
+ * @param[in,out] q : tablica składanych wielomianów
+ * @return czy operacja się udała
+ */
+bool PolyTryComposeTo(Poly *p, size_t k, Poly q[]);
+
+/** Statystyki ponownego używania tablic jednomianów */
+typedef struct
+{
+    /** liczba przydzielonych tablic, łącznie ze zmianami pojemności */
+    size_t allocs;
+    /** liczba zmian pojemności tablic (::MonosRealloc) */
+    size_t reallocs;
+    /** liczba tablic wziętych z listy wolnych tablic */
+    size_t hits;
+    /** liczba zwolnionych tablic */
+    size_t frees;
+    /** liczba zwolnionych tablic odłożonych na listę wolnych tablic */
+    size_t recycled;
+} MonosPoolStats;
+
+/**
+ * Metadane wielomianu, który nie jest współczynnikiem, zapisywane
+ * w nagłówku jego tablicy jednomianów (::PolyGetMeta).
+ */
+typedef struct
+{
+    /** skrót struktury wielomianu, równy dla równych wielomianów */
+    uint64_t hash;
+    /** liczba niezerowych współczynników liczbowych w drzewie wielomianu */
+    size_t terms;
+    /** liczba zmiennych, od których wielomian może zależeć */
+    size_t vars;
+    /** stopień wielomianu (::PolyDeg) */
+    poly_exp_t deg;
+    /** stopnie względem kolejnych @p vars zmiennych (::PolyDegBy) */
+    poly_exp_t degs[];
+} PolyMeta;
+
+/**
+ * Przydziela tablicę jednomianów o pojemności @p max_size. Tablice, których
+ * pojemność należy do jednej z ::MONOS_POOL_CLASSES klas rozmiarów, są
+ * brane z listy wolnych tablic bieżącego wątku, jeśli jakaś jest dostępna.
+ * Przed tablicą leży nagłówek z pojemnością, licznikiem odwołań równym 1
+ * i bez metadanych. Pojemność większa od ::MONOS_MAX_SIZE jest traktowana
+ * jak brak pamięci.
+ * @param[in] max_size : pojemność tablicy
+ * @return tablica jednomianów
+ */
+Mono *MonosAlloc(size_t max_size);
+
+/**
+ * Zmienia pojemność tablicy jednomianów, zachowując jej początkowe
+ * elementy, które mieszczą się w nowej pojemności. Tablica nie może być
+ * współdzielona.
+ * @param[in] arr : tablica jednomianów albo NULL
+ * @param[in] max_size : nowa pojemność tablicy
+ * @return tablica jednomianów o nowej pojemności
+ */
+Mono *MonosRealloc(Mono *arr, size_t max_size);
+
+/**
+ * Zwalnia tablicę jednomianów. Tablice z klas rozmiarów trafiają na listę
+ * wolnych tablic bieżącego wątku, dopóki ma ona mniej niż
+ * ::MONOS_POOL_MAX_FREE elementów. Jednomiany nie są usuwane. Tablica nie
+ * może być współdzielona.
+ * @param[in] arr : tablica jednomianów albo NULL
+ */
+void MonosFree(Mono *arr);
+
+/**
+ * Zwraca pojemność tablicy jednomianów zapisaną w jej nagłówku.
+ * @param[in] arr : tablica jednomianów
+ * @return pojemność tablicy
+ */
+size_t MonosCapacity(const Mono *arr);
+
+/**
+ * Przydziela z areny tablicę @p count jednomianów z nagłówkiem. Tablica jest
+ * pożyczona: nie można jej współdzielić (::MonosRetain) ani zwalniać.
+ * @param[in,out] arena : arena
+ * @param[in] count : liczba jednomianów
+ * @return tablica jednomianów
+ */
+Mono *MonosArenaAlloc(PolyArena *arena, size_t count);
+
+/**
+ * Dodaje odwołanie do tablicy jednomianów, która staje się współdzielona.
+ * Licznik odwołań jest atomowy, więc tablice mogą być współdzielone przez
+ * wątki.
+ * @param[in,out] arr : tablica jednomianów
+ * @return czy dodano odwołanie; false dla tablic pożyczonych, które trzeba
+ * skopiować
+ */
+bool MonosRetain(Mono *arr);
+
+/**
+ * Usuwa odwołanie do tablicy jednomianów.
+ * @param[in,out] arr : tablica jednomianów, która nie jest pożyczona
+ * @return czy było to ostatnie odwołanie; wtedy wywołujący usuwa jednomiany
+ * i zwalnia tablicę funkcją ::MonosFree
+ */
+bool MonosRelease(Mono *arr);
+
+/**
+ * Sprawdza, czy tablica jednomianów jest współdzielona albo pożyczona, czyli
+ * czy przed modyfikacją trzeba ją skopiować.
+ * @param[in] arr : tablica jednomianów
+ * @return czy tablica ma innego właściciela
+ */
+bool MonosIsShared(const Mono *arr);
+
+/**
+ * Zwraca liczbę odwołań do tablicy jednomianów.
+ * @param[in] arr : tablica jednomianów
+ * @return liczba odwołań, zero dla tablic pożyczonych
+ */
+size_t MonosRefCount(const Mono *arr);
+
+/**
+ * Sprawdza, czy tablica jednomianów należy do tablicy internowania
+ * (::PolyIntern). Równe wielomiany z takimi tablicami mają tę samą tablicę.
+ * @param[in] arr : tablica jednomianów
+ * @return czy tablica jest internowana
+ */
+bool MonosIsInterned(const Mono *arr);
+
+/**
+ * Oznacza tablicę jednomianów jako internowaną albo usuwa to oznaczenie.
+ * Używana tylko przez tablicę internowania.
+ * @param[in,out] arr : tablica jednomianów
+ * @param[in] is_interned : czy tablica jest internowana
+ */
+void MonosSetInterned(Mono *arr, bool is_interned);
+
+/**
+ * Zwraca metadane zapisane w nagłówku tablicy jednomianów.
+ * @param[in] arr : tablica jednomianów
+ * @return metadane albo NULL, jeśli nie zostały jeszcze wyznaczone
+ */
+const PolyMeta *MonosGetMeta(const Mono *arr);
+
+/**
+ * Przydziela metadane tablicy jednomianów ze stopniami względem @p vars
+ * zmiennych. Metadane tablicy przydzielonej w trakcie funkcji PolyTry...
+ * są śledzone jak ona, więc przy braku pamięci są zwalniane razem z nią.
+ * @param[in] arr : tablica jednomianów
+ * @param[in] vars : liczba zmiennych
+ * @return niewypełnione metadane
+ */
+PolyMeta *MonosMetaAlloc(const Mono *arr, size_t vars);
+
+/**
+ * Zapisuje w nagłówku tablicy jednomianów jej metadane, jeśli nie ma ich
+ * tam jeszcze, a tablica nie jest pożyczona. Bezpieczna dla wielu wątków
+ * odczytujących tę samą tablicę.
+ * @param[in] arr : tablica jednomianów
+ * @param[in] meta : metadane przydzielone funkcją ::MonosMetaAlloc
+ * @return czy metadane zostały zapisane; wpp. wywołujący je zwalnia funkcją
+ * ::PolyFree
+ */
+bool MonosSetMeta(const Mono *arr, PolyMeta *meta);
+
+/**
+ * Usuwa metadane tablicy jednomianów przed jej modyfikacją.
+ * @param[in,out] arr : tablica jednomianów, która nie jest współdzielona
+ */
+void MonosClearMeta(Mono *arr);
+
+/**
+ * Zwraca statystyki ponownego używania tablic jednomianów bieżącego wątku.
+ * @return statystyki
+ */
+MonosPoolStats MonosPoolGetStats(void);
+
+/**
+ * Zeruje statystyki ponownego używania tablic jednomianów bieżącego wątku.
+ */
+void MonosPoolResetStats(void);
+
+/**
+ * Usuwa z pamięci wolne tablice jednomianów bieżącego wątku. Wywoływana przy
+ * kończeniu wątku.
+ */
+void MonosPoolDestroy(void);
+
+#endif
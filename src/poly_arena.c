@@ -0,0 +1,179 @@
+/** @file
+  Implementacja areny pamięci dla wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_arena.h"
+#include "poly_alloc.h"
+#include "poly_lib.h"
+#include <stdalign.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** Wyrównanie pamięci przydzielanej z areny */
+#define ARENA_ALIGN alignof(max_align_t)
+
+/** Blok pamięci areny */
+struct PolyArenaBlock
+{
+    PolyArenaBlock *next; ///< następny blok listy
+    size_t size;          ///< liczba bajtów pamięci bloku
+    max_align_t data[];   ///< pamięć bloku
+};
+
+/** Arena pomocnicza bieżącego wątku */
+static _Thread_local PolyArena scratch = {NULL, NULL, 0};
+
+/**
+ * Zaokrągla rozmiar w górę do wielokrotności ::ARENA_ALIGN.
+ * @param[in] size : liczba bajtów
+ * @return zaokrąglona liczba bajtów
+ */
+static size_t ArenaAlignSize(size_t size)
+{
+    return (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+}
+
+/**
+ * Tworzy blok areny.
+ * @param[in] size : liczba bajtów pamięci bloku
+ * @return blok
+ */
+static PolyArenaBlock *ArenaBlockNew(size_t size)
+{
+    PolyArenaBlock *block = PolyMallocUntracked(sizeof(PolyArenaBlock) + size);
+    block->next = NULL;
+    block->size = size;
+
+    return block;
+}
+
+/**
+ * Usuwa z pamięci blok i wszystkie następne bloki listy.
+ * @param[in] block : blok
+ */
+static void ArenaBlocksFree(PolyArenaBlock *block)
+{
+    while (block != NULL)
+    {
+        PolyArenaBlock *next = block->next;
+        PolyFreeUntracked(block);
+        block = next;
+    }
+}
+
+PolyArena PolyArenaNew(void)
+{
+    return (PolyArena){.first = NULL, .current = NULL, .used = 0};
+}
+
+void *PolyArenaAlloc(PolyArena *arena, size_t size)
+{
+    size = ArenaAlignSize(size);
+
+    if (arena->current != NULL && arena->current->size - arena->used >= size)
+    {
+        void *ptr = (char *)arena->current->data + arena->used;
+        arena->used += size;
+        return ptr;
+    }
+
+    // brak miejsca w bieżącym bloku, więc przydział trafia na początek
+    // następnego, a jeśli ten jest za mały, przed niego wstawiany jest nowy
+    PolyArenaBlock *prev = arena->current;
+    PolyArenaBlock *next = prev == NULL ? arena->first : prev->next;
+    if (next == NULL || next->size < size)
+    {
+        PolyArenaBlock *block =
+            ArenaBlockNew(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        block->next = next;
+        if (prev == NULL)
+            arena->first = block;
+        else
+            prev->next = block;
+        next = block;
+    }
+
+    arena->current = next;
+    arena->used = size;
+
+    return next->data;
+}
+
+Poly PolyCloneInto(PolyArena *arena, const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return PolyFromCoeff(p->coeff);
+
+    Poly cloned_p;
+    cloned_p.size = p->size;
+    cloned_p.arr = MonosArenaAlloc(arena, p->size);
+
+    for (size_t i = 0; i < p->size; i++)
+    {
+        cloned_p.arr[i].p = PolyCloneInto(arena, &p->arr[i].p);
+        cloned_p.arr[i].exp = p->arr[i].exp;
+    }
+
+    return cloned_p;
+}
+
+PolyArenaMark PolyArenaGetMark(const PolyArena *arena)
+{
+    return (PolyArenaMark){.block = arena->current, .used = arena->used};
+}
+
+void PolyArenaRelease(PolyArena *arena, PolyArenaMark mark)
+{
+    arena->current = mark.block;
+    arena->used = mark.used;
+}
+
+void PolyArenaReset(PolyArena *arena)
+{
+    arena->current = NULL;
+    arena->used = 0;
+}
+
+void PolyArenaDestroy(PolyArena *arena)
+{
+    ArenaBlocksFree(arena->first);
+    *arena = PolyArenaNew();
+}
+
+PolyArena *PolyScratch(void)
+{
+    return &scratch;
+}
+
+PolyArenaMark PolyScratchMark(void)
+{
+    return PolyArenaGetMark(&scratch);
+}
+
+void PolyScratchRelease(PolyArenaMark mark)
+{
+    PolyArenaRelease(&scratch, mark);
+
+    bool is_empty = scratch.current == NULL ||
+                    (scratch.current == scratch.first && scratch.used == 0);
+    if (!is_empty || scratch.first == NULL)
+        return;
+
+    // pierwszy blok zwykłego rozmiaru zostaje na kolejne operacje
+    ArenaBlocksFree(scratch.first->next);
+    scratch.first->next = NULL;
+    if (scratch.first->size > ARENA_BLOCK_SIZE)
+        PolyArenaDestroy(&scratch);
+    else
+        PolyArenaReset(&scratch);
+}
+
+void PolyScratchDestroy(void)
+{
+    PolyArenaDestroy(&scratch);
+}
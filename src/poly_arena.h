@@ -0,0 +1,133 @@
+/** @file
+  Interfejs areny pamięci dla wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_ARENA_H__
+#define __POLY_ARENA_H__
+
+#include "poly.h"
+#include <stddef.h>
+
+/**
+ * Rozmiar pojedynczego bloku areny w bajtach. Większe przydziały dostają
+ * osobny blok dokładnie potrzebnego rozmiaru.
+ */
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+/** Blok pamięci areny */
+typedef struct PolyArenaBlock PolyArenaBlock;
+
+/**
+ * Arena pamięci. Przydziela pamięć z listy bloków przez przesunięcie
+ * wskaźnika, a zwalnia ją tylko całą naraz (::PolyArenaReset) albo do
+ * zapamiętanego wcześniej miejsca (::PolyArenaRelease). Zwolnione bloki są
+ * używane ponownie.
+ */
+typedef struct
+{
+    /** pierwszy blok listy */
+    PolyArenaBlock *first;
+    /** blok, z którego jest przydzielana pamięć */
+    PolyArenaBlock *current;
+    /** liczba zajętych bajtów bieżącego bloku */
+    size_t used;
+} PolyArena;
+
+/** Miejsce w arenie, do którego można zwolnić pamięć */
+typedef struct
+{
+    /** blok, z którego była przydzielana pamięć */
+    PolyArenaBlock *block;
+    /** liczba zajętych bajtów tego bloku */
+    size_t used;
+} PolyArenaMark;
+
+/**
+ * Inicjalizuje i zwraca pustą arenę. Nie alokuje pamięci.
+ * @return pusta arena
+ */
+PolyArena PolyArenaNew(void);
+
+/**
+ * Przydziela z areny @p size bajtów wyrównanych jak dla dowolnego typu.
+ * Pamięć jest ważna do zwolnienia jej razem z areną.
+ * @param[in,out] arena : arena
+ * @param[in] size : liczba bajtów
+ * @return wskaźnik na przydzieloną pamięć
+ */
+void *PolyArenaAlloc(PolyArena *arena, size_t size);
+
+/**
+ * Robi głęboką kopię wielomianu w pamięci areny. Kopia jest tylko do
+ * odczytu: nie wolno jej usuwać funkcją ::PolyDestroy ani modyfikować
+ * funkcjami, które zmieniają rozmiar tablic jednomianów. Przestaje być ważna
+ * po zwolnieniu pamięci areny.
+ * @param[in,out] arena : arena
+ * @param[in] p : wielomian @f$p@f$
+ * @return skopiowany wielomian
+ */
+Poly PolyCloneInto(PolyArena *arena, const Poly *p);
+
+/**
+ * Zapamiętuje bieżące miejsce areny.
+ * @param[in] arena : arena
+ * @return miejsce areny
+ */
+PolyArenaMark PolyArenaGetMark(const PolyArena *arena);
+
+/**
+ * Zwalnia w czasie @f$\mathrm{O}(1)@f$ całą pamięć przydzieloną z areny po
+ * zapamiętaniu miejsca @p mark.
+ * @param[in,out] arena : arena
+ * @param[in] mark : miejsce areny zwrócone przez ::PolyArenaGetMark
+ */
+void PolyArenaRelease(PolyArena *arena, PolyArenaMark mark);
+
+/**
+ * Zwalnia w czasie @f$\mathrm{O}(1)@f$ całą pamięć przydzieloną z areny.
+ * Bloki areny zostają i są używane przez kolejne przydziały.
+ * @param[in,out] arena : arena
+ */
+void PolyArenaReset(PolyArena *arena);
+
+/**
+ * Usuwa z pamięci wszystkie bloki areny, która staje się pusta.
+ * @param[in,out] arena : arena
+ */
+void PolyArenaDestroy(PolyArena *arena);
+
+/**
+ * Zwraca arenę bieżącego wątku na pamięć pomocniczą operacji na
+ * wielomianach. Pamięć musi być zwalniana w kolejności odwrotnej do
+ * przydzielania: funkcja zapamiętuje miejsce ::PolyScratchMark, a przed
+ * powrotem zwalnia wszystko, co przydzieliła, funkcją ::PolyScratchRelease.
+ * @return arena pomocnicza bieżącego wątku
+ */
+PolyArena *PolyScratch(void);
+
+/**
+ * Zapamiętuje bieżące miejsce areny pomocniczej bieżącego wątku.
+ * @return miejsce areny pomocniczej
+ */
+PolyArenaMark PolyScratchMark(void);
+
+/**
+ * Zwalnia pamięć areny pomocniczej bieżącego wątku do miejsca @p mark. Gdy
+ * arena staje się pusta, zwalnia też wszystkie jej bloki poza pierwszym, żeby
+ * nie trzymać pamięci po dużych operacjach.
+ * @param[in] mark : miejsce areny zwrócone przez ::PolyScratchMark
+ */
+void PolyScratchRelease(PolyArenaMark mark);
+
+/**
+ * Usuwa z pamięci arenę pomocniczą bieżącego wątku. Wywoływana przy
+ * kończeniu wątku.
+ */
+void PolyScratchDestroy(void);
+
+#endif
@@ -0,0 +1,1464 @@
+/** @file
+  Mikrobenchmarki biblioteki wielomianów rzadkich wielu zmiennych
+
+  Uruchomienie bez parametrów wykonuje wszystkie benchmarki, a z nazwą
+  benchmarku jako parametrem tylko wybrany.
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+// mkdtemp i system z POSIX, przy kompilacji z -std=c11
+#define _POSIX_C_SOURCE 200809L
+
+#include "poly.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_eval.h"
+#include "poly_intern.h"
+#include "poly_lib.h"
+#include "poly_mul.h"
+#include "poly_overflow.h"
+#include "poly_pool.h"
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Liczba elementów tablicy x */
+#define SIZE(x) (sizeof(x) / sizeof(x)[0])
+
+/** Minimalny łączny czas powtórzeń jednego pomiaru w sekundach */
+#define BENCH_MIN_TIME 0.2
+
+/**
+ * Porównuje jednomiany malejąco po wykładnikach. Odpowiada porównaniu, którego
+ * ::MonosSort używał razem z funkcją qsort.
+ * @param[in] a : jednomian @f$a@f$
+ * @param[in] b : jednomian @f$b@f$
+ * @return 1 jeśli @f$a > b@f$, 0 jeśli @f$a == b@f$, -1 jeśli @f$a < b@f$
+ */
+static int MonoCompFunc(const void *a, const void *b)
+{
+    return (((Mono *)b)->exp > ((Mono *)a)->exp) -
+           (((Mono *)b)->exp < ((Mono *)a)->exp);
+}
+
+/**
+ * Sortuje jednomiany funkcją qsort, tak jak robił to dawniej ::MonosSort.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ */
+static void MonosQsort(Mono *monos, size_t size)
+{
+    qsort(monos, size, sizeof(Mono), MonoCompFunc);
+}
+
+/** Rodzaje układów wykładników w sortowanych tablicach */
+typedef enum
+{
+    SORT_RANDOM,   ///< losowe wykładniki
+    SORT_SORTED,   ///< wykładniki malejące
+    SORT_REVERSED, ///< wykładniki rosnące
+    SORT_FEW,      ///< losowe wykładniki z małego zakresu
+} SortPattern;
+
+/** Nazwy układów wykładników */
+static const char *SORT_PATTERN_NAMES[] = {"random", "sorted", "reversed",
+                                           "few"};
+
+/**
+ * Wypełnia tablicę jednomianów o stałych współczynnikach wykładnikami w
+ * zadanym układzie.
+ * @param[out] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ * @param[in] pattern : układ wykładników
+ */
+static void FillMonos(Mono *monos, size_t size, SortPattern pattern)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        poly_exp_t exp;
+        switch (pattern)
+        {
+        case SORT_SORTED:
+            exp = (poly_exp_t)(size - i);
+            break;
+        case SORT_REVERSED:
+            exp = (poly_exp_t)i;
+            break;
+        case SORT_FEW:
+            exp = rand() % 16;
+            break;
+        default:
+            exp = rand();
+            break;
+        }
+        monos[i] = (Mono){.p = PolyFromCoeff(1), .exp = exp};
+    }
+}
+
+/**
+ * Mierzy średni czas sortowania tablicy funkcją @p sort w milisekundach.
+ * Każde powtórzenie sortuje świeżą kopię tablicy @p monos.
+ * @param[in] sort : funkcja sortująca
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ * @return średni czas jednego sortowania w milisekundach
+ */
+static double TimeSort(void (*sort)(Mono *, size_t), const Mono *monos,
+                       size_t size)
+{
+    Mono *copy = malloc(size * sizeof(Mono));
+    CHECK_PTR(copy);
+
+    size_t reps = 0;
+    clock_t total = 0;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        memcpy(copy, monos, size * sizeof(Mono));
+        clock_t start = clock();
+        sort(copy, size);
+        total += clock() - start;
+        reps++;
+    }
+
+    free(copy);
+    return 1000.0 * total / CLOCKS_PER_SEC / reps;
+}
+
+/**
+ * Porównuje ::MonosSort z sortowaniem funkcją qsort dla różnych rozmiarów i
+ * układów tablic.
+ */
+static void MonosSortBench(void)
+{
+    const size_t sizes[] = {16, 256, 4096, 65536, 1048576};
+
+    printf("%-10s %10s %14s %14s %8s\n", "pattern", "size", "qsort [ms]",
+           "MonosSort [ms]", "speedup");
+    for (size_t p = 0; p < SIZE(SORT_PATTERN_NAMES); p++)
+    {
+        for (size_t s = 0; s < SIZE(sizes); s++)
+        {
+            Mono *monos = malloc(sizes[s] * sizeof(Mono));
+            CHECK_PTR(monos);
+            FillMonos(monos, sizes[s], (SortPattern)p);
+
+            double qsort_time = TimeSort(MonosQsort, monos, sizes[s]);
+            double sort_time = TimeSort(MonosSort, monos, sizes[s]);
+            printf("%-10s %10zu %14.4f %14.4f %8.2f\n", SORT_PATTERN_NAMES[p],
+                   sizes[s], qsort_time, sort_time, qsort_time / sort_time);
+
+            free(monos);
+        }
+    }
+}
+
+/**
+ * Tworzy gęsty wielomian o @p size jednomianach z wykładnikami od 0 do
+ * @p size - 1 i losowymi niezerowymi współczynnikami. Dla @p depth większego
+ * od 1 współczynniki są gęstymi wielomianami kolejnej zmiennej o 4
+ * jednomianach.
+ * @param[in] size : liczba jednomianów
+ * @param[in] depth : liczba zmiennych
+ * @return gęsty wielomian
+ */
+static Poly DensePoly(size_t size, size_t depth)
+{
+    if (depth == 0)
+        return PolyFromCoeff(rand() % 1000 + 1);
+
+    Mono *monos = PolyMallocMonos(size);
+    for (size_t i = 0; i < size; i++)
+        monos[i] = (Mono){.p = DensePoly(4, depth - 1), .exp = (poly_exp_t)i};
+
+    return PolyAdoptMonos(size, monos);
+}
+
+/**
+ * Mierzy średni czas mnożenia wielomianów funkcją @p mul w milisekundach.
+ * @param[in] mul : funkcja mnożąca
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return średni czas jednego mnożenia w milisekundach
+ */
+static double TimeMul(Poly (*mul)(const Poly *, const Poly *), const Poly *p,
+                      const Poly *q)
+{
+    size_t reps = 0;
+    clock_t total = 0;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        clock_t start = clock();
+        Poly res = mul(p, q);
+        total += clock() - start;
+        PolyDestroy(&res);
+        reps++;
+    }
+
+    return 1000.0 * total / CLOCKS_PER_SEC / reps;
+}
+
+/**
+ * Porównuje ::PolyMulDense z ::PolyMulHeap dla gęstych wielomianów jednej i
+ * dwóch zmiennych. Wyznacza próg ::DENSE_MUL_MIN_SIZE.
+ */
+static void DenseMulBench(void)
+{
+    const size_t sizes[] = {4, 8, 16, 32, 64, 256, 1024, 4096};
+
+    printf("%-6s %10s %14s %14s %8s\n", "vars", "size", "heap [ms]",
+           "dense [ms]", "speedup");
+    for (size_t depth = 1; depth <= 2; depth++)
+    {
+        for (size_t s = 0; s < SIZE(sizes); s++)
+        {
+            if (depth > 1 && sizes[s] > 256)
+                break;
+
+            Poly p = DensePoly(sizes[s], depth);
+            Poly q = DensePoly(sizes[s], depth);
+
+            double heap_time = TimeMul(PolyMulHeap, &p, &q);
+            double dense_time = TimeMul(PolyMulDense, &p, &q);
+            printf("%-6zu %10zu %14.4f %14.4f %8.2f\n", depth, sizes[s],
+                   heap_time, dense_time, heap_time / dense_time);
+
+            PolyDestroy(&p);
+            PolyDestroy(&q);
+        }
+    }
+}
+
+/**
+ * Tworzy wielomian @p vars zmiennych o stopniach mniejszych od @p deg
+ * względem każdej z nich, w którym każdy z możliwych jednomianów występuje z
+ * prawdopodobieństwem @p percent procent.
+ * @param[in] vars : liczba zmiennych
+ * @param[in] deg : ograniczenie stopni
+ * @param[in] percent : gęstość wielomianu w procentach
+ * @return wielomian
+ */
+static Poly GridPoly(size_t vars, size_t deg, int percent)
+{
+    if (vars == 0)
+        return PolyFromCoeff(rand() % 100 < percent ? rand() % 1000 + 1 : 0);
+
+    Mono *monos = malloc(deg * sizeof(Mono));
+    CHECK_PTR(monos);
+    for (size_t i = 0; i < deg; i++)
+        monos[i] = (Mono){.p = GridPoly(vars - 1, deg, percent),
+                          .exp = (poly_exp_t)i};
+
+    return PolyAddMonos(deg, monos);
+}
+
+/**
+ * Porównuje ::PolyMulKronecker z ::PolyMulHeap dla wielomianów o różnej
+ * liczbie zmiennych i gęstości oraz wypisuje decyzję
+ * ::PolyMulKroneckerIsWorth. Wyznacza progi ::KRONECKER_MIN_PRODUCTS
+ * i ::KRONECKER_MAX_COST_RATIO.
+ */
+static void KroneckerMulBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t deg;
+        int percent;
+    } shapes[] = {{1, 64, 100},   {1, 256, 100},  {1, 1024, 100},
+                  {1, 4096, 100}, {1, 4096, 10},  {1, 4096, 1},
+                  {1, 65536, 1},  {2, 16, 100},   {2, 64, 100},
+                  {2, 64, 10},    {2, 256, 1},    {2, 512, 1},
+                  {3, 8, 100},    {3, 16, 100},   {3, 16, 10},
+                  {3, 32, 1},     {3, 64, 1},     {4, 8, 100}};
+
+    printf("%-4s %6s %8s %8s %14s %14s %8s %6s\n", "vars", "deg", "density",
+           "terms", "heap [ms]", "kron [ms]", "speedup", "worth");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = GridPoly(shapes[s].vars, shapes[s].deg, shapes[s].percent);
+        Poly q = GridPoly(shapes[s].vars, shapes[s].deg, shapes[s].percent);
+        if (PolyIsCoeff(&p) || PolyIsCoeff(&q))
+        {
+            PolyDestroy(&p);
+            PolyDestroy(&q);
+            continue;
+        }
+
+        double heap_time = TimeMul(PolyMulHeap, &p, &q);
+        double kron_time = TimeMul(PolyMulKronecker, &p, &q);
+        printf("%-4zu %6zu %7d%% %8zu %14.4f %14.4f %8.2f %6s\n",
+               shapes[s].vars, shapes[s].deg, shapes[s].percent, (size_t)p.size,
+               heap_time, kron_time, heap_time / kron_time,
+               PolyMulKroneckerIsWorth(&p, &q) ? "yes" : "no");
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+    }
+}
+
+/**
+ * Mierzy czas ::PolyMul dla różnej liczby wątków i sprawdza, czy wynik jest
+ * taki sam jak przy mnożeniu sekwencyjnym. Wyznacza próg
+ * ::PAR_MUL_MIN_PRODUCTS.
+ */
+static void ParMulBench(void)
+{
+    const size_t threads[] = {1, 2, 4, 8};
+    const struct
+    {
+        size_t vars;
+        size_t deg;
+        int percent;
+    } shapes[] = {{1, 1024, 10},  {1, 65536, 1}, {2, 64, 10},
+                  {2, 512, 1},    {3, 32, 3},    {1, 4096, 100},
+                  {2, 128, 100}};
+
+    printf("%-4s %6s %8s %8s %14s %8s %10s\n", "vars", "deg", "density",
+           "threads", "PolyMul [ms]", "speedup", "identical");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = GridPoly(shapes[s].vars, shapes[s].deg, shapes[s].percent);
+        Poly q = GridPoly(shapes[s].vars, shapes[s].deg, shapes[s].percent);
+
+        PolySetThreads(1);
+        Poly serial = PolyMul(&p, &q);
+        double serial_time = TimeMul(PolyMul, &p, &q);
+
+        for (size_t t = 0; t < SIZE(threads); t++)
+        {
+            PolySetThreads(threads[t]);
+            Poly res = PolyMul(&p, &q);
+            double time = TimeMul(PolyMul, &p, &q);
+            printf("%-4zu %6zu %7d%% %8zu %14.4f %8.2f %10s\n",
+                   shapes[s].vars, shapes[s].deg, shapes[s].percent,
+                   threads[t], time, serial_time / time,
+                   PolyIsEq(&res, &serial) ? "yes" : "no");
+            PolyDestroy(&res);
+        }
+
+        PolyDestroy(&serial);
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+    }
+
+    PolySetThreads(1);
+}
+
+/**
+ * Tworzy rzadki wielomian @p vars zmiennych o @p size jednomianach na każdym
+ * poziomie i losowych wykładnikach mniejszych od @p max_exp.
+ * @param[in] vars : liczba zmiennych
+ * @param[in] size : liczba jednomianów na każdym poziomie
+ * @param[in] max_exp : ograniczenie wykładników
+ * @return wielomian
+ */
+static Poly SparsePoly(size_t vars, size_t size, poly_exp_t max_exp)
+{
+    if (vars == 0)
+        return PolyFromCoeff(rand() % 1000 + 1);
+
+    Mono *monos = PolyMallocMonos(size);
+    for (size_t i = 0; i < size; i++)
+        monos[i] = (Mono){.p = SparsePoly(vars - 1, size, max_exp),
+                          .exp = rand() % max_exp};
+
+    return PolyAdoptMonos(size, monos);
+}
+
+/**
+ * Podnosi wielomian do kwadratu ogólnym mnożeniem, przez jego kopię, żeby
+ * ::PolyMul nie wybrał ::PolySqr.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : nieużywany wielomian
+ * @return @f$p^2@f$
+ */
+static Poly SqrByMul(const Poly *p, const Poly *q)
+{
+    (void)q;
+    Poly copy = PolyClone(p);
+    Poly res = PolyMul(p, &copy);
+    PolyDestroy(&copy);
+
+    return res;
+}
+
+/**
+ * Podnosi wielomian do kwadratu funkcją ::PolySqr.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : nieużywany wielomian
+ * @return @f$p^2@f$
+ */
+static Poly SqrBySqr(const Poly *p, const Poly *q)
+{
+    (void)q;
+    return PolySqr(p);
+}
+
+/**
+ * Porównuje ::PolySqr z ogólnym mnożeniem wielomianu przez jego kopię dla
+ * rzadkich i gęstych wielomianów.
+ */
+static void SqrBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+        poly_exp_t max_exp;
+    } shapes[] = {{1, 16, 1 << 20},   {1, 256, 1 << 20}, {1, 2048, 1 << 20},
+                  {2, 16, 1 << 20},   {2, 64, 1 << 20},  {3, 12, 1 << 20},
+                  {1, 1024, 1024},    {2, 32, 32}};
+
+    printf("%-4s %6s %10s %14s %14s %8s\n", "vars", "size", "max exp",
+           "PolyMul [ms]", "PolySqr [ms]", "speedup");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, shapes[s].max_exp);
+
+        double mul_time = TimeMul(SqrByMul, &p, &p);
+        double sqr_time = TimeMul(SqrBySqr, &p, &p);
+        printf("%-4zu %6zu %10d %14.4f %14.4f %8.2f\n", shapes[s].vars,
+               shapes[s].size, shapes[s].max_exp, mul_time, sqr_time,
+               mul_time / sqr_time);
+
+        PolyDestroy(&p);
+    }
+}
+
+/**
+ * Mierzy średni czas obliczenia sumy @f$\sum_i a_i b_i@f$ w milisekundach.
+ * @param[in] fused : czy dodawać iloczyny funkcją ::PolyMulAddTo, czy
+ * wyznaczać je funkcją ::PolyMul i dodawać funkcją ::PolyAddTo
+ * @param[in] a : tablica wielomianów @f$a_i@f$
+ * @param[in] b : tablica wielomianów @f$b_i@f$
+ * @param[in] count : liczba iloczynów
+ * @return średni czas obliczenia sumy w milisekundach
+ */
+static double TimeMulAdd(bool fused, const Poly *a, const Poly *b,
+                         size_t count)
+{
+    size_t reps = 0;
+    clock_t total = 0;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        clock_t start = clock();
+        Poly acc = PolyZero();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (fused)
+            {
+                PolyMulAddTo(&acc, &a[i], &b[i]);
+            }
+            else
+            {
+                Poly prod = PolyMul(&a[i], &b[i]);
+                PolyAddTo(&acc, &prod);
+                PolyDestroy(&prod);
+            }
+        }
+        total += clock() - start;
+        PolyDestroy(&acc);
+        reps++;
+    }
+
+    return 1000.0 * total / CLOCKS_PER_SEC / reps;
+}
+
+/**
+ * Porównuje ::PolyMulAddTo z mnożeniem i dodawaniem iloczynu przy sumowaniu
+ * iloczynów rzadkich wielomianów.
+ */
+static void MulAddBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+        size_t count;
+        poly_exp_t max_exp;
+    } shapes[] = {{1, 4, 256, 1 << 12},  {1, 16, 64, 1 << 12},
+                  {1, 64, 16, 1 << 20},  {2, 4, 64, 1 << 8},
+                  {2, 16, 16, 1 << 8},   {3, 4, 16, 1 << 6}};
+
+    printf("%-4s %6s %6s %10s %14s %16s %8s\n", "vars", "size", "count",
+           "max exp", "Mul+Add [ms]", "PolyMulAddTo [ms]", "speedup");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        size_t count = shapes[s].count;
+        Poly *a = malloc(count * sizeof(Poly));
+        Poly *b = malloc(count * sizeof(Poly));
+        CHECK_PTR(a);
+        CHECK_PTR(b);
+        for (size_t i = 0; i < count; i++)
+        {
+            a[i] =
+                SparsePoly(shapes[s].vars, shapes[s].size, shapes[s].max_exp);
+            b[i] =
+                SparsePoly(shapes[s].vars, shapes[s].size, shapes[s].max_exp);
+        }
+
+        double separate_time = TimeMulAdd(false, a, b, count);
+        double fused_time = TimeMulAdd(true, a, b, count);
+        printf("%-4zu %6zu %6zu %10d %14.4f %16.4f %8.2f\n", shapes[s].vars,
+               shapes[s].size, count, shapes[s].max_exp, separate_time,
+               fused_time, separate_time / fused_time);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            PolyDestroy(&a[i]);
+            PolyDestroy(&b[i]);
+        }
+        free(a);
+        free(b);
+    }
+}
+
+/**
+ * Porównuje kopiowanie i usuwanie wielomianów funkcjami ::PolyClone
+ * i ::PolyDestroy z kopiowaniem do areny funkcją ::PolyCloneInto i jej
+ * zwalnianiem funkcją ::PolyArenaReset. ::PolyClone tylko współdzieli
+ * tablicę jednomianów, a ::PolyCloneInto kopiuje cały wielomian.
+ */
+static void ArenaBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 1024}, {2, 32}, {3, 10}, {4, 6}, {6, 3}};
+
+    printf("%-4s %6s %18s %18s %8s\n", "vars", "size", "Clone+Destroy [ms]",
+           "CloneInto [ms]", "speedup");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 1 << 20);
+        PolyArena arena = PolyArenaNew();
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            Poly copy = PolyClone(&p);
+            PolyDestroy(&copy);
+            total += clock() - start;
+            reps++;
+        }
+        double heap_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            PolyCloneInto(&arena, &p);
+            PolyArenaReset(&arena);
+            total += clock() - start;
+            reps++;
+        }
+        double arena_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        printf("%-4zu %6zu %18.4f %18.4f %8.2f\n", shapes[s].vars,
+               shapes[s].size, heap_time, arena_time, heap_time / arena_time);
+
+        PolyArenaDestroy(&arena);
+        PolyDestroy(&p);
+    }
+}
+
+/**
+ * Porównuje sklonowanie wielomianu funkcją ::PolyClone i dodanie do klonu
+ * wyrazu wolnego, które kopiuje tylko zmienianą ścieżkę, z funkcją
+ * ::PolyNeg, która kopiuje cały wielomian.
+ */
+static void CowBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 1024}, {2, 32}, {3, 10}, {4, 6}, {6, 3}};
+
+    printf("%-4s %6s %14s %18s %14s %8s\n", "vars", "size", "Clone [ms]",
+           "Clone+AddTo [ms]", "PolyNeg [ms]", "ratio");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 1 << 20);
+        Poly one = PolyFromCoeff(1);
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            Poly copy = PolyClone(&p);
+            PolyDestroy(&copy);
+            total += clock() - start;
+            reps++;
+        }
+        double clone_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            Poly copy = PolyClone(&p);
+            PolyAddTo(&copy, &one);
+            PolyDestroy(&copy);
+            total += clock() - start;
+            reps++;
+        }
+        double add_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            Poly neg = PolyNeg(&p);
+            PolyDestroy(&neg);
+            total += clock() - start;
+            reps++;
+        }
+        double neg_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        printf("%-4zu %6zu %14.4f %18.4f %14.4f %8.2f\n", shapes[s].vars,
+               shapes[s].size, clone_time, add_time, neg_time,
+               neg_time / add_time);
+
+        PolyDestroy(&p);
+    }
+}
+
+/**
+ * Mierzy czas operacji na małych wielomianach, w których przeważa
+ * przydzielanie i zwalnianie krótkich tablic jednomianów, i wypisuje, jaka
+ * część tablic została wzięta z list wolnych tablic (::MonosAlloc).
+ */
+static void MonosPoolBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 2}, {1, 4}, {2, 2}, {2, 3}, {3, 2}};
+
+    printf("%-4s %6s %14s %10s\n", "vars", "size", "time [ms]", "hit rate");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly polys[16];
+        for (size_t i = 0; i < SIZE(polys); i++)
+            polys[i] = SparsePoly(shapes[s].vars, shapes[s].size, 8);
+
+        MonosPoolResetStats();
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            for (size_t i = 0; i < SIZE(polys); i++)
+            {
+                const Poly *q = &polys[(i + 1) % SIZE(polys)];
+                Poly copy = PolyClone(&polys[i]);
+                Poly sum = PolyAdd(&copy, q);
+                Poly prod = PolyMul(&sum, q);
+                Poly at = PolyAt(&prod, 3);
+                PolyDestroy(&copy);
+                PolyDestroy(&sum);
+                PolyDestroy(&prod);
+                PolyDestroy(&at);
+            }
+            total += clock() - start;
+            reps++;
+        }
+
+        MonosPoolStats stats = MonosPoolGetStats();
+        printf("%-4zu %6zu %14.4f %9.1f%%\n", shapes[s].vars, shapes[s].size,
+               1000.0 * total / CLOCKS_PER_SEC / reps,
+               100.0 * stats.hits / (stats.allocs > 0 ? stats.allocs : 1));
+
+        for (size_t i = 0; i < SIZE(polys); i++)
+            PolyDestroy(&polys[i]);
+    }
+}
+
+/**
+ * Zlicza tablice jednomianów wielomianu i jednomiany w nich, traktując każde
+ * wystąpienie podwielomianu osobno.
+ * @param[in] p : wielomian
+ * @param[in,out] stats : powiększane liczniki
+ */
+static void CountMonos(const Poly *p, PolyInternStats *stats)
+{
+    if (PolyIsCoeff(p))
+        return;
+
+    stats->arrays++;
+    stats->monos += p->size;
+    for (size_t i = 0; i < p->size; i++)
+        CountMonos(&p->arr[i].p, stats);
+}
+
+/**
+ * Tworzy wielomian @p vars zmiennych, w którym występują wszystkie jednomiany
+ * o stopniach mniejszych od @p deg względem każdej zmiennej, ze
+ * współczynnikami 1 lub 2.
+ * @param[in] vars : liczba zmiennych
+ * @param[in] deg : ograniczenie stopni
+ * @return wielomian
+ */
+static Poly SmallCoeffPoly(size_t vars, size_t deg)
+{
+    if (vars == 0)
+        return PolyFromCoeff(rand() % 2 + 1);
+
+    Mono *monos = PolyMallocMonos(deg);
+    for (size_t i = 0; i < deg; i++)
+        monos[i] = (Mono){.p = SmallCoeffPoly(vars - 1, deg),
+                          .exp = (poly_exp_t)i};
+
+    return PolyAdoptMonos(deg, monos);
+}
+
+/**
+ * Mierzy średni czas porównania wielomianów funkcją ::PolyIsEq
+ * w milisekundach.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return średni czas jednego porównania w milisekundach
+ */
+static double TimeIsEq(const Poly *p, const Poly *q)
+{
+    size_t reps = 0;
+    clock_t total = 0;
+    bool is_eq = true;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        clock_t start = clock();
+        for (size_t i = 0; i < 1000; i++)
+            is_eq &= PolyIsEq(p, q);
+        total += clock() - start;
+        reps++;
+    }
+    if (!is_eq)
+        printf("PolyIsEq: wrong result\n");
+
+    return 1000.0 * total / CLOCKS_PER_SEC / reps / 1000;
+}
+
+/**
+ * Internuje pełne wielomiany o małych współczynnikach, w których powtarza
+ * się wiele podwielomianów, i wypisuje liczby tablic i jednomianów przed
+ * i po internowaniu (::PolyIntern), czas internowania oraz czas porównania
+ * dwóch równych, osobno zbudowanych wielomianów przed i po internowaniu.
+ */
+static void InternBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t deg;
+    } shapes[] = {{3, 4}, {4, 4}, {6, 3}, {8, 2}, {12, 2}};
+
+    printf("%-4s %4s %16s %16s %12s %12s %12s\n", "vars", "deg",
+           "arrays/monos", "interned", "intern [ms]", "IsEq [ms]",
+           "IsEq' [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        unsigned seed = (unsigned)rand();
+        srand(seed);
+        Poly p = SmallCoeffPoly(shapes[s].vars, shapes[s].deg);
+        srand(seed);
+        Poly q = SmallCoeffPoly(shapes[s].vars, shapes[s].deg);
+
+        PolyInternStats before = {0, 0};
+        CountMonos(&p, &before);
+        double is_eq_time = TimeIsEq(&p, &q);
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            PolyInternClear();
+            clock_t start = clock();
+            Poly interned = PolyIntern(&p);
+            total += clock() - start;
+            PolyDestroy(&interned);
+            reps++;
+        }
+        double intern_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        Poly p_interned = PolyIntern(&p);
+        Poly q_interned = PolyIntern(&q);
+        PolyInternStats after = PolyInternGetStats();
+        double interned_is_eq_time = TimeIsEq(&p_interned, &q_interned);
+
+        printf("%-4zu %4zu %7zu/%-8zu %7zu/%-8zu %12.4f %12.6f %12.6f\n",
+               shapes[s].vars, shapes[s].deg, before.arrays, before.monos,
+               after.arrays, after.monos, intern_time, is_eq_time,
+               interned_is_eq_time);
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+        PolyDestroy(&p_interned);
+        PolyDestroy(&q_interned);
+        PolyInternClear();
+    }
+}
+
+/**
+ * Porównuje wyznaczanie stopnia wielomianu przejściem drzewa
+ * (::PolyDegHelp) z funkcją ::PolyDeg, która przy pierwszym wywołaniu
+ * zapisuje metadane wielomianu (::PolyGetMeta), a przy kolejnych tylko je
+ * odczytuje, oraz mierzy czas ::PolyIsEq dla wielomianów różniących się
+ * jednym współczynnikiem.
+ */
+static void MetaBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 1024}, {2, 32}, {3, 10}, {4, 6}, {6, 3}};
+
+    printf("%-4s %6s %12s %12s %12s %12s\n", "vars", "size", "walk [ms]",
+           "first [ms]", "cached [ms]", "IsEq [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 1 << 20);
+        Poly q = PolyClone(&p);
+        Poly one = PolyFromCoeff(1);
+        PolyAddTo(&q, &one);
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            poly_exp_t deg = 0;
+            clock_t start = clock();
+            PolyDegHelp(&p, &deg, 0);
+            total += clock() - start;
+            reps++;
+        }
+        double walk_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            Poly copy = PolyNeg(&p);
+            clock_t start = clock();
+            PolyDeg(&copy);
+            total += clock() - start;
+            PolyDestroy(&copy);
+            reps++;
+        }
+        double first_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            for (size_t i = 0; i < 1000; i++)
+                PolyDeg(&p);
+            total += clock() - start;
+            reps++;
+        }
+        double cached_time = 1000.0 * total / CLOCKS_PER_SEC / reps / 1000;
+
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            for (size_t i = 0; i < 1000; i++)
+                if (PolyIsEq(&p, &q))
+                    printf("PolyIsEq: wrong result\n");
+            total += clock() - start;
+            reps++;
+        }
+        double is_eq_time = 1000.0 * total / CLOCKS_PER_SEC / reps / 1000;
+
+        printf("%-4zu %6zu %12.4f %12.4f %12.6f %12.6f\n", shapes[s].vars,
+               shapes[s].size, walk_time, first_time, cached_time,
+               is_eq_time);
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+    }
+}
+
+/**
+ * Mierzy czas dodawania w miejscu funkcją ::PolyAddTo wielomianów jednej
+ * zmiennej o podobnej liczbie jednomianów, scalanych liniowo przez
+ * ::PolyCombineTo. Do sumy na przemian dodawany jest wielomian @f$q@f$
+ * i @f$-q@f$, więc jej rozmiar się nie zmienia.
+ */
+static void AddBench(void)
+{
+    const struct
+    {
+        size_t p_size;
+        size_t q_size;
+        poly_exp_t max_exp;
+    } shapes[] = {{64, 64, 1 << 10},       {1024, 1024, 1 << 12},
+                  {1024, 256, 1 << 20},    {65536, 65536, 1 << 18},
+                  {65536, 16384, 1 << 20}, {1 << 20, 1 << 18, 1 << 22}};
+
+    printf("%-8s %8s %10s %14s\n", "|p|", "|q|", "max exp", "AddTo [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(1, shapes[s].p_size, shapes[s].max_exp);
+        Poly q = SparsePoly(1, shapes[s].q_size, shapes[s].max_exp);
+        Poly neg_q = PolyNeg(&q);
+        Poly zero = PolyZero();
+        Poly sum = PolyAdd(&p, &zero);
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            PolyAddTo(&sum, &q);
+            PolyAddTo(&sum, &neg_q);
+            total += clock() - start;
+            reps++;
+        }
+        double add_time = 1000.0 * total / CLOCKS_PER_SEC / reps / 2;
+
+        if (!PolyIsEq(&sum, &p))
+            printf("PolyAddTo: wrong result\n");
+
+        printf("%-8zu %8zu %10d %14.4f\n", shapes[s].p_size, shapes[s].q_size,
+               shapes[s].max_exp, add_time);
+
+        PolyDestroy(&p);
+        PolyDestroy(&q);
+        PolyDestroy(&neg_q);
+        PolyDestroy(&sum);
+    }
+}
+
+/**
+ * Porównuje wyliczanie wartości wielomianu wielu zmiennych kolejnymi
+ * wywołaniami ::PolyAt, które budują pośrednie wielomiany, z funkcją
+ * ::PolyEval, która przechodzi drzewo raz bez przydzielania pamięci.
+ */
+static void EvalBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 1024}, {2, 32}, {3, 10}, {4, 6}, {6, 3}};
+    const poly_coeff_t x[] = {3, -5, 7, 9, -3, 5};
+
+    printf("%-4s %6s %18s %14s %8s\n", "vars", "size", "PolyAt chain [ms]",
+           "PolyEval [ms]", "speedup");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 1 << 20);
+
+        poly_coeff_t at_value = 0;
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            Poly curr = PolyClone(&p);
+            for (size_t i = 0; i < shapes[s].vars; i++)
+            {
+                Poly next = PolyAt(&curr, x[i]);
+                PolyDestroy(&curr);
+                curr = next;
+            }
+            at_value = curr.coeff;
+            total += clock() - start;
+            reps++;
+        }
+        double at_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        poly_coeff_t eval_value = 0;
+        reps = 0;
+        total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            eval_value = PolyEval(&p, shapes[s].vars, x);
+            total += clock() - start;
+            reps++;
+        }
+        double eval_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        if (eval_value != at_value)
+            printf("PolyEval: wrong result\n");
+
+        printf("%-4zu %6zu %18.4f %14.4f %8.2f\n", shapes[s].vars,
+               shapes[s].size, at_time, eval_time, at_time / eval_time);
+
+        PolyDestroy(&p);
+    }
+}
+
+/**
+ * Porównuje wyliczanie wartości wielomianu w wielu punktach kolejnymi
+ * wywołaniami ::PolyEval z funkcją ::PolyEvalBatch, która przechodzi drzewo
+ * raz dla grupy ::EVAL_LANES punktów, na różnej liczbie wątków, bez
+ * instrukcji AVX2 i z nimi (::PolySetEvalAvx2).
+ */
+static void EvalBatchBench(void)
+{
+    const size_t threads[] = {1, 4};
+    const struct
+    {
+        size_t vars;
+        size_t size;
+        size_t points;
+    } shapes[] = {{1, 64, 1 << 16},  {2, 16, 1 << 14}, {3, 8, 1 << 14},
+                  {4, 4, 1 << 14},   {6, 3, 1 << 12},  {1, 16, 1 << 10},
+                  {2, 8, 1 << 10}};
+
+    printf("%-4s %6s %8s %8s %5s %14s %14s %8s\n", "vars", "size", "points",
+           "threads", "avx2", "PolyEval [ms]", "Batch [ms]", "speedup");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 64);
+        size_t k = shapes[s].vars;
+        size_t n = shapes[s].points;
+        poly_coeff_t *xs = malloc(n * k * sizeof(poly_coeff_t));
+        poly_coeff_t *out = malloc(n * sizeof(poly_coeff_t));
+        CHECK_PTR(xs);
+        CHECK_PTR(out);
+        for (size_t i = 0; i < n * k; i++)
+            xs[i] = rand() % 19 - 9;
+
+        size_t reps = 0;
+        clock_t total = 0;
+        while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+        {
+            clock_t start = clock();
+            for (size_t i = 0; i < n; i++)
+                out[i] = PolyEval(&p, k, xs + i * k);
+            total += clock() - start;
+            reps++;
+        }
+        double eval_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+        for (size_t t = 0; t < SIZE(threads) * 2; t++)
+        {
+            PolySetThreads(threads[t / 2]);
+            PolySetEvalAvx2(t % 2 == 1);
+            if (t % 2 == 1 && !PolyGetEvalAvx2())
+                continue;
+
+            reps = 0;
+            total = 0;
+            while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+            {
+                clock_t start = clock();
+                PolyEvalBatch(&p, k, n, xs, out);
+                total += clock() - start;
+                reps++;
+            }
+            double batch_time = 1000.0 * total / CLOCKS_PER_SEC / reps;
+
+            for (size_t i = 0; i < n; i++)
+                if (out[i] != PolyEval(&p, k, xs + i * k))
+                {
+                    printf("PolyEvalBatch: wrong result\n");
+                    break;
+                }
+
+            printf("%-4zu %6zu %8zu %8zu %5s %14.4f %14.4f %8.2f\n",
+                   shapes[s].vars, shapes[s].size, n, threads[t / 2],
+                   t % 2 == 1 ? "yes" : "no", eval_time, batch_time,
+                   eval_time / batch_time);
+        }
+
+        free(xs);
+        free(out);
+        PolyDestroy(&p);
+    }
+
+    PolySetThreads(1);
+    PolySetEvalAvx2(true);
+}
+
+/**
+ * Mierzy koszt trybu sprawdzania przepełnień (::PolySetOverflowCheck) dla
+ * mnożenia i dodawania: bez sprawdzania, ze sprawdzaniem dla
+ * współczynników, dla których oszacowanie wyklucza przepełnienie, i ze
+ * sprawdzaniem dla współczynników, dla których go nie wyklucza, więc
+ * mnożenie nie może użyć szybkich algorytmów.
+ */
+static void OverflowBench(void)
+{
+    struct
+    {
+        const char *name;
+        Poly p;
+        Poly q;
+    } shapes[] = {{"sparse2", SparsePoly(2, 32, 1 << 20),
+                   SparsePoly(2, 32, 1 << 20)},
+                  {"sparse3", SparsePoly(3, 8, 1 << 10),
+                   SparsePoly(3, 8, 1 << 10)},
+                  {"dense1", DensePoly(2048, 1), DensePoly(2048, 1)},
+                  {"grid2", GridPoly(2, 48, 50), GridPoly(2, 48, 50)}};
+    const struct
+    {
+        const char *name;
+        Poly (*op)(const Poly *, const Poly *);
+    } ops[] = {{"mul", PolyMul}, {"add", PolyAdd}};
+
+    printf("%-8s %4s %12s %12s %12s\n", "shape", "op", "off [ms]",
+           "on [ms]", "on big [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        // współczynnik 2^40 sprawia, że oszacowanie iloczynu się nie mieści
+        Poly big_q = PolyMulByCoeff(&shapes[s].q, (poly_coeff_t)1 << 40);
+
+        for (size_t o = 0; o < SIZE(ops); o++)
+        {
+            PolySetOverflowCheck(false);
+            double off_time = TimeMul(ops[o].op, &shapes[s].p, &shapes[s].q);
+
+            PolySetOverflowCheck(true);
+            PolyOverflowClear();
+            double on_time = TimeMul(ops[o].op, &shapes[s].p, &shapes[s].q);
+            if (PolyOverflowOccurred())
+                printf("PolyMulFastIsSafe: unexpected overflow\n");
+            double big_time = TimeMul(ops[o].op, &shapes[s].p, &big_q);
+
+            printf("%-8s %4s %12.4f %12.4f %12.4f\n", shapes[s].name,
+                   ops[o].name, off_time, on_time, big_time);
+        }
+
+        PolyDestroy(&big_q);
+        PolyDestroy(&shapes[s].p);
+        PolyDestroy(&shapes[s].q);
+    }
+
+    PolySetOverflowCheck(false);
+    PolyOverflowClear();
+}
+
+/** Sposób wyliczania wartości wielomianu mierzony w ProgramBench */
+typedef enum
+{
+    PROGRAM_BENCH_EVAL,       ///< ::PolyEval w każdym punkcie
+    PROGRAM_BENCH_PROG,       ///< ::PolyProgramEval w każdym punkcie
+    PROGRAM_BENCH_BATCH,      ///< ::PolyEvalBatch
+    PROGRAM_BENCH_PROG_BATCH, ///< ::PolyProgramEvalBatch
+    PROGRAM_BENCH_PROG_MOD    ///< ::PolyProgramEvalMod w każdym punkcie
+} ProgramBenchMode;
+
+/**
+ * Mierzy czas wyliczenia wartości wielomianu we wszystkich punktach.
+ * @param[in] mode : sposób wyliczania
+ * @param[in] p : wielomian
+ * @param[in] prog : program wielomianu @p p
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] n : liczba punktów
+ * @param[in] xs : wartości zmiennych w kolejnych punktach
+ * @param[out] out : wartości wielomianu
+ * @return średni czas w milisekundach
+ */
+static double ProgramBenchTime(ProgramBenchMode mode, const Poly *p,
+                               const PolyProgram *prog, size_t k, size_t n,
+                               const poly_coeff_t *xs, poly_coeff_t *out)
+{
+    size_t reps = 0;
+    clock_t total = 0;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        clock_t start = clock();
+        switch (mode)
+        {
+        case PROGRAM_BENCH_EVAL:
+            for (size_t i = 0; i < n; i++)
+                out[i] = PolyEval(p, k, xs + i * k);
+            break;
+        case PROGRAM_BENCH_PROG:
+            for (size_t i = 0; i < n; i++)
+                out[i] = PolyProgramEval(prog, k, xs + i * k);
+            break;
+        case PROGRAM_BENCH_BATCH:
+            PolyEvalBatch(p, k, n, xs, out);
+            break;
+        case PROGRAM_BENCH_PROG_BATCH:
+            PolyProgramEvalBatch(prog, k, n, xs, out);
+            break;
+        case PROGRAM_BENCH_PROG_MOD:
+            for (size_t i = 0; i < n; i++)
+                out[i] = PolyProgramEvalMod(prog, k, xs + i * k, 1000000007);
+            break;
+        }
+        total += clock() - start;
+        reps++;
+    }
+
+    return 1000.0 * total / CLOCKS_PER_SEC / reps;
+}
+
+/**
+ * Porównuje wyliczanie wartości wielomianu przechodzeniem drzewa
+ * (::PolyEval, ::PolyEvalBatch) z wykonywaniem skompilowanego programu
+ * (::PolyProgramEval, ::PolyProgramEvalBatch) oraz mierzy wyliczanie
+ * wartości modulo ::PolyProgramEvalMod.
+ */
+static void ProgramBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 64}, {2, 16}, {3, 8}, {4, 4}, {6, 3}};
+    const size_t n = 1 << 12;
+
+    printf("%-4s %6s %10s %10s %10s %10s %10s\n", "vars", "size", "Eval [ms]",
+           "Prog [ms]", "Batch [ms]", "PBatch[ms]", "Mod [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 64);
+        PolyProgram prog = PolyProgramCompile(&p);
+        size_t k = shapes[s].vars;
+        poly_coeff_t *xs = malloc(n * k * sizeof(poly_coeff_t));
+        poly_coeff_t *out = malloc(n * sizeof(poly_coeff_t));
+        CHECK_PTR(xs);
+        CHECK_PTR(out);
+        for (size_t i = 0; i < n * k; i++)
+            xs[i] = rand() % 10 * 2 - 9;
+
+        double times[PROGRAM_BENCH_PROG_MOD + 1];
+        for (int mode = 0; mode <= PROGRAM_BENCH_PROG_MOD; mode++)
+        {
+            times[mode] = ProgramBenchTime((ProgramBenchMode)mode, &p, &prog,
+                                           k, n, xs, out);
+
+            if (mode == PROGRAM_BENCH_PROG_MOD)
+                continue;
+
+            for (size_t i = 0; i < n; i++)
+                if (out[i] != PolyEval(&p, k, xs + i * k))
+                {
+                    printf("PolyProgram: wrong result\n");
+                    break;
+                }
+        }
+
+        printf("%-4zu %6zu %10.4f %10.4f %10.4f %10.4f %10.4f\n",
+               shapes[s].vars, shapes[s].size, times[PROGRAM_BENCH_EVAL],
+               times[PROGRAM_BENCH_PROG], times[PROGRAM_BENCH_BATCH],
+               times[PROGRAM_BENCH_PROG_BATCH], times[PROGRAM_BENCH_PROG_MOD]);
+
+        free(xs);
+        free(out);
+        PolyProgramDestroy(&prog);
+        PolyDestroy(&p);
+    }
+}
+
+/** Funkcja wypisana przez ::PolyEmitC */
+typedef long (*EmittedFunction)(const long x[]);
+
+/**
+ * Kompiluje kod wypisany przez ::PolyEmitC do biblioteki współdzielonej
+ * w katalogu @p dir i ładuje z niej funkcję. Kompilator wskazuje zmienna
+ * środowiskowa CC, domyślnie cc.
+ * @param[in] p : wielomian
+ * @param[in] dir : katalog na pliki kodu i biblioteki
+ * @param[in] id : numer odróżniający pliki kolejnych wielomianów
+ * @param[out] handle : uchwyt załadowanej biblioteki
+ * @return funkcja albo NULL, jeśli kompilacja lub ładowanie się nie udały
+ */
+static EmittedFunction EmitCLoad(const Poly *p, const char *dir, size_t id,
+                                 void **handle)
+{
+    char src[256], lib[256], cmd[1024];
+    snprintf(src, sizeof(src), "%s/emit%zu.c", dir, id);
+    snprintf(lib, sizeof(lib), "%s/emit%zu.so", dir, id);
+    FILE *file = fopen(src, "w");
+    if (file == NULL)
+        return NULL;
+    PolyEmitC(p, file, "emitted");
+    fclose(file);
+
+    const char *cc = getenv("CC");
+    snprintf(cmd, sizeof(cmd), "%s -O2 -shared -fPIC -o %s %s",
+             cc != NULL ? cc : "cc", lib, src);
+    int status = system(cmd);
+    remove(src);
+    if (status != 0)
+        return NULL;
+
+    *handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+    remove(lib);
+    if (*handle == NULL)
+        return NULL;
+
+    EmittedFunction fn;
+    *(void **)&fn = dlsym(*handle, "emitted");
+    return fn;
+}
+
+/**
+ * Mierzy czas wyliczenia wartości wielomianu funkcją wypisaną przez
+ * ::PolyEmitC w @p n punktach.
+ * @param[in] fn : funkcja
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] n : liczba punktów
+ * @param[in] xs : wartości zmiennych w kolejnych punktach
+ * @param[out] out : wartości wielomianu
+ * @return średni czas jednego przebiegu w milisekundach
+ */
+static double EmitCTime(EmittedFunction fn, size_t k, size_t n,
+                        const poly_coeff_t *xs, poly_coeff_t *out)
+{
+    size_t reps = 0;
+    clock_t total = 0;
+    while ((double)total / CLOCKS_PER_SEC < BENCH_MIN_TIME)
+    {
+        clock_t start = clock();
+        for (size_t i = 0; i < n; i++)
+            out[i] = fn(xs + i * k);
+        total += clock() - start;
+        reps++;
+    }
+
+    return 1000.0 * total / CLOCKS_PER_SEC / reps;
+}
+
+/**
+ * Porównuje wyliczanie wartości wielomianu ::PolyEval, ::PolyProgramEval
+ * i funkcją wypisaną przez ::PolyEmitC, skompilowaną z -O2 kompilatorem
+ * systemu.
+ */
+static void EmitCBench(void)
+{
+    const struct
+    {
+        size_t vars;
+        size_t size;
+    } shapes[] = {{1, 64}, {2, 16}, {3, 8}, {4, 4}};
+    const size_t n = 1 << 12;
+
+    char dir[] = "/tmp/poly_emit_XXXXXX";
+    if (mkdtemp(dir) == NULL)
+    {
+        printf("EmitCBench: cannot create a temporary directory\n");
+        return;
+    }
+
+    printf("%-4s %6s %10s %10s %10s\n", "vars", "size", "Eval [ms]",
+           "Prog [ms]", "Emit [ms]");
+    for (size_t s = 0; s < SIZE(shapes); s++)
+    {
+        Poly p = SparsePoly(shapes[s].vars, shapes[s].size, 64);
+        void *handle = NULL;
+        EmittedFunction fn = EmitCLoad(&p, dir, s, &handle);
+        if (fn == NULL)
+        {
+            printf("EmitCBench: cannot compile the emitted code\n");
+            if (handle != NULL)
+                dlclose(handle);
+            PolyDestroy(&p);
+            break;
+        }
+
+        PolyProgram prog = PolyProgramCompile(&p);
+        size_t k = shapes[s].vars;
+        poly_coeff_t *xs = malloc(n * k * sizeof(poly_coeff_t));
+        poly_coeff_t *out = malloc(n * sizeof(poly_coeff_t));
+        CHECK_PTR(xs);
+        CHECK_PTR(out);
+        for (size_t i = 0; i < n * k; i++)
+            xs[i] = rand() % 10 * 2 - 9;
+
+        double eval_time = ProgramBenchTime(PROGRAM_BENCH_EVAL, &p, &prog, k,
+                                            n, xs, out);
+        double prog_time = ProgramBenchTime(PROGRAM_BENCH_PROG, &p, &prog, k,
+                                            n, xs, out);
+        double emit_time = EmitCTime(fn, k, n, xs, out);
+        for (size_t i = 0; i < n; i++)
+            if (out[i] != PolyEval(&p, k, xs + i * k))
+            {
+                printf("PolyEmitC: wrong result\n");
+                break;
+            }
+
+        printf("%-4zu %6zu %10.4f %10.4f %10.4f\n", shapes[s].vars,
+               shapes[s].size, eval_time, prog_time, emit_time);
+
+        free(xs);
+        free(out);
+        dlclose(handle);
+        PolyProgramDestroy(&prog);
+        PolyDestroy(&p);
+    }
+
+    remove(dir);
+}
+
+/** Pozycja listy benchmarków */
+typedef struct
+{
+    /** nazwa benchmarku */
+    const char *name;
+    /** funkcja wykonująca benchmark */
+    void (*function)(void);
+} BenchListItem;
+
+/** Tworzy pozycję listy benchmarków */
+#define BENCH(b) {#b, b}
+
+/** Lista benchmarków */
+static const BenchListItem bench_list[] = {BENCH(MonosSortBench),
+                                           BENCH(DenseMulBench),
+                                           BENCH(KroneckerMulBench),
+                                           BENCH(ParMulBench),
+                                           BENCH(SqrBench),
+                                           BENCH(MulAddBench),
+                                           BENCH(ArenaBench),
+                                           BENCH(MonosPoolBench),
+                                           BENCH(CowBench),
+                                           BENCH(InternBench),
+                                           BENCH(MetaBench),
+                                           BENCH(AddBench),
+                                           BENCH(EvalBench),
+                                           BENCH(EvalBatchBench),
+                                           BENCH(ProgramBench),
+                                           BENCH(EmitCBench),
+                                           BENCH(OverflowBench)};
+
+/**
+ * Uruchamia benchmarki.
+ * @param[in] argc : liczba parametrów
+ * @param[in] argv : parametry, opcjonalnie nazwa benchmarku
+ * @return kod wyjścia programu
+ */
+int main(int argc, char *argv[])
+{
+    srand(42);
+
+    bool found = false;
+    for (size_t i = 0; i < SIZE(bench_list); i++)
+    {
+        if (argc < 2 || strcmp(argv[1], bench_list[i].name) == 0)
+        {
+            printf("== %s ==\n", bench_list[i].name);
+            bench_list[i].function();
+            found = true;
+        }
+    }
+
+    return found ? 0 : 2;
+}
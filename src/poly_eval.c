@@ -0,0 +1,917 @@
+/** @file
+  Implementacja wyliczania wartości wielomianów rzadkich wielu zmiennych
+  w wielu punktach
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_eval.h"
+#include "poly.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_lib.h"
+#include "poly_overflow.h"
+#include "poly_pool.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(POLY_EVAL_AVX2) && defined(__x86_64__)
+#include <immintrin.h>
+/** Czy biblioteka zawiera wyliczanie w grupach punktów instrukcjami AVX2 */
+#define EVAL_HAS_AVX2 1
+#else
+/** Czy biblioteka zawiera wyliczanie w grupach punktów instrukcjami AVX2 */
+#define EVAL_HAS_AVX2 0
+#endif
+
+/**
+ * Typ, w którym wykonywane są obliczenia na wartościach w grupach punktów.
+ * Arytmetyka bez znaku ma zdefiniowane przepełnienie, a jej wynik modulo
+ * @f$2^{64}@f$ jest taki sam jak wynik ::PolyEval.
+ */
+typedef unsigned long lane_coeff_t;
+
+/**
+ * Zapisuje w @p res iloczyny odpowiadających sobie wartości @p a i @p b.
+ * @param[out] res : iloczyny, mogą zajmować miejsce czynników
+ * @param[in] a : czynniki @f$a@f$
+ * @param[in] b : czynniki @f$b@f$
+ */
+static inline void LanesMul(lane_coeff_t res[], const lane_coeff_t a[],
+                            const lane_coeff_t b[])
+{
+    for (size_t l = 0; l < EVAL_LANES; l++)
+        res[l] = a[l] * b[l];
+}
+
+/**
+ * Mnoży wartości @p x_pow przez odpowiadające im wartości @p x_val
+ * podniesione do potęgi @p exp.
+ * @param[in,out] x_pow : mnożone wartości
+ * @param[in] x_val : podstawy potęg
+ * @param[in] exp : wykładnik
+ */
+static void LanesMulPower(lane_coeff_t x_pow[], const lane_coeff_t x_val[],
+                          poly_exp_t exp)
+{
+    lane_coeff_t base[EVAL_LANES];
+    memcpy(base, x_val, sizeof(base));
+
+    // wykładnik jest wspólny dla wszystkich punktów, więc potęgowanie przez
+    // podnoszenie do kwadratu przebiega dla nich tak samo
+    while (exp > 0)
+    {
+        if (exp % 2 == 1)
+            LanesMul(x_pow, x_pow, base);
+
+        exp /= 2;
+        if (exp > 0)
+            LanesMul(base, base, base);
+    }
+}
+
+/**
+ * Sprawdza, czy wszystkie wartości są zerami.
+ * @param[in] vals : wartości
+ * @return czy wszystkie wartości są zerami
+ */
+static bool LanesAreZero(const lane_coeff_t vals[])
+{
+    lane_coeff_t any = 0;
+    for (size_t l = 0; l < EVAL_LANES; l++)
+        any |= vals[l];
+
+    return any == 0;
+}
+
+/**
+ * Wylicza wartości wielomianu @f$p@f$, którego zmienne mają indeksy od
+ * @p idx, w grupie co najwyżej ::EVAL_LANES punktów, tak jak ::PolyEval.
+ * Wartości dla nieistniejących punktów grupy są nieokreślone.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] xs : wartości zmiennych w punktach grupy
+ * @param[in] lanes : liczba punktów grupy
+ * @param[in] idx : indeks zmiennej wielomianu @f$p@f$
+ * @param[out] res : wartości wielomianu w punktach grupy
+ */
+static void PolyEvalLanes(const Poly *p, size_t k, const poly_coeff_t xs[],
+                          size_t lanes, size_t idx, lane_coeff_t res[])
+{
+    if (PolyIsCoeff(p))
+    {
+        for (size_t l = 0; l < EVAL_LANES; l++)
+            res[l] = (lane_coeff_t)p->coeff;
+        return;
+    }
+
+    // zmienna bez wartości jest zerem, tak jak w nieistniejących punktach
+    lane_coeff_t x_val[EVAL_LANES];
+    for (size_t l = 0; l < EVAL_LANES; l++)
+        x_val[l] = idx < k && l < lanes ? (lane_coeff_t)xs[l * k + idx] : 0;
+
+    lane_coeff_t x_pow[EVAL_LANES];
+    lane_coeff_t coeff_val[EVAL_LANES];
+    for (size_t l = 0; l < EVAL_LANES; l++)
+    {
+        res[l] = 0;
+        x_pow[l] = 1;
+    }
+
+    // kolejność jak w ::PolyEval: od najmniejszego wykładnika, aż potęgi we
+    // wszystkich punktach się wyzerują
+    poly_exp_t prev_exp = 0;
+    for (size_t i = p->size; i-- > 0;)
+    {
+        LanesMulPower(x_pow, x_val, p->arr[i].exp - prev_exp);
+        if (LanesAreZero(x_pow))
+            break;
+
+        PolyEvalLanes(&p->arr[i].p, k, xs, lanes, idx + 1, coeff_val);
+        LanesMul(coeff_val, coeff_val, x_pow);
+        for (size_t l = 0; l < EVAL_LANES; l++)
+            res[l] += coeff_val[l];
+        prev_exp = p->arr[i].exp;
+    }
+}
+
+/** Czy ::PolyEvalBatch może używać instrukcji AVX2 */
+static atomic_bool is_avx2_enabled = true;
+
+#if EVAL_HAS_AVX2
+
+/** Liczba wektorów AVX2 po cztery wartości na grupę punktów */
+#define AVX2_VECS (EVAL_LANES / 4)
+
+static_assert(EVAL_LANES % 4 == 0, "grupa punktów musi wypełniać wektory");
+
+/**
+ * Mnoży odpowiadające sobie 64-bitowe wartości wektorów modulo
+ * @f$2^{64}@f$. AVX2 nie ma takiego mnożenia, więc iloczyn jest składany
+ * z trzech iloczynów połówek 32-bitowych; iloczyn starszych połówek nie
+ * wpływa na wynik.
+ * @param[in] a : czynniki @f$a@f$
+ * @param[in] b : czynniki @f$b@f$
+ * @return iloczyny
+ */
+__attribute__((target("avx2"))) static inline __m256i Avx2Mul(__m256i a,
+                                                              __m256i b)
+{
+    __m256i lo = _mm256_mul_epu32(a, b);
+    __m256i cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+        _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+
+    return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+}
+
+/**
+ * Działa jak ::PolyEvalLanes, ale wartości punktów grupy trzyma
+ * w wektorach AVX2.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] xs : wartości zmiennych w punktach grupy
+ * @param[in] lanes : liczba punktów grupy
+ * @param[in] idx : indeks zmiennej wielomianu @f$p@f$
+ * @param[out] res : wartości wielomianu w punktach grupy
+ */
+__attribute__((target("avx2"))) static void
+PolyEvalLanesAvx2(const Poly *p, size_t k, const poly_coeff_t xs[],
+                  size_t lanes, size_t idx, __m256i res[])
+{
+    if (PolyIsCoeff(p))
+    {
+        for (size_t v = 0; v < AVX2_VECS; v++)
+            res[v] = _mm256_set1_epi64x(p->coeff);
+        return;
+    }
+
+    lane_coeff_t x_lanes[EVAL_LANES];
+    for (size_t l = 0; l < EVAL_LANES; l++)
+        x_lanes[l] = idx < k && l < lanes ? (lane_coeff_t)xs[l * k + idx] : 0;
+
+    __m256i x_val[AVX2_VECS];
+    __m256i x_pow[AVX2_VECS];
+    __m256i coeff_val[AVX2_VECS];
+    for (size_t v = 0; v < AVX2_VECS; v++)
+    {
+        x_val[v] = _mm256_loadu_si256((const __m256i *)(x_lanes + 4 * v));
+        x_pow[v] = _mm256_set1_epi64x(1);
+        res[v] = _mm256_setzero_si256();
+    }
+
+    poly_exp_t prev_exp = 0;
+    for (size_t i = p->size; i-- > 0;)
+    {
+        __m256i base[AVX2_VECS];
+        memcpy(base, x_val, sizeof(base));
+        for (poly_exp_t exp = p->arr[i].exp - prev_exp; exp > 0;)
+        {
+            for (size_t v = 0; v < AVX2_VECS && exp % 2 == 1; v++)
+                x_pow[v] = Avx2Mul(x_pow[v], base[v]);
+
+            exp /= 2;
+            for (size_t v = 0; v < AVX2_VECS && exp > 0; v++)
+                base[v] = Avx2Mul(base[v], base[v]);
+        }
+
+        __m256i any = x_pow[0];
+        for (size_t v = 1; v < AVX2_VECS; v++)
+            any = _mm256_or_si256(any, x_pow[v]);
+        if (_mm256_testz_si256(any, any))
+            break;
+
+        PolyEvalLanesAvx2(&p->arr[i].p, k, xs, lanes, idx + 1, coeff_val);
+        for (size_t v = 0; v < AVX2_VECS; v++)
+            res[v] = _mm256_add_epi64(res[v], Avx2Mul(coeff_val[v], x_pow[v]));
+        prev_exp = p->arr[i].exp;
+    }
+}
+
+/**
+ * Wylicza wartości wielomianu w grupie punktów funkcją
+ * ::PolyEvalLanesAvx2.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] xs : wartości zmiennych w punktach grupy
+ * @param[in] lanes : liczba punktów grupy
+ * @param[out] res : wartości wielomianu w punktach grupy
+ */
+__attribute__((target("avx2"))) static void
+EvalGroupAvx2(const Poly *p, size_t k, const poly_coeff_t xs[], size_t lanes,
+              lane_coeff_t res[])
+{
+    __m256i vals[AVX2_VECS];
+    PolyEvalLanesAvx2(p, k, xs, lanes, 0, vals);
+    for (size_t v = 0; v < AVX2_VECS; v++)
+        _mm256_storeu_si256((__m256i *)(res + 4 * v), vals[v]);
+}
+
+#endif
+
+void PolySetEvalAvx2(bool enabled)
+{
+    atomic_store_explicit(&is_avx2_enabled, enabled, memory_order_relaxed);
+}
+
+bool PolyGetEvalAvx2(void)
+{
+#if EVAL_HAS_AVX2
+    return atomic_load_explicit(&is_avx2_enabled, memory_order_relaxed) &&
+           __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+/**
+ * Zlicza instrukcje programu wyliczającego wartość wielomianu @f$p@f$
+ * zmiennej @f$x_l@f$ (::PolyProgramCompile).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] level : indeks @f$l@f$ zmiennej wielomianu
+ * @param[in,out] regs : liczba potrzebnych rejestrów
+ * @return liczba instrukcji
+ */
+static size_t ProgramCount(const Poly *p, size_t level, size_t *regs)
+{
+    if (level + 1 > *regs)
+        *regs = level + 1;
+
+    if (PolyIsCoeff(p))
+        return 1;
+
+    // po instrukcji na każdy jednomian i mnożenie przez potęgę po ostatnim
+    // o dodatnim wykładniku
+    size_t count = p->size + (p->arr[p->size - 1].exp > 0 ? 1 : 0);
+    for (size_t i = 0; i < p->size; i++)
+        if (!PolyIsCoeff(&p->arr[i].p))
+            count += ProgramCount(&p->arr[i].p, level + 1, regs);
+
+    return count;
+}
+
+/**
+ * Dopisuje do programu instrukcję.
+ * @param[in,out] prog : program
+ * @param[in] op : rodzaj instrukcji
+ * @param[in] level : indeks rejestru i zmiennej
+ * @param[in] exp : wykładnik
+ * @param[in] coeff : stała
+ */
+static void ProgramPush(PolyProgram *prog, PolyProgramOp op, size_t level,
+                        poly_exp_t exp, poly_coeff_t coeff)
+{
+    prog->code[prog->size++] = (PolyInstr){.coeff = coeff,
+                                           .exp = exp,
+                                           .level = (uint32_t)level,
+                                           .op = op};
+}
+
+/**
+ * Dopisuje do programu instrukcje zapisujące w rejestrze @f$r_l@f$ wartość
+ * wielomianu @f$p@f$ zmiennej @f$x_l@f$, schematem Hornera.
+ * @param[in,out] prog : program
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] level : indeks @f$l@f$ zmiennej wielomianu
+ */
+static void ProgramEmit(PolyProgram *prog, const Poly *p, size_t level)
+{
+    if (PolyIsCoeff(p))
+    {
+        ProgramPush(prog, PROG_CONST, level, 0, p->coeff);
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; i++)
+    {
+        const Poly *coeff = &p->arr[i].p;
+        poly_exp_t gap = i == 0 ? 0 : p->arr[i - 1].exp - p->arr[i].exp;
+
+        if (PolyIsCoeff(coeff))
+        {
+            ProgramPush(prog, i == 0 ? PROG_CONST : PROG_HORNER_CONST, level,
+                        gap, coeff->coeff);
+        }
+        else
+        {
+            // współczynnik korzysta tylko z rejestrów dalszych poziomów
+            ProgramEmit(prog, coeff, level + 1);
+            ProgramPush(prog, i == 0 ? PROG_MOVE : PROG_HORNER, level, gap, 0);
+        }
+    }
+
+    // po ostatnim jednomianie zostaje potęga o jego wykładniku
+    if (p->arr[p->size - 1].exp > 0)
+        ProgramPush(prog, PROG_MUL_POW, level, p->arr[p->size - 1].exp, 0);
+}
+
+PolyProgram PolyProgramCompile(const Poly *p)
+{
+    assert(p != NULL);
+
+    PolyProgram prog = {.code = NULL, .size = 0, .regs = 0};
+    size_t count = ProgramCount(p, 0, &prog.regs);
+    prog.code = PolyMalloc(count * sizeof(PolyInstr));
+    ProgramEmit(&prog, p, 0);
+    assert(prog.size == count);
+
+    return prog;
+}
+
+void PolyProgramDestroy(PolyProgram *prog)
+{
+    assert(prog != NULL);
+
+    PolyFree(prog->code);
+    *prog = (PolyProgram){.code = NULL, .size = 0, .regs = 0};
+}
+
+/**
+ * Liczy potęgę o wykładniku z instrukcji programu. Luki między wykładnikami
+ * kolejnych jednomianów są najczęściej równe 1.
+ * @param[in] x : podstawa
+ * @param[in] exp : wykładnik
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ * @return @f$x^\mathrm{exp}@f$
+ */
+static inline poly_coeff_t ProgramPower(poly_coeff_t x, poly_exp_t exp,
+                                        bool is_checked)
+{
+    if (exp == 1)
+        return x;
+
+    return is_checked ? PowerChecked(x, exp) : Power(x, exp);
+}
+
+/**
+ * Liczy @f$a \cdot b + c@f$ dla instrukcji programu.
+ * @param[in] a : czynnik @f$a@f$
+ * @param[in] b : czynnik @f$b@f$
+ * @param[in] c : składnik @f$c@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ * @return @f$a \cdot b + c@f$
+ */
+static inline poly_coeff_t ProgramMulAdd(poly_coeff_t a, poly_coeff_t b,
+                                         poly_coeff_t c, bool is_checked)
+{
+    if (is_checked)
+        return CoeffAdd(CoeffMul(a, b), c);
+
+    // liczby bez znaku mają zdefiniowane przepełnienie
+    return (poly_coeff_t)((unsigned long)a * (unsigned long)b +
+                          (unsigned long)c);
+}
+
+poly_coeff_t PolyProgramEval(const PolyProgram *prog, size_t k,
+                             const poly_coeff_t x[])
+{
+    assert(prog != NULL && (k == 0 || x != NULL));
+
+    // bez sprawdzania przepełnień pętla nie rozgałęzia się na nich
+    bool is_checked = PolyOverflowIsChecked();
+    PolyArenaMark mark = PolyScratchMark();
+    poly_coeff_t *r =
+        PolyArenaAlloc(PolyScratch(), 2 * prog->regs * sizeof(poly_coeff_t));
+
+    // zmienna bez wartości jest zerem
+    poly_coeff_t *x_vals = r + prog->regs;
+    for (size_t l = 0; l < prog->regs; l++)
+        x_vals[l] = l < k ? x[l] : 0;
+
+    const PolyInstr *end = prog->code + prog->size;
+    for (const PolyInstr *in = prog->code; in < end; in++)
+    {
+        size_t l = in->level;
+        switch (in->op)
+        {
+        case PROG_CONST:
+            r[l] = in->coeff;
+            break;
+        case PROG_MOVE:
+            r[l] = r[l + 1];
+            break;
+        case PROG_HORNER:
+            r[l] = ProgramMulAdd(
+                r[l], ProgramPower(x_vals[l], in->exp, is_checked), r[l + 1],
+                is_checked);
+            break;
+        case PROG_HORNER_CONST:
+            r[l] = ProgramMulAdd(
+                r[l], ProgramPower(x_vals[l], in->exp, is_checked), in->coeff,
+                is_checked);
+            break;
+        case PROG_MUL_POW:
+            r[l] = ProgramMulAdd(
+                r[l], ProgramPower(x_vals[l], in->exp, is_checked), 0,
+                is_checked);
+            break;
+        }
+    }
+
+    poly_coeff_t res = r[0];
+    PolyScratchRelease(mark);
+
+    return res;
+}
+
+/**
+ * Wylicza programem wartości wielomianu w grupie co najwyżej ::EVAL_LANES
+ * punktów. Wartości dla nieistniejących punktów grupy są nieokreślone.
+ * @param[in] prog : program
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] xs : wartości zmiennych w punktach grupy
+ * @param[in] lanes : liczba punktów grupy
+ * @param[in,out] r : rejestry, po ::EVAL_LANES wartości na poziom
+ * @param[in,out] x_vals : miejsce na wartości zmiennych, jak @p r
+ * @param[out] res : wartości wielomianu w punktach grupy
+ */
+static void ProgramEvalLanes(const PolyProgram *prog, size_t k,
+                             const poly_coeff_t xs[], size_t lanes,
+                             lane_coeff_t r[][EVAL_LANES],
+                             lane_coeff_t x_vals[][EVAL_LANES],
+                             lane_coeff_t res[])
+{
+    // zmienna bez wartości jest zerem, tak jak w nieistniejących punktach
+    for (size_t l = 0; l < prog->regs; l++)
+        for (size_t j = 0; j < EVAL_LANES; j++)
+            x_vals[l][j] = l < k && j < lanes ? (lane_coeff_t)xs[j * k + l] : 0;
+
+    const PolyInstr *end = prog->code + prog->size;
+    for (const PolyInstr *in = prog->code; in < end; in++)
+    {
+        size_t l = in->level;
+        switch (in->op)
+        {
+        case PROG_CONST:
+            for (size_t j = 0; j < EVAL_LANES; j++)
+                r[l][j] = (lane_coeff_t)in->coeff;
+            break;
+        case PROG_MOVE:
+            memcpy(r[l], r[l + 1], sizeof(r[l]));
+            break;
+        case PROG_HORNER:
+            LanesMulPower(r[l], x_vals[l], in->exp);
+            for (size_t j = 0; j < EVAL_LANES; j++)
+                r[l][j] += r[l + 1][j];
+            break;
+        case PROG_HORNER_CONST:
+            LanesMulPower(r[l], x_vals[l], in->exp);
+            for (size_t j = 0; j < EVAL_LANES; j++)
+                r[l][j] += (lane_coeff_t)in->coeff;
+            break;
+        case PROG_MUL_POW:
+            LanesMulPower(r[l], x_vals[l], in->exp);
+            break;
+        }
+    }
+
+    memcpy(res, r[0], sizeof(r[0]));
+}
+
+/**
+ * Sprowadza liczbę do przedziału @f$[0, mod)@f$.
+ * @param[in] c : liczba
+ * @param[in] mod : moduł
+ * @return @f$c \bmod mod@f$
+ */
+static uint64_t CoeffMod(poly_coeff_t c, uint32_t mod)
+{
+    poly_coeff_t rem = c % (poly_coeff_t)mod;
+
+    return (uint64_t)(rem < 0 ? rem + (poly_coeff_t)mod : rem);
+}
+
+/**
+ * Liczy @f$x^\mathrm{exp} \bmod mod@f$ przez podnoszenie do kwadratu.
+ * @param[in] x : podstawa z przedziału @f$[0, mod)@f$
+ * @param[in] exp : wykładnik
+ * @param[in] mod : moduł
+ * @return @f$x^\mathrm{exp} \bmod mod@f$
+ */
+static uint64_t PowerMod(uint64_t x, poly_exp_t exp, uint32_t mod)
+{
+    uint64_t res = 1 % mod;
+    while (exp > 0)
+    {
+        if (exp % 2 == 1)
+            res = res * x % mod;
+
+        x = x * x % mod;
+        exp /= 2;
+    }
+
+    return res;
+}
+
+uint32_t PolyProgramEvalMod(const PolyProgram *prog, size_t k,
+                            const poly_coeff_t x[], uint32_t mod)
+{
+    assert(prog != NULL && (k == 0 || x != NULL) && mod > 0);
+
+    PolyArenaMark mark = PolyScratchMark();
+    uint64_t *r = PolyArenaAlloc(PolyScratch(), prog->regs * sizeof(uint64_t));
+    uint64_t *x_mod =
+        PolyArenaAlloc(PolyScratch(), prog->regs * sizeof(uint64_t));
+    for (size_t l = 0; l < prog->regs; l++)
+        x_mod[l] = l < k ? CoeffMod(x[l], mod) : 0;
+
+    // wartości rejestrów są mniejsze od mod < 2^32, więc iloczyn dwóch z nich
+    // powiększony o trzecią mieści się w uint64_t
+    const PolyInstr *end = prog->code + prog->size;
+    for (const PolyInstr *in = prog->code; in < end; in++)
+    {
+        size_t l = in->level;
+        switch (in->op)
+        {
+        case PROG_CONST:
+            r[l] = CoeffMod(in->coeff, mod);
+            break;
+        case PROG_MOVE:
+            r[l] = r[l + 1];
+            break;
+        case PROG_HORNER:
+            r[l] = (r[l] * PowerMod(x_mod[l], in->exp, mod) + r[l + 1]) % mod;
+            break;
+        case PROG_HORNER_CONST:
+            r[l] = (r[l] * PowerMod(x_mod[l], in->exp, mod) +
+                    CoeffMod(in->coeff, mod)) %
+                   mod;
+            break;
+        case PROG_MUL_POW:
+            r[l] = r[l] * PowerMod(x_mod[l], in->exp, mod) % mod;
+            break;
+        }
+    }
+
+    uint32_t res = (uint32_t)r[0];
+    PolyScratchRelease(mark);
+
+    return res;
+}
+
+/**
+ * Wspólne dane zadań puli wykonujących ::PolyEvalBatch
+ * i ::PolyProgramEvalBatch
+ */
+typedef struct
+{
+    const Poly *p;           ///< wielomian, jeśli nie ma programu
+    const PolyProgram *prog; ///< program wielomianu albo NULL
+    size_t k;                ///< liczba wartości w każdym punkcie
+    size_t n_points;         ///< liczba punktów
+    size_t groups;           ///< liczba grup po ::EVAL_LANES punktów
+    const poly_coeff_t *xs;  ///< wartości zmiennych w kolejnych punktach
+    poly_coeff_t *out;       ///< wartości wielomianu
+    size_t chunks;           ///< liczba fragmentów zbioru punktów
+    bool is_avx2;            ///< czy grupy są wyliczane instrukcjami AVX2
+    bool is_checked;         ///< czy sprawdzać przepełnienia
+} EvalJob;
+
+/**
+ * Wylicza wartości wielomianu w grupach punktów @p idx -tego fragmentu.
+ * @param[in,out] arg : dane wyliczania typu ::EvalJob
+ * @param[in] idx : indeks fragmentu
+ */
+static void EvalChunkTask(void *arg, size_t idx)
+{
+    EvalJob *job = arg;
+    size_t begin = idx * job->groups / job->chunks;
+    size_t end = (idx + 1) * job->groups / job->chunks;
+
+    // grupy punktów nie sprawdzają przepełnień, więc w trybie sprawdzania
+    // wartości są wyliczane punkt po punkcie funkcjami, które to robią
+    if (job->is_checked)
+    {
+        size_t last = end * EVAL_LANES < job->n_points ? end * EVAL_LANES
+                                                       : job->n_points;
+        for (size_t i = begin * EVAL_LANES; i < last; i++)
+        {
+            const poly_coeff_t *x = job->k == 0 ? NULL : job->xs + i * job->k;
+            job->out[i] = job->prog != NULL
+                              ? PolyProgramEval(job->prog, job->k, x)
+                              : PolyEval(job->p, job->k, x);
+        }
+        return;
+    }
+
+    // rejestry programu są wspólne dla grup fragmentu
+    PolyArenaMark mark = PolyScratchMark();
+    lane_coeff_t(*r)[EVAL_LANES] = NULL;
+    lane_coeff_t(*x_vals)[EVAL_LANES] = NULL;
+    if (job->prog != NULL)
+    {
+        size_t regs_size = job->prog->regs * sizeof(*r);
+        r = PolyArenaAlloc(PolyScratch(), regs_size);
+        x_vals = PolyArenaAlloc(PolyScratch(), regs_size);
+    }
+
+    lane_coeff_t res[EVAL_LANES];
+    for (size_t g = begin; g < end; g++)
+    {
+        size_t first = g * EVAL_LANES;
+        size_t lanes = job->n_points - first < EVAL_LANES
+                           ? job->n_points - first
+                           : EVAL_LANES;
+
+        const poly_coeff_t *xs = job->k == 0 ? NULL : job->xs + first * job->k;
+        if (job->prog != NULL)
+            ProgramEvalLanes(job->prog, job->k, xs, lanes, r, x_vals, res);
+#if EVAL_HAS_AVX2
+        else if (job->is_avx2)
+            EvalGroupAvx2(job->p, job->k, xs, lanes, res);
+#endif
+        else
+            PolyEvalLanes(job->p, job->k, xs, lanes, 0, res);
+        for (size_t l = 0; l < lanes; l++)
+            job->out[first + l] = (poly_coeff_t)res[l];
+    }
+
+    PolyScratchRelease(mark);
+}
+
+/**
+ * Wylicza wartości wielomianu we wszystkich punktach zadania, dzieląc duże
+ * zbiory punktów między wątki puli.
+ * @param[in,out] job : zadanie
+ */
+static void EvalBatchRun(EvalJob *job)
+{
+    job->groups = (job->n_points + EVAL_LANES - 1) / EVAL_LANES;
+    job->chunks = 1;
+    job->is_checked = PolyOverflowIsChecked();
+
+    // punkty są od siebie niezależne, a wielomian jest tylko czytany
+    if (job->n_points >= EVAL_PAR_MIN_POINTS && PoolIsAvailable())
+    {
+        job->chunks = PolyGetThreads();
+        if (job->chunks > job->groups)
+            job->chunks = job->groups;
+
+        PoolRun(EvalChunkTask, job, job->chunks);
+    }
+    else
+    {
+        EvalChunkTask(job, 0);
+    }
+}
+
+void PolyEvalBatch(const Poly *p, size_t k, size_t n_points,
+                   const poly_coeff_t xs[], poly_coeff_t out[])
+{
+    assert(p != NULL && (n_points == 0 || out != NULL));
+    assert(k == 0 || n_points == 0 || xs != NULL);
+
+    EvalJob job = {.p = p,
+                   .prog = NULL,
+                   .k = k,
+                   .n_points = n_points,
+                   .xs = xs,
+                   .out = out,
+                   .is_avx2 = PolyGetEvalAvx2()};
+    EvalBatchRun(&job);
+}
+
+void PolyProgramEvalBatch(const PolyProgram *prog, size_t k, size_t n_points,
+                          const poly_coeff_t xs[], poly_coeff_t out[])
+{
+    assert(prog != NULL && (n_points == 0 || out != NULL));
+    assert(k == 0 || n_points == 0 || xs != NULL);
+
+    EvalJob job = {.p = NULL,
+                   .prog = prog,
+                   .k = k,
+                   .n_points = n_points,
+                   .xs = xs,
+                   .out = out};
+    EvalBatchRun(&job);
+}
+
+/** Potęga zmiennej używana przez program, wyliczana przez ::PolyEmitC */
+typedef struct
+{
+    uint32_t level; ///< indeks zmiennej
+    poly_exp_t exp; ///< wykładnik
+} EmitPower;
+
+/**
+ * Porównuje potęgi zmiennych leksykograficznie po indeksie zmiennej
+ * i wykładniku.
+ * @param[in] a : potęga typu ::EmitPower
+ * @param[in] b : potęga typu ::EmitPower
+ * @return wynik porównania w konwencji qsort
+ */
+static int EmitPowerCmp(const void *a, const void *b)
+{
+    const EmitPower *pa = a;
+    const EmitPower *pb = b;
+    if (pa->level != pb->level)
+        return pa->level < pb->level ? -1 : 1;
+
+    return (pa->exp > pb->exp) - (pa->exp < pb->exp);
+}
+
+/**
+ * Wypisuje nazwę zmiennej wygenerowanego kodu trzymającej potęgę
+ * @f$x_l^\mathrm{exp}@f$.
+ * @param[in] out : strumień
+ * @param[in] level : indeks @f$l@f$ zmiennej
+ * @param[in] exp : wykładnik, dodatni
+ */
+static void EmitPowerName(FILE *out, uint32_t level, poly_exp_t exp)
+{
+    if (exp == 1)
+        fprintf(out, "x%" PRIu32, level);
+    else
+        fprintf(out, "x%" PRIu32 "_%d", level, exp);
+}
+
+/**
+ * Wypisuje definicje potęg zmiennej @f$x_l@f$ o wykładnikach @p powers.
+ * Najpierw są kolejne kwadraty @f$x_l^{2^j}@f$, wspólne dla wszystkich
+ * wykładników, a potem iloczyny kwadratów odpowiadające bitom wykładników,
+ * które nie są potęgami 2.
+ * @param[in] out : strumień
+ * @param[in] powers : różne potęgi zmiennej, rosnąco
+ * @param[in] count : liczba potęg
+ */
+static void EmitPowers(FILE *out, const EmitPower powers[], size_t count)
+{
+    uint32_t level = powers[0].level;
+    poly_exp_t max_exp = powers[count - 1].exp;
+
+    fprintf(out, "    const unsigned long x%" PRIu32 " = x[%" PRIu32 "];\n",
+            level, level);
+    for (poly_exp_t sq = 2; sq <= max_exp; sq *= 2)
+    {
+        fprintf(out, "    const unsigned long ");
+        EmitPowerName(out, level, sq);
+        fprintf(out, " = ");
+        EmitPowerName(out, level, sq / 2);
+        fprintf(out, " * ");
+        EmitPowerName(out, level, sq / 2);
+        fprintf(out, ";\n");
+
+        // bez przepełnienia przy wykładniku bliskim INT_MAX
+        if (sq > max_exp / 2)
+            break;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        poly_exp_t exp = powers[i].exp;
+        if ((exp & (exp - 1)) == 0)
+            continue;
+
+        fprintf(out, "    const unsigned long ");
+        EmitPowerName(out, level, exp);
+        fprintf(out, " =");
+        for (poly_exp_t bit = 1 << 30; bit > 0; bit /= 2)
+        {
+            if ((exp & bit) == 0)
+                continue;
+
+            fprintf(out, " ");
+            EmitPowerName(out, level, bit);
+            fprintf(out, (exp & (bit - 1)) == 0 ? ";\n" : " *");
+        }
+    }
+}
+
+/**
+ * Wypisuje stałą wygenerowanego kodu jako liczbę typu unsigned long, ze
+ * znakiem minus dla liczb ujemnych.
+ * @param[in] out : strumień
+ * @param[in] prefix : napis przed stałą, gdy jest nieujemna
+ * @param[in] neg_prefix : napis przed stałą, gdy jest ujemna
+ * @param[in] c : stała
+ */
+static void EmitCoeff(FILE *out, const char *prefix, const char *neg_prefix,
+                      poly_coeff_t c)
+{
+    // wartość bezwzględna liczona bez znaku jest poprawna także dla LONG_MIN
+    if (c < 0)
+        fprintf(out, "%s%luUL", neg_prefix, 0UL - (unsigned long)c);
+    else
+        fprintf(out, "%s%luUL", prefix, (unsigned long)c);
+}
+
+void PolyEmitC(const Poly *p, FILE *out, const char *fn_name)
+{
+    assert(p != NULL && out != NULL && fn_name != NULL);
+
+    PolyProgram prog = PolyProgramCompile(p);
+
+    // potęgi używane przez instrukcje, bez powtórzeń
+    EmitPower *powers = PolyMalloc((prog.size + 1) * sizeof(EmitPower));
+    size_t count = 0;
+    for (size_t i = 0; i < prog.size; i++)
+        if (prog.code[i].exp > 0)
+            powers[count++] = (EmitPower){.level = prog.code[i].level,
+                                          .exp = prog.code[i].exp};
+    qsort(powers, count, sizeof(EmitPower), EmitPowerCmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++)
+        if (unique == 0 || EmitPowerCmp(&powers[unique - 1], &powers[i]) != 0)
+            powers[unique++] = powers[i];
+
+    // arytmetyka bez znaku ma określone przepełnienia, równe przepełnieniom
+    // ::PolyEval
+    fprintf(out, "long %s(const long x[])\n{\n", fn_name);
+    if (unique == 0)
+        fprintf(out, "    (void)x;\n");
+    for (size_t begin = 0, end = 0; begin < unique; begin = end)
+    {
+        while (end < unique && powers[end].level == powers[begin].level)
+            end++;
+        EmitPowers(out, powers + begin, end - begin);
+    }
+
+    fprintf(out, "    unsigned long r0");
+    for (size_t l = 1; l < prog.regs; l++)
+        fprintf(out, ", r%zu", l);
+    fprintf(out, ";\n");
+
+    for (size_t i = 0; i < prog.size; i++)
+    {
+        const PolyInstr *in = &prog.code[i];
+        uint32_t l = in->level;
+        fprintf(out, "    r%" PRIu32 " = ", l);
+        if (in->op != PROG_CONST && in->op != PROG_MOVE)
+        {
+            fprintf(out, "r%" PRIu32 " * ", l);
+            EmitPowerName(out, l, in->exp);
+        }
+
+        switch (in->op)
+        {
+        case PROG_CONST:
+            EmitCoeff(out, "", "-", in->coeff);
+            break;
+        case PROG_MOVE:
+            fprintf(out, "r%" PRIu32, l + 1);
+            break;
+        case PROG_HORNER:
+            fprintf(out, " + r%" PRIu32, l + 1);
+            break;
+        case PROG_HORNER_CONST:
+            EmitCoeff(out, " + ", " - ", in->coeff);
+            break;
+        case PROG_MUL_POW:
+            break;
+        }
+        fprintf(out, ";\n");
+    }
+
+    fprintf(out, "    return (long)r0;\n}\n");
+
+    PolyFree(powers);
+    PolyProgramDestroy(&prog);
+}
@@ -0,0 +1,186 @@
+/** @file
+  Interfejs wyliczania wartości wielomianów rzadkich wielu zmiennych w wielu
+  punktach
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_EVAL_H__
+#define __POLY_EVAL_H__
+
+#include "poly.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Liczba punktów, w których ::PolyEvalBatch wylicza wartość wielomianu
+ * jednocześnie. Próg wyznaczony benchmarkiem EvalBatchBench.
+ */
+#define EVAL_LANES 8
+
+/**
+ * Minimalna liczba punktów, od której ::PolyEvalBatch dzieli je między wątki
+ * ustawione przez ::PolySetThreads. Mniejsze zbiory punktów są wyliczane
+ * przez wywołujący wątek.
+ */
+#define EVAL_PAR_MIN_POINTS 4096
+
+/**
+ * Wylicza wartości wielomianu w @p n_points punktach, równe wartościom
+ * ::PolyEval w każdym z nich. Punkt o indeksie @f$i@f$ to wartości
+ * @f$x_0, \ldots, x_{k-1}@f$ zapisane w @p xs od pozycji @f$ik@f$, a pod
+ * pozostałe zmienne podstawiane jest zero. Drzewo wielomianu jest
+ * przechodzone raz dla każdej grupy ::EVAL_LANES punktów, a działania na
+ * wartościach punktów grupy są wykonywane w pętlach po punktach, bez
+ * rozgałęzień zależnych od punktu, więc mnożenia dla różnych punktów są od
+ * siebie niezależne. Duże zbiory punktów są dzielone między wątki puli. Nie
+ * przydziela pamięci na stercie. Przy włączonym sprawdzaniu przepełnień
+ * (::PolySetOverflowCheck) wylicza wartości punkt po punkcie ::PolyEval.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] n_points : liczba punktów
+ * @param[in] xs : wartości zmiennych w kolejnych punktach
+ * @param[out] out : tablica @p n_points wartości wielomianu
+ */
+void PolyEvalBatch(const Poly *p, size_t k, size_t n_points,
+                   const poly_coeff_t xs[], poly_coeff_t out[]);
+
+/**
+ * Włącza albo wyłącza wyliczanie grup punktów ::PolyEvalBatch instrukcjami
+ * AVX2. Ścieżka AVX2 istnieje, jeśli biblioteka jest kompilowana na x86-64
+ * z makrem POLY_EVAL_AVX2, i jest używana tylko na procesorach, które te
+ * instrukcje mają. Wyniki obu ścieżek są równe. Domyślnie włączone.
+ * @param[in] enabled : czy używać instrukcji AVX2
+ */
+void PolySetEvalAvx2(bool enabled);
+
+/**
+ * Sprawdza, czy ::PolyEvalBatch wylicza grupy punktów instrukcjami AVX2.
+ * @return czy ścieżka AVX2 jest włączona, skompilowana i obsługiwana przez
+ * procesor
+ */
+bool PolyGetEvalAvx2(void);
+
+/** Rodzaj instrukcji programu wyliczającego wartość wielomianu */
+typedef enum
+{
+    PROG_CONST,        ///< @f$r_l = c@f$
+    PROG_MOVE,         ///< @f$r_l = r_{l+1}@f$
+    PROG_HORNER,       ///< @f$r_l = r_l \cdot x_l^e + r_{l+1}@f$
+    PROG_HORNER_CONST, ///< @f$r_l = r_l \cdot x_l^e + c@f$
+    PROG_MUL_POW,      ///< @f$r_l = r_l \cdot x_l^e@f$
+} PolyProgramOp;
+
+/** Instrukcja programu wyliczającego wartość wielomianu */
+typedef struct
+{
+    /** stała @f$c@f$ */
+    poly_coeff_t coeff;
+    /** wykładnik @f$e@f$ */
+    poly_exp_t exp;
+    /** indeks @f$l@f$ rejestru i zmiennej */
+    uint32_t level;
+    /** rodzaj instrukcji (::PolyProgramOp) */
+    uint32_t op;
+} PolyInstr;
+
+/**
+ * Program wyliczający wartość wielomianu schematem Hornera, skompilowany
+ * funkcją ::PolyProgramCompile. Instrukcje są wykonywane po kolei, bez
+ * skoków, na rejestrach @f$r_0, r_1, \ldots@f$, po jednym na zmienną:
+ * rejestr @f$r_l@f$ trzyma częściową wartość wielomianu zmiennej @f$x_l@f$,
+ * a wartość całego wielomianu zostaje w @f$r_0@f$.
+ */
+typedef struct
+{
+    /** instrukcje */
+    PolyInstr *code;
+    /** liczba instrukcji */
+    size_t size;
+    /** liczba używanych rejestrów, równa głębokości drzewa wielomianu */
+    size_t regs;
+} PolyProgram;
+
+/**
+ * Kompiluje wielomian do programu wyliczającego jego wartość. Jednomiany
+ * każdego poziomu są łączone schematem Hornera od największego wykładnika:
+ * częściowa wartość jest mnożona przez potęgę zmiennej o różnicy kolejnych
+ * wykładników, a potem dodawana jest do niej wartość kolejnego
+ * współczynnika. Współczynniki liczbowe są stałymi instrukcji. Program nie
+ * zależy od wielomianu, który może zostać potem usunięty.
+ * @param[in] p : wielomian @f$p@f$
+ * @return program wyliczający wartość @f$p@f$
+ */
+PolyProgram PolyProgramCompile(const Poly *p);
+
+/**
+ * Usuwa program z pamięci.
+ * @param[in,out] prog : program
+ */
+void PolyProgramDestroy(PolyProgram *prog);
+
+/**
+ * Wylicza wartość wielomianu programem, równą wartości ::PolyEval.
+ * Wykonuje instrukcje jedną pętlą, bez rekurencji, a rejestry bierze z areny
+ * pomocniczej wątku (::PolyScratch).
+ * @param[in] prog : program
+ * @param[in] k : liczba wartości w @p x
+ * @param[in] x : wartości kolejnych zmiennych
+ * @return wartość wielomianu
+ */
+poly_coeff_t PolyProgramEval(const PolyProgram *prog, size_t k,
+                             const poly_coeff_t x[]);
+
+/**
+ * Wylicza wartości wielomianu programem w @p n_points punktach, tak jak
+ * ::PolyEvalBatch: każda instrukcja jest wykonywana naraz dla grupy
+ * ::EVAL_LANES punktów, a duże zbiory punktów są dzielone między wątki puli.
+ * Przy włączonym sprawdzaniu przepełnień wylicza wartości punkt po punkcie
+ * ::PolyProgramEval.
+ * @param[in] prog : program
+ * @param[in] k : liczba wartości w każdym punkcie
+ * @param[in] n_points : liczba punktów
+ * @param[in] xs : wartości zmiennych w kolejnych punktach
+ * @param[out] out : tablica @p n_points wartości wielomianu
+ */
+void PolyProgramEvalBatch(const PolyProgram *prog, size_t k, size_t n_points,
+                          const poly_coeff_t xs[], poly_coeff_t out[]);
+
+/**
+ * Wylicza programem wartość wielomianu modulo @p mod. Współczynniki
+ * i wartości zmiennych są brane modulo @p mod, więc wynik nie zależy od
+ * przepełnień arytmetyki poly_coeff_t.
+ * @param[in] prog : program
+ * @param[in] k : liczba wartości w @p x
+ * @param[in] x : wartości kolejnych zmiennych
+ * @param[in] mod : moduł, dodatni
+ * @return wartość wielomianu modulo @p mod, z przedziału @f$[0, mod)@f$
+ */
+uint32_t PolyProgramEvalMod(const PolyProgram *prog, size_t k,
+                            const poly_coeff_t x[], uint32_t mod);
+
+/**
+ * Wypisuje do @p out kod źródłowy funkcji języka C
+ * @code long fn_name(const long x[]) @endcode
+ * wyliczającej wartość wielomianu tak jak ::PolyEval, z tablicą @p x
+ * o wartościach wszystkich zmiennych wielomianu. Kod jest ciągiem instrukcji
+ * bez pętli i skoków, odpowiadającym programowi ::PolyProgramCompile:
+ * jednomiany każdego poziomu są łączone schematem Hornera, a wartości
+ * współczynników niebędących liczbami są wyliczane wcześniej, rekurencyjnie.
+ * Potęgi zmiennych używane przez program są wyliczane raz, na początku
+ * funkcji, z kolejnych kwadratów zmiennej wspólnych dla wszystkich
+ * wykładników. Działania są wykonywane na liczbach bez znaku, więc
+ * przepełnienia dają te same wyniki co ::PolyEval, bez zachowań
+ * niezdefiniowanych.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in,out] out : strumień, do którego trafia kod
+ * @param[in] fn_name : nazwa funkcji, poprawny identyfikator języka C
+ */
+void PolyEmitC(const Poly *p, FILE *out, const char *fn_name);
+
+#endif
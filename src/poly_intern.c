@@ -0,0 +1,279 @@
+/** @file
+  Implementacja internowania wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_intern.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_lib.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/** Początkowa pojemność tablicy internowania */
+#define INTERN_INIT_SIZE 64
+
+/** Pozycja tablicy internowania */
+typedef struct
+{
+    Mono *arr;     ///< internowana tablica jednomianów albo NULL
+    size_t size;   ///< liczba jednomianów tablicy, równa jej pojemności
+    uint64_t hash; ///< skrót zawartości tablicy
+} InternEntry;
+
+/**
+ * Tablica internowania: zbiór tablic jednomianów z adresowaniem otwartym.
+ * Tablica trzyma jedno odwołanie do każdej internowanej tablicy jednomianów.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex; ///< muteks chroniący tablicę
+    InternEntry *entries;  ///< pozycje tablicy
+    size_t size;           ///< liczba internowanych tablic
+    size_t max_size;       ///< pojemność tablicy, potęga 2
+    size_t monos;          ///< łączna liczba internowanych jednomianów
+} InternTable;
+
+/** Globalna tablica internowania */
+static InternTable table = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Wyznacza skrót tablicy jednomianów, których współczynniki są
+ * współczynnikami liczbowymi albo internowanymi wielomianami. Internowane
+ * współczynniki są utożsamiane z adresem ich tablicy.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : liczba jednomianów
+ * @return skrót tablicy
+ */
+static uint64_t MonosHash(const Mono *monos, size_t size)
+{
+    uint64_t hash = HashMix(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        const Poly *p = &monos[i].p;
+        uint64_t coeff = PolyIsCoeff(p) ? (uint64_t)p->coeff * 2 + 1
+                                        : (uint64_t)(uintptr_t)p->arr;
+        hash = HashMix(hash ^ (uint64_t)(uint32_t)monos[i].exp);
+        hash = HashMix(hash ^ coeff);
+    }
+
+    return hash;
+}
+
+/**
+ * Sprawdza, czy pozycja tablicy internowania ma podaną zawartość.
+ * @param[in] entry : pozycja tablicy internowania
+ * @param[in] monos : tablica jednomianów o internowanych współczynnikach
+ * @param[in] size : liczba jednomianów
+ * @param[in] hash : skrót tablicy @p monos
+ * @return czy zawartości są równe
+ */
+static bool InternEntryEquals(const InternEntry *entry, const Mono *monos,
+                              size_t size, uint64_t hash)
+{
+    if (entry->hash != hash || entry->size != size)
+        return false;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        const Poly *p = &entry->arr[i].p;
+        const Poly *q = &monos[i].p;
+        if (entry->arr[i].exp != monos[i].exp ||
+            PolyIsCoeff(p) != PolyIsCoeff(q))
+            return false;
+
+        if (PolyIsCoeff(p) ? p->coeff != q->coeff : p->arr != q->arr)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Wstawia pozycję do tablicy pozycji, w której jest dla niej miejsce.
+ * @param[in,out] entries : tablica pozycji
+ * @param[in] max_size : pojemność tablicy, potęga 2
+ * @param[in] entry : wstawiana pozycja
+ */
+static void InternEntriesInsert(InternEntry *entries, size_t max_size,
+                                InternEntry entry)
+{
+    size_t i = (size_t)entry.hash & (max_size - 1);
+    while (entries[i].arr != NULL)
+        i = (i + 1) & (max_size - 1);
+
+    entries[i] = entry;
+}
+
+/**
+ * Przepisuje do nowej tablicy pozycji o pojemności @p max_size pozycje
+ * tablicy internowania. Wywoływana pod muteksem.
+ * @param[in] max_size : nowa pojemność, potęga 2
+ */
+static void InternTableRehash(size_t max_size)
+{
+    InternEntry *entries = PolyMallocUntracked(max_size * sizeof(InternEntry));
+    memset(entries, 0, max_size * sizeof(InternEntry));
+
+    for (size_t i = 0; i < table.max_size; i++)
+        if (table.entries[i].arr != NULL)
+            InternEntriesInsert(entries, max_size, table.entries[i]);
+
+    PolyFreeUntracked(table.entries);
+    table.entries = entries;
+    table.max_size = max_size;
+}
+
+/**
+ * Zwraca internowany wielomian o jednomianach @p monos, których
+ * współczynniki są już internowane. Jeśli równa tablica jest w tablicy
+ * internowania, zwraca ją i usuwa jednomiany @p monos, a wpp. kopiuje je do
+ * nowej tablicy i ją internuje.
+ * @param[in,out] monos : tablica jednomianów przydzielona z areny
+ * @param[in] size : liczba jednomianów
+ * @return internowany wielomian
+ */
+static Poly InternMonos(Mono *monos, size_t size)
+{
+    uint64_t hash = MonosHash(monos, size);
+
+    pthread_mutex_lock(&table.mutex);
+
+    if (2 * (table.size + 1) > table.max_size)
+        InternTableRehash(table.max_size == 0 ? INTERN_INIT_SIZE
+                                              : table.max_size * MEM_SIZE_MULT);
+
+    size_t i = (size_t)hash & (table.max_size - 1);
+    while (table.entries[i].arr != NULL &&
+           !InternEntryEquals(&table.entries[i], monos, size, hash))
+        i = (i + 1) & (table.max_size - 1);
+
+    InternEntry *entry = &table.entries[i];
+    bool is_found = entry->arr != NULL;
+    if (is_found)
+    {
+        MonosRetain(entry->arr);
+    }
+    else
+    {
+        // jedno odwołanie należy do tablicy internowania, drugie do wyniku
+        entry->arr = MonosAlloc(size);
+        memcpy(entry->arr, monos, size * sizeof(Mono));
+        MonosRetain(entry->arr);
+        MonosSetInterned(entry->arr, true);
+        entry->size = size;
+        entry->hash = hash;
+        table.size++;
+        table.monos += size;
+    }
+
+    Poly res_poly = {.size = size, .arr = entry->arr};
+
+    pthread_mutex_unlock(&table.mutex);
+
+    if (is_found)
+        for (size_t j = 0; j < size; j++)
+            MonoDestroy(&monos[j]);
+
+    return res_poly;
+}
+
+Poly PolyIntern(const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return *p;
+
+    if (MonosIsInterned(p->arr))
+    {
+        MonosRetain(p->arr);
+        return *p;
+    }
+
+    // współczynniki są internowane od dołu, więc równe poddrzewa mają już
+    // równe adresy tablic
+    PolyArenaMark mark = PolyScratchMark();
+    Mono *monos = PolyArenaAlloc(PolyScratch(), p->size * sizeof(Mono));
+    for (size_t i = 0; i < p->size; i++)
+        monos[i] = (Mono){.p = PolyIntern(&p->arr[i].p), .exp = p->arr[i].exp};
+
+    Poly res_poly = InternMonos(monos, p->size);
+
+    PolyScratchRelease(mark);
+
+    return res_poly;
+}
+
+/**
+ * Usuwa tablicę jednomianów z tablicy internowania, zwalniając jej
+ * odwołanie. Wywoływana pod muteksem.
+ * @param[in,out] entry : pozycja tablicy internowania
+ */
+static void InternEntryRelease(InternEntry *entry)
+{
+    Poly p = {.size = entry->size, .arr = entry->arr};
+    MonosSetInterned(entry->arr, false);
+    PolyDestroy(&p);
+
+    table.size--;
+    table.monos -= entry->size;
+    entry->arr = NULL;
+}
+
+void PolyInternCollect(void)
+{
+    pthread_mutex_lock(&table.mutex);
+
+    // usunięcie tablicy zwalnia odwołania do tablic jej współczynników, więc
+    // kolejne przebiegi usuwają kolejne poziomy nieużywanych poddrzew
+    bool is_removed = true;
+    while (is_removed)
+    {
+        is_removed = false;
+        for (size_t i = 0; i < table.max_size; i++)
+        {
+            InternEntry *entry = &table.entries[i];
+            if (entry->arr != NULL && MonosRefCount(entry->arr) == 1)
+            {
+                InternEntryRelease(entry);
+                is_removed = true;
+            }
+        }
+    }
+
+    // usunięte pozycje przerywają ciągi adresowania otwartego
+    if (table.max_size > 0)
+        InternTableRehash(table.max_size);
+
+    pthread_mutex_unlock(&table.mutex);
+}
+
+void PolyInternClear(void)
+{
+    pthread_mutex_lock(&table.mutex);
+
+    for (size_t i = 0; i < table.max_size; i++)
+        if (table.entries[i].arr != NULL)
+            InternEntryRelease(&table.entries[i]);
+
+    PolyFreeUntracked(table.entries);
+    table.entries = NULL;
+    table.max_size = 0;
+
+    pthread_mutex_unlock(&table.mutex);
+}
+
+PolyInternStats PolyInternGetStats(void)
+{
+    pthread_mutex_lock(&table.mutex);
+    PolyInternStats stats = {.arrays = table.size, .monos = table.monos};
+    pthread_mutex_unlock(&table.mutex);
+
+    return stats;
+}
@@ -0,0 +1,58 @@
+/** @file
+  Interfejs internowania wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_INTERN_H__
+#define __POLY_INTERN_H__
+
+#include "poly.h"
+#include <stddef.h>
+
+/** Statystyki tablicy internowania */
+typedef struct
+{
+    /** liczba internowanych tablic jednomianów */
+    size_t arrays;
+    /** łączna liczba jednomianów w internowanych tablicach */
+    size_t monos;
+} PolyInternStats;
+
+/**
+ * Zwraca wielomian równy @f$p@f$, którego wszystkie tablice jednomianów
+ * należą do globalnej tablicy internowania. Równe podwielomiany, także
+ * w różnych wielomianach, współdzielą wtedy jedną tablicę, więc wielomian
+ * staje się grafem acyklicznym, a ::PolyIsEq porównuje internowane wielomiany
+ * w czasie @f$\mathrm{O}(1)@f$. Wielomian już internowany jest zwracany
+ * w czasie @f$\mathrm{O}(1)@f$. Wynik usuwa się funkcją ::PolyDestroy,
+ * a modyfikacja w miejscu kopiuje zmieniane tablice jak dla każdego
+ * współdzielonego wielomianu. Bezpieczna dla wielu wątków.
+ * @param[in] p : wielomian @f$p@f$
+ * @return internowany wielomian równy @f$p@f$
+ */
+Poly PolyIntern(const Poly *p);
+
+/**
+ * Usuwa z tablicy internowania tablice jednomianów, do których nie odwołuje
+ * się już żaden wielomian. Nie może być wywołana w trakcie ::PolyIntern.
+ */
+void PolyInternCollect(void);
+
+/**
+ * Usuwa z tablicy internowania wszystkie tablice jednomianów i zwalnia jej
+ * pamięć. Istniejące wielomiany pozostają ważne, ale przestają być
+ * internowane. Nie może być wywołana w trakcie ::PolyIntern.
+ */
+void PolyInternClear(void);
+
+/**
+ * Zwraca statystyki tablicy internowania.
+ * @return statystyki
+ */
+PolyInternStats PolyInternGetStats(void);
+
+#endif
@@ -9,21 +9,34 @@
 
 #include "poly_lib.h"
 #include "calc.h"
+#include "poly_acc.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_mul.h"
+#include "poly_overflow.h"
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+/** Rozmiar tablicy, od którego ::MonosSort używa sortowania pozycyjnego. */
+#define RADIX_SORT_MIN_SIZE 64
+
+/** Liczba bitów jednej cyfry klucza w sortowaniu pozycyjnym. */
+#define RADIX_BITS 8
+
+/** Liczba możliwych wartości jednej cyfry klucza w sortowaniu pozycyjnym. */
+#define RADIX_SIZE (1 << RADIX_BITS)
 
 /**
- * Porównuje jednomiany malejąco po wykładnikach. Używana w funkcji qsort.
- * @param[in] a : jednomian @f$a@f$
- * @param[in] b : jednomian @f$b@f$
- * @return 1 jeśli @f$a > b@f$, 0 jeśli @f$a == b@f$, -1 jeśli @f$a < b@f$
+ * Element sortowany pozycyjnie w ::MonosRadixSort zamiast całego jednomianu.
  */
-static int MonoCompFunc(const void *a, const void *b)
+typedef struct
 {
-    return (((Mono *)b)->exp > ((Mono *)a)->exp) -
-           (((Mono *)b)->exp < ((Mono *)a)->exp);
-}
+    uint32_t key; ///< klucz, rosnący wraz z malejącym wykładnikiem
+    size_t idx;   ///< indeks jednomianu w sortowanej tablicy
+} MonoSortItem;
 
 /**
  * Zwraca liczbę różnych potęg w jednomianach sumy @f$p@f$ i @f$q@f$
@@ -68,14 +81,7 @@ static size_t PolySummedSize(const Poly *p, const Poly *q)
  */
 static poly_exp_t MaxExp(poly_exp_t a, poly_exp_t b) { return a > b ? a : b; }
 
-/**
- * Zwraca rozmiar, który należy zaalokować, będący najmniejszą potęgą 2 większą
- * od liczby elementów, dla liczby elementów większej od INIT_SIZE oraz
- * INIT_SIZE wpp
- * @param[in] count : liczba elementów
- * @return rozmiar do zaalokowania
- */
-static size_t PolyRequiredSize(size_t count)
+size_t PolyRequiredSize(size_t count)
 {
     if (count <= INIT_SIZE)
         return INIT_SIZE;
@@ -122,43 +128,207 @@ static void PolyToCoeff(Poly *p, poly_coeff_t c)
 {
     assert(p != NULL && !PolyIsCoeff(p));
 
-    for (size_t i = 0; i < p->size; i++)
-        MonoDestroy(&p->arr[i]);
+    PolyDestroy(p);
+    *p = PolyFromCoeff(c);
+}
+
+/**
+ * Ustawia liczbę jednomianów wielomianu @f$p@f$ (niebędącego coeffem), gdy
+ * jednomiany spoza nowego rozmiaru zostały już usunięte lub przeniesione.
+ * Rozmiar 0 oznacza coeffa, więc wielomian bez jednomianów zamienia na zero
+ * i zwalnia jego tablicę.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] size : nowa liczba jednomianów
+ */
+static void PolySetSize(Poly *p, size_t size)
+{
+    assert(p != NULL && !PolyIsCoeff(p));
+
+    if (size == 0)
+    {
+        MonosFree(p->arr);
+        *p = PolyZero();
+    }
+    else
+    {
+        p->size = size;
+    }
+}
+
+/**
+ * Sprawdza, czy jednomiany są posortowane nierosnąco po wykładnikach.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ * @return czy tablica jest posortowana nierosnąco
+ */
+static bool MonosAreSorted(const Mono *monos, size_t size)
+{
+    for (size_t i = 1; i < size; i++)
+        if (monos[i - 1].exp < monos[i].exp)
+            return false;
+
+    return true;
+}
+
+/**
+ * Sprawdza, czy jednomiany są posortowane niemalejąco po wykładnikach.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ * @return czy tablica jest posortowana niemalejąco
+ */
+static bool MonosAreReverseSorted(const Mono *monos, size_t size)
+{
+    for (size_t i = 1; i < size; i++)
+        if (monos[i - 1].exp > monos[i].exp)
+            return false;
+
+    return true;
+}
+
+/**
+ * Odwraca kolejność jednomianów w tablicy.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ */
+static void MonosReverse(Mono *monos, size_t size)
+{
+    for (size_t i = 0; i < size / 2; i++)
+    {
+        Mono temp = monos[i];
+        monos[i] = monos[size - 1 - i];
+        monos[size - 1 - i] = temp;
+    }
+}
+
+/**
+ * Sortuje stabilnie jednomiany malejąco po wykładnikach przez wstawianie.
+ * Używana dla małych tablic.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ */
+static void MonosInsertionSort(Mono *monos, size_t size)
+{
+    for (size_t i = 1; i < size; i++)
+    {
+        Mono temp = monos[i];
+        size_t j = i;
+        while (j > 0 && monos[j - 1].exp < temp.exp)
+        {
+            monos[j] = monos[j - 1];
+            j--;
+        }
+        monos[j] = temp;
+    }
+}
+
+/**
+ * Zwraca klucz sortowania pozycyjnego jednomianu. Klucze bez znaku rosną wraz
+ * z malejącym wykładnikiem, także dla wykładników ujemnych.
+ * @param[in] m : jednomian
+ * @return klucz jednomianu
+ */
+static uint32_t MonoSortKey(const Mono *m)
+{
+    return ~((uint32_t)m->exp ^ UINT32_C(0x80000000));
+}
+
+/**
+ * Sortuje stabilnie jednomiany malejąco po wykładnikach sortowaniem
+ * pozycyjnym (LSD) po kluczach ::MonoSortKey. Sortowane są pary
+ * (klucz, indeks), a jednomiany są przestawiane dopiero na końcu, jednym
+ * przebiegiem. Pomija przebiegi, w których wszystkie klucze mają tę samą
+ * cyfrę.
+ * @param[in,out] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ */
+static void MonosRadixSort(Mono *monos, size_t size)
+{
+    PolyArenaMark mark = PolyScratchMark();
+    MonoSortItem *items =
+        PolyArenaAlloc(PolyScratch(), size * sizeof(MonoSortItem));
+    MonoSortItem *buffer =
+        PolyArenaAlloc(PolyScratch(), size * sizeof(MonoSortItem));
+
+    for (size_t i = 0; i < size; i++)
+        items[i] = (MonoSortItem){.key = MonoSortKey(&monos[i]), .idx = i};
+
+    for (unsigned shift = 0; shift < 32; shift += RADIX_BITS)
+    {
+        size_t count[RADIX_SIZE] = {0};
+        for (size_t i = 0; i < size; i++)
+            count[(items[i].key >> shift) & (RADIX_SIZE - 1)]++;
+
+        if (count[(items[0].key >> shift) & (RADIX_SIZE - 1)] == size)
+            continue;
+
+        size_t pos = 0;
+        for (size_t d = 0; d < RADIX_SIZE; d++)
+        {
+            size_t digit_count = count[d];
+            count[d] = pos;
+            pos += digit_count;
+        }
+
+        for (size_t i = 0; i < size; i++)
+            buffer[count[(items[i].key >> shift) & (RADIX_SIZE - 1)]++] =
+                items[i];
+
+        MonoSortItem *temp = items;
+        items = buffer;
+        buffer = temp;
+    }
+
+    Mono *sorted = PolyArenaAlloc(PolyScratch(), size * sizeof(Mono));
+    for (size_t i = 0; i < size; i++)
+        sorted[i] = monos[items[i].idx];
+
+    memcpy(monos, sorted, size * sizeof(Mono));
 
-    free(p->arr);
-    p->arr = NULL;
-    p->coeff = c;
+    PolyScratchRelease(mark);
 }
 
 void MonosSort(Mono *monos, size_t size)
 {
-    qsort(monos, size, sizeof(Mono), MonoCompFunc);
+    // tablice z parsera i ze scalania są zwykle już posortowane
+    // w jednym z kierunków
+    if (MonosAreSorted(monos, size))
+        return;
+
+    if (MonosAreReverseSorted(monos, size))
+        MonosReverse(monos, size);
+    else if (size < RADIX_SORT_MIN_SIZE)
+        MonosInsertionSort(monos, size);
+    else
+        MonosRadixSort(monos, size);
 }
 
+static void PolyAddToMode(Poly *p, const Poly *q, bool is_checked);
+
 /**
  * Dodaje wielomian @f$q@f$ będący coeffem do wielomianu @f$p@f$ nie będącego
- * coeffem
+ * coeffem. Jeśli wyraz wolny @f$p@f$ się wyzeruje, usuwa go z tablicy.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] q : wielomian @f$q@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
  */
-static void PolyAddCoeffTo(Poly *p, const Poly *q)
+static void PolyAddCoeffTo(Poly *p, const Poly *q, bool is_checked)
 {
     assert(p != NULL && q != NULL && !PolyIsCoeff(p) && PolyIsCoeff(q));
 
     // sprawdzam czy w p jest już jednomian z x^0
     if (p->arr[p->size - 1].exp == 0)
     {
-        PolyAddTo(&p->arr[p->size - 1].p, q);
+        PolyAddToMode(&p->arr[p->size - 1].p, q, is_checked);
+        // wyzerowany jednomian nie zajmuje pamięci
+        if (MonoIsZero(&p->arr[p->size - 1]))
+            PolySetSize(p, p->size - 1);
     }
-    else
+    else if (q->coeff != 0)
     {
         p->size++;
-        if (p->size > p->max_size)
-        {
-            p->max_size *= MEM_SIZE_MULT;
-            p->arr = realloc(p->arr, p->max_size * sizeof(Mono));
-            CHECK_PTR(p->arr);
-        }
+        if (p->size > MonosCapacity(p->arr))
+            p->arr =
+                MonosRealloc(p->arr, MonosCapacity(p->arr) * MEM_SIZE_MULT);
 
         p->arr[p->size - 1].exp = 0;
         p->arr[p->size - 1].p = PolyFromCoeff(q->coeff);
@@ -166,46 +336,187 @@ static void PolyAddCoeffTo(Poly *p, const Poly *q)
 }
 
 /**
- * Dodaje jednomiany wielomianu @f$q@f$ do wielomianu @f$p@f$
+ * Dodaje jednomiany wielomianu @f$q@f$ do wielomianu @f$p@f$. Scala tablice
+ * od końca, zapisując wynik bezpośrednio w powiększonej tablicy @f$p@f$, w
+ * czasie @f$\mathrm{O}(|p| + |q|)@f$. Jednomiany, które się wyzerowały, są
+ * usuwane.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] q : wielomian @f$q@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
  */
-static void PolyCombineTo(Poly *p, const Poly *q)
+static void PolyCombineTo(Poly *p, const Poly *q, bool is_checked)
 {
     assert(p != NULL && q != NULL && !PolyIsCoeff(p) && !PolyIsCoeff(q));
 
-    size_t curr_old = 0; // indeks na wykładniki z p
-    size_t old_size = p->size;
-    size_t curr_new = p->size; // indeks na nowe wykładniki
+    // jeśli mieści się górne ograniczenie rozmiaru sumy, wykładniki nie są
+    // przeglądane dodatkowym przebiegiem, a luka po powtórzonych
+    // wykładnikach jest zamykana tak samo jak po wyzerowanych jednomianach
+    size_t new_size = p->size + q->size;
+    if (new_size > MonosCapacity(p->arr))
+    {
+        new_size = PolySummedSize(p, q);
+        if (new_size > MonosCapacity(p->arr))
+            p->arr = MonosRealloc(p->arr, PolyRequiredSize(new_size));
+    }
+
+    // Najmniejsze wykładniki są na końcu tablic. Pozycja zapisu curr_res
+    // nigdy nie jest mniejsza od curr_old, więc nie nadpisuje jeszcze
+    // nieprzeczytanych jednomianów p.
+    size_t curr_old = p->size; // liczba nieprzetworzonych jednomianów z p
+    size_t curr_new = q->size; // liczba nieprzetworzonych jednomianów z q
+    size_t curr_res = new_size; // indeks ostatniego zapisanego jednomianu
+
+    while (curr_new > 0)
+    {
+        if (curr_old > 0 &&
+            p->arr[curr_old - 1].exp < q->arr[curr_new - 1].exp)
+        {
+            curr_old--;
+            curr_res--;
+            p->arr[curr_res] = p->arr[curr_old];
+        }
+        else if (curr_old > 0 &&
+                 p->arr[curr_old - 1].exp == q->arr[curr_new - 1].exp)
+        {
+            curr_old--;
+            curr_new--;
+            PolyAddToMode(&p->arr[curr_old].p, &q->arr[curr_new].p,
+                          is_checked);
+            // wyzerowany jednomian nie zajmuje pamięci, więc go pomijam
+            if (!MonoIsZero(&p->arr[curr_old]))
+            {
+                curr_res--;
+                p->arr[curr_res] = p->arr[curr_old];
+            }
+        }
+        else
+        {
+            curr_new--;
+            curr_res--;
+            p->arr[curr_res] = MonoClone(&q->arr[curr_new]);
+        }
+    }
+
+    // jednomiany p o indeksach mniejszych od curr_old są na swoim miejscu,
+    // luka po pominiętych jednomianach jest zamykana jednym przesunięciem
+    if (curr_res != curr_old)
+        memmove(p->arr + curr_old, p->arr + curr_res,
+                (new_size - curr_res) * sizeof(Mono));
+
+    PolySetSize(p, curr_old + (new_size - curr_res));
+}
+
+/**
+ * Wyszukuje wykładniczo, a następnie binarnie, najmniejszy indeks @f$i \geq@f$
+ * @p from, dla którego wykładnik @f$i@f$-tego jednomianu z posortowanej
+ * malejąco tablicy @p monos jest nie większy od @p exp.
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : rozmiar tablicy
+ * @param[in] from : indeks, od którego zaczyna się wyszukiwanie
+ * @param[in] exp : szukany wykładnik
+ * @return znaleziony indeks lub @p size, jeśli taki nie istnieje
+ */
+static size_t MonosGallop(const Mono *monos, size_t size, size_t from,
+                          poly_exp_t exp)
+{
+    size_t lo = from;
+    size_t hi = from;
+    size_t bound = 1;
+
+    // wszystkie jednomiany przed lo mają wykładnik większy od exp
+    while (hi < size && monos[hi].exp > exp)
+    {
+        lo = hi + 1;
+        hi = from + bound;
+        bound *= 2;
+    }
+
+    if (hi > size)
+        hi = size;
 
-    p->size = PolySummedSize(p, q);
-    if (p->size > p->max_size)
+    while (lo < hi)
     {
-        p->max_size = PolyRequiredSize(p->size);
-        p->arr = realloc(p->arr, p->max_size * sizeof(Mono));
-        CHECK_PTR(p->arr);
+        size_t mid = lo + (hi - lo) / 2;
+        if (monos[mid].exp > exp)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
 
-    poly_exp_t curr_exp;
+    return lo;
+}
+
+/**
+ * Dodaje jednomiany wielomianu @f$q@f$ do dużo większego wielomianu @f$p@f$.
+ * Miejsce każdego jednomianu @f$q@f$ jest wyszukiwane w @f$p@f$ funkcją
+ * ::MonosGallop, a nowe jednomiany są wstawiane jednym przebiegiem od końca,
+ * przesuwającym fragmenty tablicy funkcją memmove. Działa w czasie
+ * @f$\mathrm{O}(|q|\log|p|)@f$ plus koszt przesunięć.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ */
+static void PolyGallopTo(Poly *p, const Poly *q, bool is_checked)
+{
+    assert(p != NULL && q != NULL && !PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    size_t old_size = p->size;
+    PolyArenaMark mark = PolyScratchMark();
+    size_t *pos = PolyArenaAlloc(PolyScratch(), q->size * sizeof(size_t));
 
+    // wyszukiwanie miejsc i dodawanie jednomianów o wspólnych wykładnikach
+    size_t added = 0;
+    size_t from = 0;
     for (size_t i = 0; i < q->size; i++)
     {
-        curr_exp = q->arr[i].exp;
-        while (curr_old < old_size && curr_exp < p->arr[curr_old].exp)
-            curr_old++;
+        pos[i] = MonosGallop(p->arr, old_size, from, q->arr[i].exp);
+        from = pos[i];
 
-        if (curr_old < old_size && curr_exp == p->arr[curr_old].exp)
+        if (pos[i] < old_size && p->arr[pos[i]].exp == q->arr[i].exp)
+            PolyAddToMode(&p->arr[pos[i]].p, &q->arr[i].p, is_checked);
+        else
+            added++;
+    }
+
+    size_t new_size = old_size + added;
+    if (new_size > MonosCapacity(p->arr))
+        p->arr = MonosRealloc(p->arr, PolyRequiredSize(new_size));
+
+    // przesuwanie od końca fragmentów p leżących między kolejnymi
+    // miejscami wstawienia, z pominięciem wyzerowanych jednomianów
+    size_t read_end = old_size;
+    size_t write_end = new_size;
+    for (size_t i = q->size; i-- > 0;)
+    {
+        bool is_matched =
+            pos[i] < old_size && p->arr[pos[i]].exp == q->arr[i].exp;
+        size_t block_start = is_matched ? pos[i] + 1 : pos[i];
+        size_t block_len = read_end - block_start;
+
+        write_end -= block_len;
+        memmove(p->arr + write_end, p->arr + block_start,
+                block_len * sizeof(Mono));
+
+        if (!is_matched)
         {
-            MonoAddTo(&p->arr[curr_old], &q->arr[i]);
-            curr_old++;
+            write_end--;
+            p->arr[write_end] = MonoClone(&q->arr[i]);
         }
-        else // curr_exp > p1->arr[curr_old].exp
+        else if (!MonoIsZero(&p->arr[pos[i]]))
         {
-            p->arr[curr_new] = MonoClone(&q->arr[i]);
-            curr_new++;
+            write_end--;
+            p->arr[write_end] = p->arr[pos[i]];
         }
+
+        read_end = pos[i];
     }
-    MonosSort(p->arr, p->size);
+
+    if (write_end != read_end)
+        memmove(p->arr + read_end, p->arr + write_end,
+                (new_size - write_end) * sizeof(Mono));
+
+    PolySetSize(p, read_end + (new_size - write_end));
+    PolyScratchRelease(mark);
 }
 
 /**
@@ -233,27 +544,16 @@ static void PolySimplifyCoeff(Poly *p)
 }
 
 /**
- * Sprawdza czy jednomian @f$m@f$ jest w postaci @f$m=(Cx^0)x^n@f$
- * @param[in] m : jednomian @f$m@f$
- * @return czy jednomian @f$m@f$ jest w postaci @f$m=(Cx^0)x^n@f$
- */
-static bool MonoIsDeepCoeff(const Mono *m)
-{
-    assert(m != NULL);
-    return !PolyIsCoeff(&m->p) && m->p.size == 1 && m->p.arr[0].exp == 0 &&
-           PolyIsCoeff(&m->p.arr[0].p);
-}
-
-/**
- * Upraszcza jednomian @f$m@f$ w postaci @f$m=(Cx^0)x^n@f$ do jednomianu w
- * postaci @f$Cx^n@f$
- * @param[in,out] m : jednomian @f$m@f$
+ * Upraszcza wielomian @f$p@f$, którego jednomiany są już w postaci
+ * uproszczonej: wielomian @f$p = Cx^0@f$ zamienia na @f$p = C@f$. Wielomian
+ * bez jednomianów jest już zerem (::PolySetSize).
+ * @param[in,out] p : wielomian @f$p@f$
  */
-static void MonoSimplifyDeepCoeff(Mono *m)
+static void PolySimplifyTop(Poly *p)
 {
-    assert(m != NULL);
-    if (MonoIsDeepCoeff(m))
-        PolyToCoeff(&m->p, m->p.arr[0].p.coeff);
+    assert(p != NULL);
+    if (!PolyIsCoeff(p))
+        PolySimplifyCoeff(p);
 }
 
 /**
@@ -293,28 +593,52 @@ static void PolyReduceZeros(Poly *p)
 }
 
 /**
- * Sprowadza wielomian do uproszczonej formy.
- * Uproszczona forma to:
- * - brak zerowych jednomianów
- * - wielomian nie ma postaci @f$p = Cx^0@f$
- * - brak zagnieżdżonych w dół @f$x^0@f$, kończących się na @f$x^0@f$
- * - jednomiany są posortowane malejąco według potęg
+ * Działa jak ::PolyMakeUnique, ale kopia współdzielonej tablicy ma miejsce na
+ * co najmniej @p count jednomianów, więc operacja, która zaraz powiększy
+ * wielomian, nie musi jej od razu powiększać.
  * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] count : przewidywana liczba jednomianów
  */
-static void PolySimplify(Poly *p)
+static void PolyMakeUniqueFor(Poly *p, size_t count)
 {
     assert(p != NULL);
 
-    if (!PolyIsCoeff(p))
+    if (PolyIsCoeff(p))
+        return;
+
+    // wielomian zaraz się zmieni, więc jego metadane się zdezaktualizują
+    if (!MonosIsShared(p->arr))
     {
-        PolyReduceZeros(p);
-        for (size_t i = 0; i < p->size; i++)
-        {
-            PolySimplify(&p->arr[i].p);
-            MonoSimplifyDeepCoeff(&p->arr[i]);
-        }
-        PolySimplifyCoeff(p);
+        MonosClearMeta(p->arr);
+        return;
     }
+
+    size_t max_size = MonosCapacity(p->arr);
+    if (count > max_size)
+        max_size = PolyRequiredSize(count);
+
+    // kopiowana jest tylko tablica, jednomiany są współdzielone
+    Mono *arr = MonosAlloc(max_size);
+    for (size_t i = 0; i < p->size; i++)
+        arr[i] = MonoClone(&p->arr[i]);
+
+    PolyDestroy(p);
+    p->arr = arr;
+}
+
+void PolyMakeUnique(Poly *p) { PolyMakeUniqueFor(p, 0); }
+
+Poly PolyOwnMonosArray(size_t count, Mono *monos)
+{
+    if (count == 0)
+    {
+        MonosFree(monos);
+        return PolyZero();
+    }
+
+    MonosSort(monos, count);
+
+    return PolyFromMonos(count, monos);
 }
 
 Poly PolyFromMonos(size_t count, Mono *monos)
@@ -346,7 +670,6 @@ Poly PolyFromMonos(size_t count, Mono *monos)
 
     poly_from_monos.size = simplified_size;
     poly_from_monos.arr = monos;
-    poly_from_monos.max_size = count;
 
     PolyReduceZeros(&poly_from_monos);
     PolySimplifyCoeff(&poly_from_monos);
@@ -358,58 +681,291 @@ void PolyToMonoCoeff(Poly *p)
 {
     assert(p != NULL && PolyIsCoeff(p));
 
-    p->arr = malloc(INIT_SIZE * sizeof(Mono));
-    CHECK_PTR(p->arr);
+    // współczynnik i tablica zajmują to samo miejsce
+    poly_coeff_t c = p->coeff;
+    p->arr = MonosAlloc(INIT_SIZE);
 
     p->arr[0].exp = 0;
-    p->arr[0].p = PolyFromCoeff(p->coeff);
+    p->arr[0].p = PolyFromCoeff(c);
     p->size = 1;
-    p->max_size = INIT_SIZE;
 }
 
-void PolyAddTo(Poly *p, const Poly *q)
+/**
+ * Dodaje wielomian @f$q@f$ do wielomianu @f$p@f$ tak jak ::PolyAddTo,
+ * wariantem ze sprawdzaniem przepełnień albo bez niego, wybranym raz dla
+ * całej sumy.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ */
+static void PolyAddToMode(Poly *p, const Poly *q, bool is_checked)
 {
     assert(p != NULL && q != NULL);
     if (PolyIsCoeff(p))
     {
         if (PolyIsCoeff(q))
         {
-            p->coeff += q->coeff;
+            p->coeff = is_checked ? CoeffAdd(p->coeff, q->coeff)
+                                  : CoeffAddUnchecked(p->coeff, q->coeff);
             return;
         }
 
-        PolyToMonoCoeff(p);
+        if (p->coeff == 0)
+        {
+            *p = PolyClone(q);
+            return;
+        }
+
+        // suma powstaje z kopii q z miejscem na wyraz wolny, bez tablicy
+        // jednomianu Cx^0 scalanej potem z q
+        Poly c = *p;
+        *p = PolyClone(q);
+        PolyMakeUniqueFor(p, q->size + 1);
+        PolyAddCoeffTo(p, &c, is_checked);
+        PolySimplifyTop(p);
+        return;
     }
 
+    PolyMakeUniqueFor(p, p->size + (PolyIsCoeff(q) ? 1 : q->size));
+
     if (PolyIsCoeff(q))
-        PolyAddCoeffTo(p, q);
-    else // p, q NIE są coeffami
-        PolyCombineTo(p, q);
+        PolyAddCoeffTo(p, q, is_checked);
+    // p, q NIE są coeffami
+    else if (p->size >= ADD_GALLOP_RATIO * (size_t)q->size)
+        PolyGallopTo(p, q, is_checked);
+    else
+        PolyCombineTo(p, q, is_checked);
 
-    PolySimplify(p);
+    // współczynniki jednomianów zostały uproszczone przez rekurencyjne
+    // wywołania, więc wystarczy uprościć sam wielomian p
+    PolySimplifyTop(p);
 }
 
-void PolyNegTo(Poly *p) { PolyMulByCoeffTo(p, -1); }
+void PolyAddTo(Poly *p, const Poly *q)
+{
+    PolyAddToMode(p, q, PolyOverflowIsChecked());
+}
 
-void PolyMulByCoeffTo(Poly *p, poly_coeff_t c)
+void PolyAddMonoTo(Poly *p, Mono *m)
 {
-    assert(p != NULL);
+    assert(p != NULL && m != NULL);
+
+    if (PolyIsZero(&m->p))
+        return;
+
+    if (PolyIsCoeff(p))
+    {
+        if (m->exp == 0 && PolyIsCoeff(&m->p))
+        {
+            p->coeff = PolyOverflowIsChecked()
+                           ? CoeffAdd(p->coeff, m->p.coeff)
+                           : CoeffAddUnchecked(p->coeff, m->p.coeff);
+            return;
+        }
+
+        if (p->coeff == 0)
+        {
+            p->arr = MonosAlloc(INIT_SIZE);
+            p->arr[0] = *m;
+            p->size = 1;
+            return;
+        }
+
+        PolyToMonoCoeff(p);
+    }
+
+    PolyMakeUnique(p);
+    size_t idx = MonosGallop(p->arr, p->size, 0, m->exp);
+
+    if (idx < p->size && p->arr[idx].exp == m->exp)
+    {
+        MonoAddTo(&p->arr[idx], m);
+        MonoDestroy(m);
+
+        // wyzerowany jednomian nie zajmuje pamięci
+        if (MonoIsZero(&p->arr[idx]))
+        {
+            memmove(p->arr + idx, p->arr + idx + 1,
+                    (p->size - idx - 1) * sizeof(Mono));
+            PolySetSize(p, p->size - 1);
+        }
+    }
+    else
+    {
+        if (p->size == MonosCapacity(p->arr))
+            p->arr =
+                MonosRealloc(p->arr, MonosCapacity(p->arr) * MEM_SIZE_MULT);
+
+        memmove(p->arr + idx + 1, p->arr + idx,
+                (p->size - idx) * sizeof(Mono));
+        p->arr[idx] = *m;
+        p->size++;
+    }
+
+    PolySimplifyTop(p);
+}
+
+void PolyNegTo(Poly *p) { PolyMulByCoeffTo(p, -1); }
 
+/**
+ * Mnoży wielomian @f$p@f$ przez współczynnik tak jak ::PolyMulByCoeffTo,
+ * wariantem ze sprawdzaniem przepełnień albo bez niego, wybranym raz dla
+ * całego iloczynu.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] c : współczynnik
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ */
+static void PolyMulByCoeffToMode(Poly *p, poly_coeff_t c, bool is_checked)
+{
     if (PolyIsCoeff(p))
     {
-        p->coeff *= c;
+        p->coeff = is_checked ? CoeffMul(p->coeff, c)
+                              : CoeffMulUnchecked(p->coeff, c);
     }
     else if (c == 0)
     {
         PolyToCoeff(p, 0);
     }
-    else
+    else if (c != 1)
     {
+        PolyMakeUnique(p);
         for (size_t i = 0; i < p->size; i++)
-            PolyMulByCoeffTo(&p->arr[i].p, c);
+            PolyMulByCoeffToMode(&p->arr[i].p, c, is_checked);
+
+        // przy przepełnieniu współczynniki mogą się wyzerować
+        PolyReduceZeros(p);
+        PolySimplifyCoeff(p);
     }
 }
 
+void PolyMulByCoeffTo(Poly *p, poly_coeff_t c)
+{
+    assert(p != NULL);
+
+    PolyMulByCoeffToMode(p, c, PolyOverflowIsChecked());
+}
+
+size_t PolyCountLeaves(const Poly *p, size_t limit)
+{
+    if (PolyIsCoeff(p))
+        return 1;
+
+    const PolyMeta *meta = MonosGetMeta(p->arr);
+    if (meta != NULL)
+        return meta->terms < limit ? meta->terms : limit;
+
+    size_t count = 0;
+    for (size_t i = 0; i < p->size && count < limit; i++)
+        count += PolyCountLeaves(&p->arr[i].p, limit - count);
+
+    return count;
+}
+
+/**
+ * Wyznacza liczbę zmiennych, od których może zależeć wielomian @f$p@f$,
+ * który nie jest współczynnikiem, zapisując przy okazji metadane jego
+ * dużych poddrzew (::PolyGetMeta).
+ * @param[in] p : wielomian @f$p@f$
+ * @return liczba zmiennych
+ */
+static size_t PolyMetaVars(const Poly *p)
+{
+    size_t vars = 1;
+    for (size_t i = 0; i < p->size; i++)
+    {
+        const Poly *coeff = &p->arr[i].p;
+        if (PolyIsCoeff(coeff))
+            continue;
+
+        const PolyMeta *coeff_meta = PolyGetMeta(coeff);
+        size_t coeff_vars =
+            coeff_meta != NULL ? coeff_meta->vars : PolyMetaVars(coeff);
+        if (coeff_vars + 1 > vars)
+            vars = coeff_vars + 1;
+    }
+
+    return vars;
+}
+
+/**
+ * Wlicza wielomian @f$p@f$, który nie jest współczynnikiem, do metadanych
+ * przodka: poddrzewa z metadanymi wlicza w czasie
+ * @f$\mathrm{O}(\mathrm{vars})@f$, a pozostałe przechodzi.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] var : indeks zmiennej, od której zależy @f$p@f$, w przodku
+ * @param[in] deg : suma wykładników na ścieżce od przodka do @f$p@f$
+ * @param[in,out] meta : metadane przodka
+ * @return skrót struktury @f$p@f$
+ */
+static uint64_t PolyMetaFold(const Poly *p, size_t var, poly_exp_t deg,
+                             PolyMeta *meta)
+{
+    const PolyMeta *p_meta = MonosGetMeta(p->arr);
+    if (p_meta != NULL)
+    {
+        meta->terms += p_meta->terms;
+        meta->deg = MaxExp(meta->deg, deg + p_meta->deg);
+        for (size_t j = 0; j < p_meta->vars; j++)
+            meta->degs[var + j] = MaxExp(meta->degs[var + j], p_meta->degs[j]);
+
+        return p_meta->hash;
+    }
+
+    uint64_t hash = HashMix(p->size);
+    meta->degs[var] = MaxExp(meta->degs[var], p->arr[0].exp);
+    for (size_t i = 0; i < p->size; i++)
+    {
+        const Poly *coeff = &p->arr[i].p;
+        poly_exp_t exp = p->arr[i].exp;
+        hash = HashMix(hash ^ (uint32_t)exp);
+        if (PolyIsCoeff(coeff))
+        {
+            hash = HashMix(hash ^ (uint64_t)coeff->coeff);
+            meta->terms++;
+            meta->deg = MaxExp(meta->deg, deg + exp);
+        }
+        else
+        {
+            uint64_t coeff_hash =
+                PolyMetaFold(coeff, var + 1, deg + exp, meta);
+            hash = HashMix(hash ^ coeff_hash);
+        }
+    }
+
+    return hash;
+}
+
+const PolyMeta *PolyGetMeta(const Poly *p)
+{
+    if (PolyIsCoeff(p))
+        return NULL;
+
+    const PolyMeta *meta = MonosGetMeta(p->arr);
+    if (meta != NULL || MonosRefCount(p->arr) == 0)
+        return meta;
+
+    // małe wielomiany taniej przejść niż przydzielać im metadane
+    if (PolyCountLeaves(p, META_MIN_TERMS) < META_MIN_TERMS)
+        return NULL;
+
+    size_t vars = PolyMetaVars(p);
+    PolyMeta *new_meta = MonosMetaAlloc(p->arr, vars);
+    new_meta->terms = 0;
+    new_meta->vars = vars;
+    new_meta->deg = 0;
+    for (size_t j = 0; j < vars; j++)
+        new_meta->degs[j] = 0;
+    new_meta->hash = PolyMetaFold(p, 0, 0, new_meta);
+
+    if (!MonosSetMeta(p->arr, new_meta))
+    {
+        PolyFree(new_meta);
+        return MonosGetMeta(p->arr);
+    }
+
+    return new_meta;
+}
+
 void PolyDegByHelp(const Poly *p, size_t var_idx, size_t curr_idx,
                    poly_exp_t *max_exp)
 {
@@ -442,7 +998,10 @@ void PolyDegHelp(const Poly *p, poly_exp_t *max_exp, poly_exp_t curr_exp)
 
 Mono MonoMul(const Mono *m, const Mono *n)
 {
-    return (Mono){.exp = m->exp + n->exp, .p = PolyMul(&m->p, &n->p)};
+    poly_exp_t exp = PolyOverflowIsChecked() ? ExpAdd(m->exp, n->exp)
+                                             : ExpAddUnchecked(m->exp, n->exp);
+
+    return (Mono){.exp = exp, .p = PolyMul(&m->p, &n->p)};
 }
 
 Poly PolyMulByCoeff(const Poly *p, poly_coeff_t c)
@@ -450,22 +1009,75 @@ Poly PolyMulByCoeff(const Poly *p, poly_coeff_t c)
     Poly res_poly = PolyClone(p);
 
     PolyMulByCoeffTo(&res_poly, c);
-    PolySimplify(&res_poly);
 
     return res_poly;
 }
 
+/**
+ * Sprawdza, czy @f$|x|^\mathrm{exp}@f$ na pewno mieści się w poly_coeff_t:
+ * jeśli @f$|x|@f$ ma @f$b@f$ bitów, to @f$|x|^\mathrm{exp} < 2^{b \cdot
+ * \mathrm{exp}}@f$.
+ * @param[in] x : podstawa
+ * @param[in] exp : wykładnik
+ * @return czy potęga się mieści
+ */
+static inline bool PowerFits(poly_coeff_t x, poly_exp_t exp)
+{
+    uint64_t abs = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+    if (abs <= 1)
+        return true;
+
+    int64_t bits = 64 - __builtin_clzl(abs);
+    return bits * exp <= 63;
+}
+
 poly_coeff_t Power(poly_coeff_t x, poly_exp_t exp)
 {
     if (x == 1 || exp == 0)
         return 1;
 
-    if (x == 0)
-        return 0;
+    // potęgowanie przez podnoszenie do kwadratu, od najmłodszego bitu
+    // wykładnika; gdy kwadrat się wyzeruje (modulo 2^64), wynik też jest zerem;
+    // liczby bez znaku mają zdefiniowane przepełnienie
+    unsigned long base = (unsigned long)x;
+    unsigned long res = 1;
+    while (exp > 0)
+    {
+        if (base == 0)
+            return 0;
+
+        if (exp % 2 == 1)
+            res *= base;
+
+        base *= base;
+        exp /= 2;
+    }
 
-    poly_coeff_t remainder = exp % 2;
-    poly_coeff_t half_power = Power(x, exp / 2);
-    return half_power * half_power * (remainder == 1 ? x : 1);
+    return (poly_coeff_t)res;
+}
+
+poly_coeff_t PowerChecked(poly_coeff_t x, poly_exp_t exp)
+{
+    if (PowerFits(x, exp))
+        return Power(x, exp);
+
+    // kwadrat po najstarszym bicie wykładnika nie jest liczony, więc nie
+    // zgłasza przepełnienia
+    poly_coeff_t res = 1;
+    while (exp > 0)
+    {
+        if (x == 0)
+            return 0;
+
+        if (exp % 2 == 1)
+            res = CoeffMul(res, x);
+
+        exp /= 2;
+        if (exp > 0)
+            x = CoeffMul(x, x);
+    }
+
+    return res;
 }
 
 /**
@@ -572,8 +1184,9 @@ static void CheckMaxExps(const Poly *p, poly_exp_t *max_exp, size_t k,
 }
 
 /**
- * Zwraca tablicę @f$n@f$ pierwszych potęg 2 wielomianu @f$p@f$. Przejmuje
- * wielomian @f$p@f$ na własność.
+ * Zwraca tablicę @f$n@f$ pierwszych potęg 2 wielomianu @f$p@f$, przydzieloną
+ * z areny pomocniczej (::PolyScratch). Przejmuje wielomian @f$p@f$ na
+ * własność.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] n : liczba potęg
  * @return tablica @f$n@f$ pierwszych potęg 2 wielomianu @f$p@f$
@@ -583,12 +1196,11 @@ static Poly *PolyPowerTable(Poly *p, size_t n)
     if (n == 0)
         return NULL;
 
-    Poly *power_table = malloc(n * sizeof(Poly));
-    CHECK_PTR(power_table);
+    Poly *power_table = PolyArenaAlloc(PolyScratch(), n * sizeof(Poly));
     power_table[0] = *p;
 
     for (size_t i = 1; i < n; i++)
-        power_table[i] = PolyMul(&power_table[i - 1], &power_table[i - 1]);
+        power_table[i] = PolySqr(&power_table[i - 1]);
 
     return power_table;
 }
@@ -609,6 +1221,7 @@ static void PolyComposeNotEnough(Poly *p, size_t k, Poly **poly_pow, size_t idx)
     {
         if (p->arr[p->size - 1].exp == 0)
         {
+            PolyMakeUnique(p);
             // sprawdzam, czy poniższy wielomian się nie wyzeruje
             PolyComposeHelp(&p->arr[p->size - 1].p, k, poly_pow, idx + 1);
             if (PolyIsZero(&p->arr[p->size - 1].p))
@@ -639,65 +1252,48 @@ static void PolyComposeNotEnough(Poly *p, size_t k, Poly **poly_pow, size_t idx)
 
 /**
  * Wykonuje operację składania na tablicy jednomianów wielomianu @f$p@f$.
- * Otrzymaną tablicę wielomianów zapisuje do wskaźnika @p polies i zwraca
- * liczbę elementów w tej tablicy.
+ * Otrzymane wielomiany dodaje do akumulatora @p acc. Usuwa jednomiany
+ * wielomianu @f$p@f$, ale nie zwalnia jego tablicy.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] k : liczba składanych wielomianów
  * @param[in] poly_pow : tablica tablic potęg 2 składanych wielomianów
  * @param[in] idx : aktualna głębokość rekurencji
- * @param[out] polies : wskaźnik na tablicę wielomianów
- * @return liczba wielomianów w tablicy @p polies
+ * @param[in,out] acc : akumulator sumy otrzymanych wielomianów
  */
-static size_t PolyComposeMonos(Poly *p, size_t k, Poly **poly_pow, size_t idx,
-                               Poly **polies)
+static void PolyComposeMonos(Poly *p, size_t k, Poly **poly_pow, size_t idx,
+                             PolyAccumulator *acc)
 {
-    size_t arr_size = p->size;
-
-    size_t cnt_zeros = 0;
     Poly x_p;
 
     for (size_t i = 0; i < p->size; i++)
     {
         PolyComposeHelp(&p->arr[i].p, k, poly_pow, idx + 1);
-        if (PolyIsZero(&p->arr[i].p))
-        {
-            cnt_zeros++;
-        }
-        else
+        if (!PolyIsZero(&p->arr[i].p))
         {
-            if (*polies == NULL)
-            {
-                *polies = malloc((arr_size - cnt_zeros) * sizeof(Poly));
-                CHECK_PTR(polies);
-            }
-
             x_p = PolyPower(poly_pow[idx], p->arr[i].exp);
 
             // poniższe ify są tutaj, aby nieco zmniejszyć alokacje, mogłoby być
             // tylko to co w else
             if (PolyIsCoeff(&x_p))
             {
-                (*polies)[i - cnt_zeros] = p->arr[i].p;
-                PolyMulByCoeffTo(&((*polies)[i - cnt_zeros]), x_p.coeff);
+                PolyMulByCoeffTo(&p->arr[i].p, x_p.coeff);
+                PolyAccumulatorAdd(acc, p->arr[i].p);
                 continue;
             }
 
             if (PolyIsCoeff(&p->arr[i].p))
             {
-                (*polies)[i - cnt_zeros] = x_p;
-                PolyMulByCoeffTo(&((*polies)[i - cnt_zeros]),
-                                 p->arr[i].p.coeff);
+                PolyMulByCoeffTo(&x_p, p->arr[i].p.coeff);
+                PolyAccumulatorAdd(acc, x_p);
             }
             else
             {
-                (*polies)[i - cnt_zeros] = PolyMul(&x_p, &p->arr[i].p);
+                PolyAccumulatorAdd(acc, PolyMul(&x_p, &p->arr[i].p));
                 PolyDestroy(&x_p);
             }
         }
         MonoDestroy(&p->arr[i]);
     }
-
-    return arr_size - cnt_zeros;
 }
 
 /**
@@ -718,38 +1314,24 @@ static void PolyComposeHelp(Poly *p, size_t k, Poly **poly_pow, size_t idx)
     if (PolyIsCoeff(p))
         return;
 
-    Poly *polies = NULL;
-    size_t polies_cnt = PolyComposeMonos(p, k, poly_pow, idx, &polies);
+    PolyMakeUnique(p);
+    PolyAccumulator acc = PolyAccumulatorNew();
+    PolyComposeMonos(p, k, poly_pow, idx, &acc);
 
-    if (polies_cnt > 0)
-    {
-        for (size_t i = 1; i < polies_cnt; i++)
-            PolyAddTo(&polies[0], &polies[i]);
-
-        free(p->arr);
-        *p = polies[0];
-
-        for (size_t i = 1; i < polies_cnt; i++)
-            PolyDestroy(&polies[i]);
-
-        free(polies);
-    }
-    else
-    {
-        PolyDestroy(p);
-        *p = PolyZero();
-    }
+    MonosFree(p->arr);
+    *p = PolyAccumulatorFinalize(&acc);
 }
 
 void PolyComposeTo(Poly *p, size_t k, Poly q[])
 {
-    poly_exp_t *max_exp = calloc(k, sizeof(poly_exp_t));
-    CHECK_PTR(max_exp);
+    // tablice pomocnicze są w arenie, zwalnianej w całości na końcu
+    PolyArenaMark mark = PolyScratchMark();
+    poly_exp_t *max_exp = PolyArenaAlloc(PolyScratch(), k * sizeof(poly_exp_t));
+    memset(max_exp, 0, k * sizeof(poly_exp_t));
     CheckMaxExps(p, max_exp, k, 0);
 
     // Tworzenie tablicy z potrzebnymi potęgami 2 dla każdego q_i
-    Poly **poly_pow = malloc(k * sizeof(Poly *));
-    CHECK_PTR(poly_pow);
+    Poly **poly_pow = PolyArenaAlloc(PolyScratch(), k * sizeof(Poly *));
     for (size_t i = 0; i < k; i++)
     {
         poly_pow[i] = PolyPowerTable(q + i, ExpLogSize(max_exp[i]));
@@ -767,11 +1349,8 @@ void PolyComposeTo(Poly *p, size_t k, Poly q[])
             size_t log_size = ExpLogSize(max_exp[i]);
             for (size_t j = 0; j < log_size; j++)
                 PolyDestroy(&poly_pow[i][j]);
-
-            free(poly_pow[i]);
         }
     }
 
-    free(max_exp);
-    free(poly_pow);
+    PolyScratchRelease(mark);
 }
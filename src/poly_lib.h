@@ -11,7 +11,9 @@
 #define __POLY_LIB_H__
 
 #include "poly.h"
+#include "poly_alloc.h"
 #include <assert.h>
+#include <stdint.h>
 
 /**
  * Sprawdza, czy alokacja się udała, jeśli nie, opuszcza program z kodem 1
@@ -26,6 +28,19 @@
         }                                                                      \
     } while (0)
 
+/**
+ * Minimalny stosunek @f$|p| / |q|@f$, od którego ::PolyAddTo wyszukuje miejsca
+ * jednomianów @f$q@f$ w @f$p@f$ zamiast scalać tablice liniowo.
+ */
+#define ADD_GALLOP_RATIO 8
+
+/**
+ * Minimalna liczba współczynników liczbowych wielomianu, dla której
+ * ::PolyGetMeta wyznacza i zapisuje jego metadane. Metadane mniejszych
+ * poddrzew są wliczane do metadanych najbliższego większego przodka.
+ */
+#define META_MIN_TERMS 32
+
 /**
  * Przekształca wielomian będący coeffem @f$p = C@f$ na wielomian w postaci
  * @f$p = Cx^0@f$
@@ -34,12 +49,31 @@
 void PolyToMonoCoeff(Poly *p);
 
 /**
- * Dodaje wielomian @f$q@f$ do wielomianu @f$p@f$
+ * Dodaje wielomian @f$q@f$ do wielomianu @f$p@f$. Oba wielomiany muszą być w
+ * postaci uproszczonej i taki też jest wynik. Uproszczona forma to:
+ * - brak zerowych jednomianów
+ * - wielomian nie ma postaci @f$p = Cx^0@f$
+ * - brak zagnieżdżonych w dół @f$x^0@f$, kończących się na @f$x^0@f$
+ * - jednomiany są posortowane malejąco według potęg
+ *
+ * Działa w czasie @f$\mathrm{O}(|p| + |q|)@f$ na każdym poziomie, a
+ * upraszczane są tylko jednomiany, które zostały ze sobą zsumowane.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] q : wielomian @f$q@f$
  */
 void PolyAddTo(Poly *p, const Poly *q);
 
+/**
+ * Dodaje jednomian @f$m@f$ do wielomianu @f$p@f$. Przejmuje na własność
+ * zawartość jednomianu @p m. Miejsce jednomianu jest wyszukiwane binarnie, a
+ * upraszczany jest tylko jednomian, do którego @f$m@f$ został dodany, więc
+ * poza kosztem przesunięcia tablicy działa w czasie
+ * @f$\mathrm{O}(\log|p|)@f$ na każdym poziomie.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in,out] m : jednomian @f$m@f$
+ */
+void PolyAddMonoTo(Poly *p, Mono *m);
+
 /**
  * Neguje wielomian @f$p@f$
  * @param[in,out] p : wielomian @f$p@f$
@@ -47,7 +81,8 @@ void PolyAddTo(Poly *p, const Poly *q);
 void PolyNegTo(Poly *p);
 
 /**
- * Mnoży wielomian @f$p@f$ przez współczynnik @f$c@f$
+ * Mnoży wielomian @f$p@f$ przez współczynnik @f$c@f$. Usuwa jednomiany, które
+ * wyzerowały się w wyniku przepełnienia.
  * @param[in,out] p : wielomian @f$p@f$
  * @param[in] c : współczynnik @f$c@f$
  */
@@ -101,8 +136,20 @@ static inline void MonoAddTo(Mono *m, const Mono *n)
 }
 
 /**
- * Sortuje jednomiany malejąco po wykładnikach w złożoności
- * @f$\mathrm{O}(n*\log(n))@f$.
+ * Zwraca rozmiar, który należy zaalokować, będący najmniejszą potęgą 2 większą
+ * od liczby elementów, dla liczby elementów większej od INIT_SIZE oraz
+ * INIT_SIZE wpp
+ * @param[in] count : liczba elementów
+ * @return rozmiar do zaalokowania
+ */
+size_t PolyRequiredSize(size_t count);
+
+/**
+ * Sortuje jednomiany malejąco po wykładnikach. Tablice już posortowane w
+ * którymkolwiek kierunku obsługuje w czasie @f$\mathrm{O}(n)@f$, małe
+ * sortuje przez wstawianie, a duże pozycyjnie w czasie @f$\mathrm{O}(n)@f$.
+ * Jednomiany o równych wykładnikach mogą zmienić kolejność tylko przy
+ * odwracaniu tablicy posortowanej niemalejąco.
  * @param[in,out] monos : tablica jednomianów
  * @param[in] size : rozmiar tablicy
  */
@@ -119,7 +166,80 @@ void MonosSort(Mono *monos, size_t size);
 poly_coeff_t Power(poly_coeff_t x, poly_exp_t exp);
 
 /**
- * Tworzy wielomian będący sumą jednomianów z @p monos
+ * Liczy @f$x^\mathrm{exp}@f$ tak jak ::Power, zgłaszając przepełnienia
+ * (::PolyOverflowReport). Potęgę, która na pewno się mieści, liczy pętlą
+ * ::Power bez sprawdzania.
+ * @param[in] x : liczba @f$x@f$
+ * @param[in] exp : wykładnik @f$\mathrm{exp}@f$
+ * @return @f$x^\mathrm{exp}@f$
+ */
+poly_coeff_t PowerChecked(poly_coeff_t x, poly_exp_t exp);
+
+/**
+ * Zapewnia, że tablica jednomianów wielomianu @f$p@f$ nie jest współdzielona
+ * z innymi wielomianami, więc można ją modyfikować. Współdzieloną tablicę
+ * kopiuje, ale jej jednomiany pozostają współdzielone, więc funkcje
+ * modyfikujące wielomian w miejscu kopiują tylko zmieniane poddrzewa.
+ * Tablicy, która nie jest współdzielona, usuwa metadane (::PolyGetMeta).
+ * @param[in,out] p : wielomian @f$p@f$
+ */
+void PolyMakeUnique(Poly *p);
+
+/**
+ * Miesza bity liczby (funkcja kończąca SplitMix64).
+ * @param[in] x : liczba
+ * @return wymieszana liczba
+ */
+static inline uint64_t HashMix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    x ^= x >> 31;
+
+    return x;
+}
+
+/**
+ * Zlicza współczynniki liczbowe wielomianu, ale najwyżej do @p limit.
+ * Poddrzewa, które mają już metadane (::PolyGetMeta), nie są przechodzone.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] limit : liczba, po której liczenie jest przerywane, dodatnia
+ * @return mniejsza z liczby współczynników liczbowych @f$p@f$ i @p limit
+ */
+size_t PolyCountLeaves(const Poly *p, size_t limit);
+
+/**
+ * Zwraca metadane wielomianu @f$p@f$: stopień, stopnie względem kolejnych
+ * zmiennych, liczbę wyrazów i skrót struktury. Wyznacza je leniwie tylko
+ * dla wielomianów mających co najmniej ::META_MIN_TERMS współczynników
+ * liczbowych: przy pierwszym wywołaniu wylicza je z metadanych dużych
+ * poddrzew i przejścia małych, i zapisuje w nagłówku tablicy jednomianów,
+ * więc kolejne wywołania działają w czasie @f$\mathrm{O}(1)@f$, a po
+ * modyfikacji wielomianu w miejscu (::PolyMakeUnique) wyznaczane są tylko
+ * metadane zmienionych poddrzew.
+ * @param[in] p : wielomian @f$p@f$
+ * @return metadane albo NULL, jeśli @f$p@f$ jest współczynnikiem, ma mniej
+ * niż ::META_MIN_TERMS współczynników liczbowych lub ma tablice pożyczone
+ * z areny
+ */
+const PolyMeta *PolyGetMeta(const Poly *p);
+
+/**
+ * Sumuje jednomiany z tablicy przydzielonej funkcją ::MonosAlloc i tworzy
+ * z nich wielomian tak jak ::PolyOwnMonos. Przejmuje tablicę na własność.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów o pojemności co najmniej
+ * @p count
+ * @return wielomian będący sumą jednomianów
+ */
+Poly PolyOwnMonosArray(size_t count, Mono *monos);
+
+/**
+ * Tworzy wielomian będący sumą jednomianów z @p monos, posortowanych malejąco
+ * po wykładnikach. Przejmuje na własność tablicę przydzieloną funkcją
+ * ::MonosAlloc.
  * @param[in] count : liczba jednomianów
  * @param[in,out] monos : tablica jednomianów
  * @return wielomian będący sumą jednomianów z @p monos
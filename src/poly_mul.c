@@ -0,0 +1,1580 @@
+/** @file
+  Implementacja algorytmów mnożenia wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_mul.h"
+#include "poly.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_lib.h"
+#include "poly_overflow.h"
+#include "poly_pool.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Element kopca używanego w ::PolyMulHeap. Odpowiada iloczynowi @p i -tego
+ * jednomianu mniejszego wielomianu i @p j -tego jednomianu większego.
+ */
+typedef struct
+{
+    poly_exp_t exp; ///< wykładnik iloczynu jednomianów
+    size_t i;       ///< indeks jednomianu w mniejszym wielomianie
+    size_t j;       ///< indeks jednomianu w większym wielomianie
+} HeapEntry;
+
+/**
+ * Zamienia miejscami dwa elementy kopca.
+ * @param[in,out] a : element @f$a@f$
+ * @param[in,out] b : element @f$b@f$
+ */
+static void HeapSwap(HeapEntry *a, HeapEntry *b)
+{
+    HeapEntry temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+/**
+ * Przesuwa element o indeksie @p idx w górę kopca typu max.
+ * @param[in,out] heap : kopiec
+ * @param[in] idx : indeks przesuwanego elementu
+ */
+static void HeapSiftUp(HeapEntry *heap, size_t idx)
+{
+    while (idx > 0 && heap[(idx - 1) / 2].exp < heap[idx].exp)
+    {
+        HeapSwap(&heap[(idx - 1) / 2], &heap[idx]);
+        idx = (idx - 1) / 2;
+    }
+}
+
+/**
+ * Przesuwa element o indeksie @p idx w dół kopca typu max.
+ * @param[in,out] heap : kopiec
+ * @param[in] size : rozmiar kopca
+ * @param[in] idx : indeks przesuwanego elementu
+ */
+static void HeapSiftDown(HeapEntry *heap, size_t size, size_t idx)
+{
+    while (2 * idx + 1 < size)
+    {
+        size_t child = 2 * idx + 1;
+        if (child + 1 < size && heap[child + 1].exp > heap[child].exp)
+            child++;
+
+        if (heap[child].exp <= heap[idx].exp)
+            return;
+
+        HeapSwap(&heap[child], &heap[idx]);
+        idx = child;
+    }
+}
+
+/**
+ * Dodaje na kopiec iloczyn @p i -tego jednomianu wielomianu @f$s@f$ i @p j
+ * -tego jednomianu wielomianu @f$l@f$.
+ * @param[in,out] heap : kopiec
+ * @param[in,out] size : rozmiar kopca
+ * @param[in] s : mniejszy wielomian @f$s@f$
+ * @param[in] l : większy wielomian @f$l@f$
+ * @param[in] i : indeks jednomianu w @f$s@f$
+ * @param[in] j : indeks jednomianu w @f$l@f$
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ */
+static void HeapPush(HeapEntry *heap, size_t *size, const Poly *s,
+                     const Poly *l, size_t i, size_t j, bool is_checked)
+{
+    poly_exp_t exp = is_checked ? ExpAdd(s->arr[i].exp, l->arr[j].exp)
+                                : ExpAddUnchecked(s->arr[i].exp, l->arr[j].exp);
+    heap[*size] = (HeapEntry){.exp = exp, .i = i, .j = j};
+    HeapSiftUp(heap, *size);
+    (*size)++;
+}
+
+/** Tablica jednomianów iloczynu budowana malejąco po wykładnikach */
+typedef struct
+{
+    Mono *arr;       ///< tablica jednomianów
+    size_t size;     ///< liczba jednomianów
+    size_t max_size; ///< liczba zaalokowanej pamięci w tablicy
+} HeapOutput;
+
+/**
+ * Tworzy pustą tablicę jednomianów iloczynu.
+ * @return pusta tablica jednomianów
+ */
+static HeapOutput HeapOutputNew(void)
+{
+    HeapOutput out = {.size = 0, .max_size = INIT_SIZE};
+    out.arr = MonosAlloc(out.max_size);
+
+    return out;
+}
+
+/**
+ * Dodaje iloczyn jednomianów o wykładniku @p exp do tablicy. Wykładniki
+ * kolejnych iloczynów nie rosną, więc iloczyn o wykładniku ostatniego
+ * jednomianu jest do niego dodawany. Przejmuje na własność @p prod.
+ * @param[in,out] out : tablica jednomianów iloczynu
+ * @param[in] exp : wykładnik iloczynu
+ * @param[in] prod : współczynnik iloczynu
+ */
+static void HeapOutputAdd(HeapOutput *out, poly_exp_t exp, Poly prod)
+{
+    if (out->size > 0 && out->arr[out->size - 1].exp == exp)
+    {
+        PolyAddTo(&out->arr[out->size - 1].p, &prod);
+        PolyDestroy(&prod);
+        return;
+    }
+
+    // jednomian, który się wyzerował, nie zajmuje pamięci, więc można go
+    // nadpisać
+    if (out->size > 0 && PolyIsZero(&out->arr[out->size - 1].p))
+        out->size--;
+
+    if (out->size == out->max_size)
+    {
+        out->arr = MonosRealloc(out->arr, out->max_size * MEM_SIZE_MULT);
+        out->max_size *= MEM_SIZE_MULT;
+    }
+
+    out->arr[out->size].exp = exp;
+    out->arr[out->size].p = prod;
+    out->size++;
+}
+
+/**
+ * Zamienia tablicę jednomianów iloczynu w wielomian w postaci uproszczonej.
+ * @param[in,out] out : tablica jednomianów iloczynu
+ * @return iloczyn
+ */
+static Poly HeapOutputFinish(HeapOutput *out)
+{
+    if (out->size > 0 && PolyIsZero(&out->arr[out->size - 1].p))
+        out->size--;
+
+    if (out->size == 0)
+    {
+        MonosFree(out->arr);
+        return PolyZero();
+    }
+
+    if (out->size == 1 && out->arr[0].exp == 0 && PolyIsCoeff(&out->arr[0].p))
+    {
+        poly_coeff_t c = out->arr[0].p.coeff;
+        MonosFree(out->arr);
+        return PolyFromCoeff(c);
+    }
+
+    Poly res_poly;
+    res_poly.size = out->size;
+    res_poly.arr = out->arr;
+
+    return res_poly;
+}
+
+/**
+ * Usuwa szczyt kopca.
+ * @param[in,out] heap : kopiec
+ * @param[in,out] size : rozmiar kopca
+ */
+static void HeapPop(HeapEntry *heap, size_t *size)
+{
+    (*size)--;
+    heap[0] = heap[*size];
+    HeapSiftDown(heap, *size, 0);
+}
+
+/**
+ * Zdejmuje szczyt kopca iloczynów @f$s \cdot l@f$ i wstawia jego następniki.
+ * Następnik @f$(i, j)@f$ w wierszu @f$i@f$ zastępuje go na kopcu, a wiersz
+ * @f$i + 1@f$ jest otwierany dopiero po zdjęciu @f$(i, 0)@f$, co utrzymuje
+ * rozmiar kopca.
+ * @param[in,out] heap : kopiec
+ * @param[in,out] size : rozmiar kopca
+ * @param[in] s : mniejszy wielomian
+ * @param[in] l : większy wielomian
+ * @param[in] is_checked : czy zgłaszać przepełnienia (::PolyOverflowReport)
+ */
+static void HeapAdvance(HeapEntry *heap, size_t *size, const Poly *s,
+                        const Poly *l, bool is_checked)
+{
+    HeapEntry top = heap[0];
+    HeapPop(heap, size);
+    if (top.j == 0 && top.i + 1 < s->size)
+        HeapPush(heap, size, s, l, top.i + 1, 0, is_checked);
+    if (top.j + 1 < l->size)
+        HeapPush(heap, size, s, l, top.i, top.j + 1, is_checked);
+}
+
+/**
+ * Dodaje do tablicy iloczyn współczynników @p a i @p b o wykładniku @p exp.
+ * Jeśli ostatni jednomian tablicy ma ten sam wykładnik, iloczyn jest do niego
+ * dodawany funkcją ::PolyMulAddTo bez tworzenia wielomianu pośredniego.
+ * @param[in,out] out : tablica jednomianów iloczynu
+ * @param[in] exp : wykładnik iloczynu
+ * @param[in] a : współczynnik @f$a@f$
+ * @param[in] b : współczynnik @f$b@f$
+ */
+static void HeapOutputMulAdd(HeapOutput *out, poly_exp_t exp, const Poly *a,
+                             const Poly *b)
+{
+    if (out->size > 0 && out->arr[out->size - 1].exp == exp)
+        PolyMulAddTo(&out->arr[out->size - 1].p, a, b);
+    else
+        HeapOutputAdd(out, exp, PolyMul(a, b));
+}
+
+Poly PolyMulHeap(const Poly *p, const Poly *q)
+{
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    // kopiec ma co najwyżej tyle elementów, ile jednomianów ma mniejszy
+    // z wielomianów
+    const Poly *s = p->size <= q->size ? p : q;
+    const Poly *l = p->size <= q->size ? q : p;
+
+    PolyArenaMark mark = PolyScratchMark();
+    HeapEntry *heap =
+        PolyArenaAlloc(PolyScratch(), s->size * sizeof(HeapEntry));
+    size_t heap_size = 0;
+    bool is_checked = PolyOverflowIsChecked();
+    HeapPush(heap, &heap_size, s, l, 0, 0, is_checked);
+
+    HeapOutput out = HeapOutputNew();
+
+    while (heap_size > 0)
+    {
+        HeapEntry top = heap[0];
+        HeapOutputMulAdd(&out, top.exp, &s->arr[top.i].p, &l->arr[top.j].p);
+        HeapAdvance(heap, &heap_size, s, l, is_checked);
+    }
+
+    PolyScratchRelease(mark);
+
+    return HeapOutputFinish(&out);
+}
+
+/**
+ * Sprawdza, czy ::PolyMulAddTo powinien wyznaczyć cały iloczyn @f$a \cdot b@f$
+ * i dodać go funkcją ::PolyAddTo zamiast scalać iloczyny jednomianów
+ * z @f$acc@f$ na bieżąco.
+ * @param[in] acc : wielomian @f$acc@f$
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ * @return czy wyznaczyć iloczyn osobno
+ */
+static bool PolyMulAddNeedsProduct(const Poly *acc, const Poly *a,
+                                   const Poly *b)
+{
+    // iloczyn przez współczynnik nie wymaga scalania, mały iloczyn szybciej
+    // wyznaczyć bez kopca, iloczyn mały względem acc PolyAddTo wstawia
+    // wyszukiwaniem, a szybsze algorytmy wyznaczają cały iloczyn;
+    // scalanie zwalnia też tablicę acc, więc acc nie może być czynnikiem
+    if (PolyIsCoeff(a) || PolyIsCoeff(b) || acc == a || acc == b)
+        return true;
+
+    size_t acc_size = PolyIsCoeff(acc) ? 1 : acc->size;
+    size_t products = (size_t)a->size * b->size;
+    if (products < MUL_HEAP_MIN_PRODUCTS ||
+        acc_size >= ADD_GALLOP_RATIO * products)
+        return true;
+
+    return PolyMulKroneckerIsWorth(a, b) || PolyMulParallelIsWorth(a, b) ||
+           (PolyIsDense(a) && PolyIsDense(b));
+}
+
+void PolyMulAddTo(Poly *acc, const Poly *a, const Poly *b)
+{
+    if (PolyIsZero(a) || PolyIsZero(b))
+        return;
+
+    if (PolyIsZero(acc))
+    {
+        *acc = PolyMul(a, b);
+        return;
+    }
+
+    if (PolyMulAddNeedsProduct(acc, a, b))
+    {
+        Poly prod = PolyMul(a, b);
+        PolyAddTo(acc, &prod);
+        PolyDestroy(&prod);
+        return;
+    }
+
+    // jednomiany acc są przenoszone do wyniku, więc acc nie może
+    // współdzielić tablicy; współczynnik acc jest traktowany jak jednomian
+    // Cx^0
+    PolyMakeUnique(acc);
+    Mono acc_coeff = {.p = *acc, .exp = 0};
+    Mono *acc_arr = PolyIsCoeff(acc) ? &acc_coeff : acc->arr;
+    size_t acc_size = PolyIsCoeff(acc) ? 1 : acc->size;
+
+    const Poly *s = a->size <= b->size ? a : b;
+    const Poly *l = a->size <= b->size ? b : a;
+
+    PolyArenaMark mark = PolyScratchMark();
+    HeapEntry *heap =
+        PolyArenaAlloc(PolyScratch(), s->size * sizeof(HeapEntry));
+    size_t heap_size = 0;
+    bool is_checked = PolyOverflowIsChecked();
+    HeapPush(heap, &heap_size, s, l, 0, 0, is_checked);
+
+    HeapOutput out = HeapOutputNew();
+    size_t k = 0;
+
+    while (heap_size > 0)
+    {
+        HeapEntry top = heap[0];
+
+        // jednomiany acc o wykładnikach nie mniejszych niż wykładnik iloczynu
+        // trafiają do wyniku przed nim, więc iloczyn o tym samym wykładniku
+        // jest dodawany wprost do przeniesionego współczynnika
+        for (; k < acc_size && acc_arr[k].exp >= top.exp; k++)
+            HeapOutputAdd(&out, acc_arr[k].exp, acc_arr[k].p);
+
+        HeapOutputMulAdd(&out, top.exp, &s->arr[top.i].p, &l->arr[top.j].p);
+        HeapAdvance(heap, &heap_size, s, l, is_checked);
+    }
+
+    for (; k < acc_size; k++)
+        HeapOutputAdd(&out, acc_arr[k].exp, acc_arr[k].p);
+
+    PolyScratchRelease(mark);
+    if (!PolyIsCoeff(acc))
+        MonosFree(acc->arr);
+
+    *acc = HeapOutputFinish(&out);
+}
+
+/**
+ * Podnosi do kwadratu wielomian niebędący współczynnikiem metodą kopcową.
+ * Wyznacza tylko iloczyny jednomianów @f$(i, j)@f$ dla @f$i \le j@f$,
+ * a iloczyny spoza przekątnej podwaja.
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$p^2@f$
+ */
+static Poly PolySqrHeap(const Poly *p)
+{
+    PolyArenaMark mark = PolyScratchMark();
+    HeapEntry *heap =
+        PolyArenaAlloc(PolyScratch(), p->size * sizeof(HeapEntry));
+    size_t heap_size = 0;
+    bool is_checked = PolyOverflowIsChecked();
+    HeapPush(heap, &heap_size, p, p, 0, 0, is_checked);
+
+    HeapOutput out = HeapOutputNew();
+
+    while (heap_size > 0)
+    {
+        HeapEntry top = heap[0];
+        Poly prod;
+        if (top.i == top.j)
+        {
+            prod = PolySqr(&p->arr[top.i].p);
+        }
+        else
+        {
+            prod = PolyMul(&p->arr[top.i].p, &p->arr[top.j].p);
+            PolyMulByCoeffTo(&prod, 2);
+        }
+        HeapOutputAdd(&out, top.exp, prod);
+
+        // wiersz i zaczyna się od (i, i), więc wiersz i + 1 jest otwierany
+        // po zdjęciu (i, i), bo 2e_{i+1} nie przekracza e_i + e_{i+1}
+        HeapPop(heap, &heap_size);
+        if (top.i == top.j && top.i + 1 < p->size)
+            HeapPush(heap, &heap_size, p, p, top.i + 1, top.i + 1,
+                     is_checked);
+        if (top.j + 1 < p->size)
+            HeapPush(heap, &heap_size, p, p, top.i, top.j + 1, is_checked);
+    }
+
+    PolyScratchRelease(mark);
+
+    return HeapOutputFinish(&out);
+}
+
+Poly PolySqr(const Poly *p)
+{
+    bool is_checked = PolyOverflowIsChecked();
+    if (PolyIsCoeff(p))
+    {
+        poly_coeff_t c = p->coeff;
+        return PolyFromCoeff(is_checked ? CoeffMul(c, c)
+                                        : CoeffMulUnchecked(c, c));
+    }
+
+    // oszacowanie jest wyznaczane raz na kwadrat, tak jak w ::PolyMul
+    if (is_checked && PolyMulFastIsSafe(p, p))
+    {
+        bool was_safe = PolyOverflowSetProvenSafe(true);
+        Poly res_poly = PolySqr(p);
+        PolyOverflowSetProvenSafe(was_safe);
+
+        return res_poly;
+    }
+
+    // szybkie algorytmy nie wykrywają przepełnień
+    if (!is_checked && PolyMulKroneckerIsWorth(p, p))
+        return PolyMulKronecker(p, p);
+
+    if (!is_checked && PolyMulParallelIsWorth(p, p))
+        return PolyMulParallel(p, p);
+
+    if (!is_checked && PolyIsDense(p))
+        return PolyMulDense(p, p);
+
+    if ((size_t)p->size * p->size >= MUL_HEAP_MIN_PRODUCTS)
+        return PolySqrHeap(p);
+
+    size_t monos_size = (size_t)p->size * (p->size + 1) / 2;
+    Mono *monos = MonosAlloc(monos_size);
+
+    size_t idx = 0;
+    for (size_t i = 0; i < p->size; i++)
+    {
+        poly_exp_t exp = is_checked
+                             ? ExpAdd(p->arr[i].exp, p->arr[i].exp)
+                             : ExpAddUnchecked(p->arr[i].exp, p->arr[i].exp);
+        monos[idx++] = (Mono){.p = PolySqr(&p->arr[i].p), .exp = exp};
+        for (size_t j = i + 1; j < p->size; j++)
+        {
+            exp = is_checked ? ExpAdd(p->arr[i].exp, p->arr[j].exp)
+                             : ExpAddUnchecked(p->arr[i].exp, p->arr[j].exp);
+            monos[idx] = (Mono){.p = PolyMul(&p->arr[i].p, &p->arr[j].p),
+                                .exp = exp};
+            PolyMulByCoeffTo(&monos[idx].p, 2);
+            idx++;
+        }
+    }
+
+    return PolyOwnMonosArray(monos_size, monos);
+}
+
+/**
+ * Typ, w którym wykonywane są obliczenia na współczynnikach liczbowych w
+ * ::PolyMulDense. Arytmetyka bez znaku ma zdefiniowane przepełnienie, a jej
+ * wynik modulo @f$2^{64}@f$ jest taki sam jak przy mnożeniu szkolnym.
+ */
+typedef unsigned long dense_coeff_t;
+
+bool PolyIsDense(const Poly *p)
+{
+    if (PolyIsCoeff(p) || p->size < DENSE_MUL_MIN_SIZE)
+        return false;
+
+    size_t span = (size_t)(p->arr[0].exp - p->arr[p->size - 1].exp) + 1;
+    return span <= DENSE_MUL_MAX_SPAN_RATIO * (size_t)p->size;
+}
+
+/**
+ * Zwraca rozpiętość wykładników wielomianu niebędącego współczynnikiem.
+ * @param[in] p : wielomian @f$p@f$
+ * @return liczba potęg między najmniejszym a największym wykładnikiem
+ */
+static size_t PolySpan(const Poly *p)
+{
+    return (size_t)(p->arr[0].exp - p->arr[p->size - 1].exp) + 1;
+}
+
+/**
+ * Sprawdza, czy wszystkie współczynniki jednomianów wielomianu są liczbami.
+ * @param[in] p : wielomian @f$p@f$ niebędący współczynnikiem
+ * @return czy wielomian jest wielomianem jednej zmiennej
+ */
+static bool PolyHasCoeffMonos(const Poly *p)
+{
+    for (size_t i = 0; i < p->size; i++)
+        if (!PolyIsCoeff(&p->arr[i].p))
+            return false;
+
+    return true;
+}
+
+/**
+ * Zwraca rozmiar tablicy pomocniczej potrzebnej w ::KaratsubaCoeffs dla
+ * ciągów długości @p n.
+ * @param[in] n : długość ciągów
+ * @return rozmiar tablicy pomocniczej
+ */
+static size_t KaratsubaScratchSize(size_t n)
+{
+    if (n < KARATSUBA_MIN_SIZE)
+        return 0;
+
+    size_t h = n - n / 2;
+    return 4 * h + KaratsubaScratchSize(h);
+}
+
+/**
+ * Mnoży ciągi liczb @p a i @p b długości @p n algorytmem Karatsuby.
+ * Zapisuje @f$2n - 1@f$ współczynników iloczynu do @p res.
+ * @param[in] a : ciąg @f$a@f$
+ * @param[in] b : ciąg @f$b@f$
+ * @param[in] n : długość ciągów
+ * @param[out] res : ciąg współczynników iloczynu
+ * @param[in,out] scratch : tablica pomocnicza rozmiaru
+ * ::KaratsubaScratchSize(@p n)
+ */
+static void KaratsubaCoeffs(const dense_coeff_t *a, const dense_coeff_t *b,
+                            size_t n, dense_coeff_t *res,
+                            dense_coeff_t *scratch)
+{
+    if (n < KARATSUBA_MIN_SIZE)
+    {
+        memset(res, 0, (2 * n - 1) * sizeof(dense_coeff_t));
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                res[i + j] += a[i] * b[j];
+        return;
+    }
+
+    size_t m = n / 2;
+    size_t h = n - m;
+
+    dense_coeff_t *sum_a = scratch;
+    dense_coeff_t *sum_b = scratch + h;
+    dense_coeff_t *mid = scratch + 2 * h;
+
+    // z0 = a0 * b0 na pozycjach [0, 2m - 1), z2 = a1 * b1 od pozycji 2m
+    KaratsubaCoeffs(a, b, m, res, scratch + 4 * h);
+    res[2 * m - 1] = 0;
+    KaratsubaCoeffs(a + m, b + m, h, res + 2 * m, scratch + 4 * h);
+
+    for (size_t i = 0; i < h; i++)
+    {
+        sum_a[i] = a[m + i] + (i < m ? a[i] : 0);
+        sum_b[i] = b[m + i] + (i < m ? b[i] : 0);
+    }
+
+    // (a0 + a1)(b0 + b1) - z0 - z2 = a0 * b1 + a1 * b0
+    KaratsubaCoeffs(sum_a, sum_b, h, mid, scratch + 4 * h);
+    for (size_t i = 0; i < 2 * m - 1; i++)
+        mid[i] -= res[i];
+    for (size_t i = 0; i < 2 * h - 1; i++)
+        mid[i] -= res[2 * m + i];
+
+    for (size_t i = 0; i < 2 * h - 1; i++)
+        res[m + i] += mid[i];
+}
+
+/**
+ * Odejmuje wielomian @f$q@f$ od wielomianu @f$p@f$.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ */
+static void PolySubFrom(Poly *p, const Poly *q)
+{
+    if (PolyIsZero(q))
+        return;
+
+    Poly neg_q = PolyNeg(q);
+    PolyAddTo(p, &neg_q);
+    PolyDestroy(&neg_q);
+}
+
+/**
+ * Mnoży ciągi wielomianów @p a i @p b długości @p n algorytmem Karatsuby.
+ * Zapisuje @f$2n - 1@f$ współczynników iloczynu do @p res.
+ * @param[in] a : ciąg @f$a@f$
+ * @param[in] b : ciąg @f$b@f$
+ * @param[in] n : długość ciągów
+ * @param[out] res : ciąg współczynników iloczynu
+ */
+static void KaratsubaPolies(const Poly *a, const Poly *b, size_t n, Poly *res)
+{
+    for (size_t i = 0; i < 2 * n - 1; i++)
+        res[i] = PolyZero();
+
+    if (n < KARATSUBA_POLY_MIN_SIZE)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (PolyIsZero(&a[i]))
+                continue;
+
+            for (size_t j = 0; j < n; j++)
+            {
+                if (PolyIsZero(&b[j]))
+                    continue;
+
+                PolyMulAddTo(&res[i + j], &a[i], &b[j]);
+            }
+        }
+        return;
+    }
+
+    size_t m = n / 2;
+    size_t h = n - m;
+
+    PolyArenaMark mark = PolyScratchMark();
+    Poly *sum_a = PolyArenaAlloc(PolyScratch(), 2 * h * sizeof(Poly));
+    Poly *sum_b = sum_a + h;
+    Poly *mid = PolyArenaAlloc(PolyScratch(), (2 * h - 1) * sizeof(Poly));
+
+    KaratsubaPolies(a, b, m, res);
+    KaratsubaPolies(a + m, b + m, h, res + 2 * m);
+
+    for (size_t i = 0; i < h; i++)
+    {
+        sum_a[i] = PolyClone(&a[m + i]);
+        sum_b[i] = PolyClone(&b[m + i]);
+        if (i < m)
+        {
+            PolyAddTo(&sum_a[i], &a[i]);
+            PolyAddTo(&sum_b[i], &b[i]);
+        }
+    }
+
+    KaratsubaPolies(sum_a, sum_b, h, mid);
+    for (size_t i = 0; i < 2 * m - 1; i++)
+        PolySubFrom(&mid[i], &res[i]);
+    for (size_t i = 0; i < 2 * h - 1; i++)
+        PolySubFrom(&mid[i], &res[2 * m + i]);
+
+    for (size_t i = 0; i < 2 * h - 1; i++)
+    {
+        PolyAddTo(&res[m + i], &mid[i]);
+        PolyDestroy(&mid[i]);
+    }
+
+    for (size_t i = 0; i < 2 * h; i++)
+        PolyDestroy(&sum_a[i]);
+
+    PolyScratchRelease(mark);
+}
+
+/**
+ * Tworzy wielomian z gęstego ciągu współczynników liczbowych przy kolejnych
+ * potęgach, zaczynając od potęgi @p min_exp.
+ * @param[in] coeffs : ciąg współczynników
+ * @param[in] len : długość ciągu
+ * @param[in] min_exp : wykładnik pierwszego współczynnika
+ * @return wielomian w postaci uproszczonej
+ */
+static Poly PolyFromDenseCoeffs(const dense_coeff_t *coeffs, size_t len,
+                                poly_exp_t min_exp)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++)
+        if (coeffs[i] != 0)
+            count++;
+
+    if (count == 0)
+        return PolyZero();
+
+    if (count == 1 && min_exp == 0 && coeffs[0] != 0)
+        return PolyFromCoeff((poly_coeff_t)coeffs[0]);
+
+    Mono *monos = MonosAlloc(count);
+
+    size_t idx = 0;
+    for (size_t i = len; i-- > 0;)
+    {
+        if (coeffs[i] != 0)
+        {
+            monos[idx].p = PolyFromCoeff((poly_coeff_t)coeffs[i]);
+            monos[idx].exp = min_exp + (poly_exp_t)i;
+            idx++;
+        }
+    }
+
+    return (Poly){.size = count, .arr = monos};
+}
+
+/**
+ * Tworzy wielomian z gęstego ciągu współczynników przy kolejnych potęgach,
+ * zaczynając od potęgi @p min_exp. Przejmuje na własność elementy ciągu.
+ * @param[in,out] coeffs : ciąg współczynników
+ * @param[in] len : długość ciągu
+ * @param[in] min_exp : wykładnik pierwszego współczynnika
+ * @return wielomian w postaci uproszczonej
+ */
+static Poly PolyFromDensePolies(Poly *coeffs, size_t len, poly_exp_t min_exp)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++)
+        if (!PolyIsZero(&coeffs[i]))
+            count++;
+
+    if (count == 0)
+        return PolyZero();
+
+    if (count == 1 && min_exp == 0 && PolyIsCoeff(&coeffs[0]) &&
+        !PolyIsZero(&coeffs[0]))
+        return coeffs[0];
+
+    Mono *monos = MonosAlloc(count);
+
+    size_t idx = 0;
+    for (size_t i = len; i-- > 0;)
+    {
+        if (!PolyIsZero(&coeffs[i]))
+        {
+            monos[idx].p = coeffs[i];
+            monos[idx].exp = min_exp + (poly_exp_t)i;
+            idx++;
+        }
+    }
+
+    return (Poly){.size = count, .arr = monos};
+}
+
+/**
+ * Mnoży wielomiany jednej zmiennej o gęstych współczynnikach liczbowych.
+ * Dłuższy ciąg jest dzielony na fragmenty długości krótszego, mnożone
+ * algorytmem Karatsuby.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+static Poly PolyMulDenseCoeffs(const Poly *p, const Poly *q)
+{
+    const Poly *s = PolySpan(p) <= PolySpan(q) ? p : q;
+    const Poly *l = PolySpan(p) <= PolySpan(q) ? q : p;
+    size_t s_len = PolySpan(s);
+    size_t l_len = PolySpan(l);
+    poly_exp_t s_min = s->arr[s->size - 1].exp;
+    poly_exp_t l_min = l->arr[l->size - 1].exp;
+
+    // ciągi są uzupełniane zerami do wielokrotności długości krótszego
+    size_t chunks = (l_len + s_len - 1) / s_len;
+    PolyArenaMark mark = PolyScratchMark();
+    PolyArena *arena = PolyScratch();
+    dense_coeff_t *s_coeffs =
+        PolyArenaAlloc(arena, s_len * sizeof(dense_coeff_t));
+    dense_coeff_t *l_coeffs =
+        PolyArenaAlloc(arena, chunks * s_len * sizeof(dense_coeff_t));
+    dense_coeff_t *res =
+        PolyArenaAlloc(arena, (chunks + 1) * s_len * sizeof(dense_coeff_t));
+    dense_coeff_t *part =
+        PolyArenaAlloc(arena, 2 * s_len * sizeof(dense_coeff_t));
+    dense_coeff_t *scratch = PolyArenaAlloc(
+        arena, (KaratsubaScratchSize(s_len) + 1) * sizeof(dense_coeff_t));
+    memset(s_coeffs, 0, s_len * sizeof(dense_coeff_t));
+    memset(l_coeffs, 0, chunks * s_len * sizeof(dense_coeff_t));
+    memset(res, 0, (chunks + 1) * s_len * sizeof(dense_coeff_t));
+
+    for (size_t i = 0; i < s->size; i++)
+        s_coeffs[s->arr[i].exp - s_min] = (dense_coeff_t)s->arr[i].p.coeff;
+    for (size_t i = 0; i < l->size; i++)
+        l_coeffs[l->arr[i].exp - l_min] = (dense_coeff_t)l->arr[i].p.coeff;
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        KaratsubaCoeffs(l_coeffs + c * s_len, s_coeffs, s_len, part, scratch);
+        for (size_t i = 0; i < 2 * s_len - 1; i++)
+            res[c * s_len + i] += part[i];
+    }
+
+    Poly res_poly = PolyFromDenseCoeffs(res, l_len + s_len - 1, s_min + l_min);
+
+    PolyScratchRelease(mark);
+
+    return res_poly;
+}
+
+/**
+ * Mnoży wielomiany o gęstych współczynnikach będących wielomianami. Dłuższy
+ * ciąg jest dzielony na fragmenty długości krótszego, mnożone algorytmem
+ * Karatsuby.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+static Poly PolyMulDensePolies(const Poly *p, const Poly *q)
+{
+    const Poly *s = PolySpan(p) <= PolySpan(q) ? p : q;
+    const Poly *l = PolySpan(p) <= PolySpan(q) ? q : p;
+    size_t s_len = PolySpan(s);
+    size_t l_len = PolySpan(l);
+    poly_exp_t s_min = s->arr[s->size - 1].exp;
+    poly_exp_t l_min = l->arr[l->size - 1].exp;
+    size_t chunks = (l_len + s_len - 1) / s_len;
+    size_t res_len = (chunks + 1) * s_len;
+
+    // ciągi tylko pożyczają współczynniki jednomianów p i q
+    PolyArenaMark mark = PolyScratchMark();
+    PolyArena *arena = PolyScratch();
+    Poly *s_coeffs = PolyArenaAlloc(arena, s_len * sizeof(Poly));
+    Poly *l_coeffs = PolyArenaAlloc(arena, chunks * s_len * sizeof(Poly));
+    Poly *res = PolyArenaAlloc(arena, res_len * sizeof(Poly));
+    Poly *part = PolyArenaAlloc(arena, 2 * s_len * sizeof(Poly));
+
+    for (size_t i = 0; i < s_len; i++)
+        s_coeffs[i] = PolyZero();
+    for (size_t i = 0; i < chunks * s_len; i++)
+        l_coeffs[i] = PolyZero();
+    for (size_t i = 0; i < res_len; i++)
+        res[i] = PolyZero();
+
+    for (size_t i = 0; i < s->size; i++)
+        s_coeffs[s->arr[i].exp - s_min] = s->arr[i].p;
+    for (size_t i = 0; i < l->size; i++)
+        l_coeffs[l->arr[i].exp - l_min] = l->arr[i].p;
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        KaratsubaPolies(l_coeffs + c * s_len, s_coeffs, s_len, part);
+        for (size_t i = 0; i < 2 * s_len - 1; i++)
+        {
+            PolyAddTo(&res[c * s_len + i], &part[i]);
+            PolyDestroy(&part[i]);
+        }
+    }
+
+    Poly res_poly = PolyFromDensePolies(res, l_len + s_len - 1, s_min + l_min);
+
+    PolyScratchRelease(mark);
+
+    return res_poly;
+}
+
+Poly PolyMulDense(const Poly *p, const Poly *q)
+{
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    if (PolyHasCoeffMonos(p) && PolyHasCoeffMonos(q))
+        return PolyMulDenseCoeffs(p, q);
+    else
+        return PolyMulDensePolies(p, q);
+}
+
+/** Liczba modułów, których może użyć ::PolyMulKronecker */
+#define NTT_PRIMES_COUNT 6
+
+/**
+ * Logarytm dwójkowy maksymalnej długości transformaty. Każdy z modułów ma
+ * pierwiastek z jedności tego rzędu.
+ */
+#define NTT_MAX_LOG_SIZE 23
+
+/** Moduł transformaty teoretycznoliczbowej */
+typedef struct
+{
+    uint32_t mod;  ///< liczba pierwsza postaci @f$k\cdot 2^m + 1@f$
+    uint32_t root; ///< pierwiastek pierwotny modulo @p mod
+    unsigned bits; ///< podłoga z logarytmu dwójkowego @p mod
+} NttPrime;
+
+/** Moduły transformaty, malejąco po liczbie bitów */
+static const NttPrime NTT_PRIMES[NTT_PRIMES_COUNT] = {
+    {2013265921, 31, 30}, {2113929217, 5, 30}, {1811939329, 13, 30},
+    {998244353, 3, 29},   {754974721, 11, 29}, {469762049, 3, 28}};
+
+/**
+ * Podnosi liczbę do potęgi modulo @p mod.
+ * @param[in] base : podstawa
+ * @param[in] exp : wykładnik
+ * @param[in] mod : moduł
+ * @return @f$base^{exp} \bmod mod@f$
+ */
+static uint32_t PowMod(uint32_t base, uint64_t exp, uint32_t mod)
+{
+    uint64_t res = 1;
+    uint64_t b = base % mod;
+    while (exp > 0)
+    {
+        if (exp & 1)
+            res = res * b % mod;
+        b = b * b % mod;
+        exp >>= 1;
+    }
+
+    return (uint32_t)res;
+}
+
+/**
+ * Wyznacza @f$-p^{-1} \bmod 2^{32}@f$ dla nieparzystego modułu @f$p@f$,
+ * potrzebne w mnożeniu Montgomery'ego.
+ * @param[in] mod : moduł @f$p@f$
+ * @return @f$-p^{-1} \bmod 2^{32}@f$
+ */
+static uint32_t MontgomeryInv(uint32_t mod)
+{
+    // każdy krok metody Newtona podwaja liczbę poprawnych bitów odwrotności
+    uint32_t inv = mod;
+    for (int i = 0; i < 4; i++)
+        inv *= 2 - mod * inv;
+
+    return -inv;
+}
+
+/**
+ * Mnoży liczby metodą Montgomery'ego, bez dzielenia.
+ * @param[in] a : liczba z przedziału @f$[0, p)@f$
+ * @param[in] b : liczba z przedziału @f$[0, p)@f$
+ * @param[in] mod : moduł @f$p < 2^{31}@f$
+ * @param[in] mod_inv : ::MontgomeryInv(@p mod)
+ * @return @f$a b 2^{-32} \bmod p@f$
+ */
+static inline uint32_t MontMul(uint32_t a, uint32_t b, uint32_t mod,
+                               uint32_t mod_inv)
+{
+    uint64_t t = (uint64_t)a * b;
+    uint32_t m = (uint32_t)t * mod_inv;
+    uint32_t u = (uint32_t)((t + (uint64_t)m * mod) >> 32);
+
+    return u >= mod ? u - mod : u;
+}
+
+/**
+ * Wykonuje w miejscu transformatę teoretycznoliczbową ciągu długości @p n
+ * będącej potęgą dwójki. Transformata odwrotna nie jest dzielona przez
+ * @p n.
+ * @param[in,out] a : ciąg reszt modulo moduł @p prime
+ * @param[in] n : długość ciągu
+ * @param[in] prime : moduł transformaty
+ * @param[in] inverse : czy wykonać transformatę odwrotną
+ * @param[in,out] twiddles : tablica pomocnicza rozmiaru @f$n / 2@f$
+ */
+static void Ntt(uint32_t *a, size_t n, const NttPrime *prime, bool inverse,
+                uint32_t *twiddles)
+{
+    uint32_t mod = prime->mod;
+    uint32_t mod_inv = MontgomeryInv(mod);
+    uint64_t r = ((uint64_t)1 << 32) % mod;
+
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+        {
+            uint32_t temp = a[i];
+            a[i] = a[j];
+            a[j] = temp;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1)
+    {
+        uint32_t w_len = PowMod(prime->root, (mod - 1) / len, mod);
+        if (inverse)
+            w_len = PowMod(w_len, mod - 2, mod);
+
+        // pierwiastki w postaci Montgomery'ego, więc mnożenie przez nie daje
+        // zwykłą resztę
+        size_t half = len / 2;
+        uint32_t w_len_mont = (uint32_t)(w_len * r % mod);
+        twiddles[0] = (uint32_t)r;
+        for (size_t k = 1; k < half; k++)
+            twiddles[k] = MontMul(twiddles[k - 1], w_len_mont, mod, mod_inv);
+
+        for (size_t i = 0; i < n; i += len)
+        {
+            for (size_t k = 0; k < half; k++)
+            {
+                uint32_t u = a[i + k];
+                uint32_t v =
+                    MontMul(a[i + k + half], twiddles[k], mod, mod_inv);
+                a[i + k] = u + v >= mod ? u + v - mod : u + v;
+                a[i + k + half] = u >= v ? u - v : u + mod - v;
+            }
+        }
+    }
+}
+
+/** Statystyki wielomianu potrzebne do zaplanowania ::PolyMulKronecker */
+typedef struct
+{
+    size_t vars;           ///< liczba zmiennych
+    size_t leaves;         ///< liczba współczynników liczbowych
+    unsigned long max_abs; ///< największa wartość bezwzględna współczynnika
+} KroneckerStats;
+
+/**
+ * Wyznacza statystyki wielomianu, przechodząc rekurencyjnie jego drzewo.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] var : indeks zmiennej, której wielomianem jest @f$p@f$
+ * @param[in,out] stats : statystyki
+ */
+static void PolyKroneckerStats(const Poly *p, size_t var,
+                               KroneckerStats *stats)
+{
+    if (PolyIsCoeff(p))
+    {
+        unsigned long abs_coeff = p->coeff < 0 ? -(unsigned long)p->coeff
+                                               : (unsigned long)p->coeff;
+        stats->leaves++;
+        if (var > stats->vars)
+            stats->vars = var;
+        if (abs_coeff > stats->max_abs)
+            stats->max_abs = abs_coeff;
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; i++)
+        PolyKroneckerStats(&p->arr[i].p, var + 1, stats);
+}
+
+/**
+ * Sprawdza, czy iloczyn niezerowych wielomianów @f$p@f$ i @f$q@f$ wymaga co
+ * najmniej @p min_products iloczynów współczynników liczbowych. Przechodzi
+ * tylko tyle drzew, ile potrzeba do odpowiedzi, więc dla małych iloczynów,
+ * np. współczynników mnożonych rekurencyjnie, działa w czasie
+ * @f$\mathrm{O}(\mathrm{min\_products})@f$, a nie w czasie liniowym
+ * względem wielkości wielomianów.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] min_products : wymagana liczba iloczynów, dodatnia
+ * @return czy iloczynów jest co najmniej @p min_products
+ */
+static bool PolyMulHasProducts(const Poly *p, const Poly *q,
+                               size_t min_products)
+{
+    size_t p_leaves = PolyCountLeaves(p, min_products);
+    size_t q_needed = (min_products + p_leaves - 1) / p_leaves;
+
+    return PolyCountLeaves(q, q_needed) >= q_needed;
+}
+
+/**
+ * Wyznacza stopnie wielomianu względem kolejnych zmiennych, tak jak
+ * ::PolyDegBy, ale w jednym przejściu drzewa.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] var : indeks zmiennej, której wielomianem jest @f$p@f$
+ * @param[in,out] degs : stopnie względem zmiennych, początkowo zerowe
+ */
+static void PolyKroneckerDegs(const Poly *p, size_t var, poly_exp_t *degs)
+{
+    if (PolyIsCoeff(p))
+        return;
+
+    for (size_t i = 0; i < p->size; i++)
+    {
+        if (p->arr[i].exp > degs[var])
+            degs[var] = p->arr[i].exp;
+        PolyKroneckerDegs(&p->arr[i].p, var + 1, degs);
+    }
+}
+
+/**
+ * Zwraca liczbę bitów potrzebnych do zapisania liczby.
+ * @param[in] x : liczba
+ * @return liczba bitów
+ */
+static unsigned BitLength(unsigned long x)
+{
+    unsigned bits = 0;
+    while (x > 0)
+    {
+        bits++;
+        x >>= 1;
+    }
+
+    return bits;
+}
+
+/** Plan mnożenia przez podstawienie Kroneckera */
+typedef struct
+{
+    size_t vars;      ///< liczba zmiennych
+    poly_exp_t *degs; ///< stopnie iloczynu względem kolejnych zmiennych
+    size_t *strides;  ///< mnożniki wykładników kolejnych zmiennych
+    size_t res_len;   ///< długość spakowanego iloczynu
+    size_t ntt_size;  ///< długość transformaty
+    size_t primes;    ///< liczba użytych modułów
+} KroneckerPlan;
+
+/**
+ * Planuje mnożenie przez podstawienie Kroneckera. Zmienna o indeksie
+ * @f$k@f$ dostaje mnożnik @f$S_k = \prod_{j > k} (d_j + 1)@f$, gdzie
+ * @f$d_j@f$ to stopień iloczynu względem zmiennej @f$x_j@f$, więc wykładniki
+ * różnych jednomianów iloczynu nie kolidują po spakowaniu.
+ * @param[out] plan : plan mnożenia
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] p_stats : statystyki wielomianu @f$p@f$
+ * @param[in] q_stats : statystyki wielomianu @f$q@f$
+ * @return czy spakowany iloczyn mieści się w transformacie
+ */
+static bool KroneckerPlanInit(KroneckerPlan *plan, const Poly *p,
+                              const Poly *q, const KroneckerStats *p_stats,
+                              const KroneckerStats *q_stats)
+{
+    plan->vars =
+        p_stats->vars > q_stats->vars ? p_stats->vars : q_stats->vars;
+    plan->degs = PolyMalloc(plan->vars * sizeof(poly_exp_t));
+    memset(plan->degs, 0, plan->vars * sizeof(poly_exp_t));
+    plan->strides = PolyMalloc(plan->vars * sizeof(size_t));
+
+    poly_exp_t *q_degs = PolyMalloc(plan->vars * sizeof(poly_exp_t));
+    memset(q_degs, 0, plan->vars * sizeof(poly_exp_t));
+    PolyKroneckerDegs(p, 0, plan->degs);
+    PolyKroneckerDegs(q, 0, q_degs);
+
+    const size_t max_size = (size_t)1 << NTT_MAX_LOG_SIZE;
+    bool fits = true;
+    size_t len = 1;
+    for (size_t k = plan->vars; k-- > 0 && fits;)
+    {
+        plan->degs[k] += q_degs[k];
+        plan->strides[k] = len;
+
+        size_t dim = (size_t)plan->degs[k] + 1;
+        fits = len <= max_size / dim;
+        len *= dim;
+    }
+
+    PolyFree(q_degs);
+
+    plan->res_len = len;
+    plan->ntt_size = 1;
+    while (fits && plan->ntt_size < len)
+        plan->ntt_size <<= 1;
+
+    // wynik musi być dokładny, więc iloczyn modułów musi przekraczać
+    // podwojone ograniczenie na wartość bezwzględną współczynnika iloczynu
+    size_t min_leaves = p_stats->leaves < q_stats->leaves ? p_stats->leaves
+                                                          : q_stats->leaves;
+    unsigned bound_bits = BitLength(p_stats->max_abs) +
+                          BitLength(q_stats->max_abs) +
+                          BitLength(min_leaves) + 1;
+    unsigned bits = 0;
+    plan->primes = 0;
+    while (bits < bound_bits)
+        bits += NTT_PRIMES[plan->primes++].bits;
+
+    return fits;
+}
+
+/**
+ * Usuwa z pamięci plan mnożenia.
+ * @param[in,out] plan : plan mnożenia
+ */
+static void KroneckerPlanDestroy(KroneckerPlan *plan)
+{
+    PolyFree(plan->degs);
+    PolyFree(plan->strides);
+}
+
+/**
+ * Pakuje współczynniki wielomianu do ciągu według planu mnożenia.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] var : indeks zmiennej, której wielomianem jest @f$p@f$
+ * @param[in] plan : plan mnożenia
+ * @param[in] offset : spakowany wykładnik jednomianu zawierającego @f$p@f$
+ * @param[in,out] packed : spakowany ciąg współczynników
+ */
+static void PolyKroneckerPack(const Poly *p, size_t var,
+                              const KroneckerPlan *plan, size_t offset,
+                              poly_coeff_t *packed)
+{
+    if (PolyIsCoeff(p))
+    {
+        packed[offset] = p->coeff;
+        return;
+    }
+
+    for (size_t i = 0; i < p->size; i++)
+        PolyKroneckerPack(&p->arr[i].p, var + 1, plan,
+                          offset + (size_t)p->arr[i].exp * plan->strides[var],
+                          packed);
+}
+
+/**
+ * Odtwarza wielomian z fragmentu spakowanego ciągu współczynników.
+ * @param[in] packed : spakowany ciąg współczynników
+ * @param[in] var : indeks zmiennej, której wielomian jest odtwarzany
+ * @param[in] plan : plan mnożenia
+ * @param[in] offset : początek fragmentu
+ * @return wielomian w postaci uproszczonej
+ */
+static Poly PolyKroneckerUnpack(const poly_coeff_t *packed, size_t var,
+                                const KroneckerPlan *plan, size_t offset)
+{
+    if (var == plan->vars)
+        return PolyFromCoeff(packed[offset]);
+
+    size_t res_max_size = INIT_SIZE;
+    size_t res_size = 0;
+    Mono *res_arr = MonosAlloc(res_max_size);
+
+    for (poly_exp_t exp = plan->degs[var]; exp >= 0; exp--)
+    {
+        Poly coeff = PolyKroneckerUnpack(
+            packed, var + 1, plan, offset + (size_t)exp * plan->strides[var]);
+        if (PolyIsZero(&coeff))
+            continue;
+
+        if (res_size == res_max_size)
+        {
+            res_arr = MonosRealloc(res_arr, res_max_size * MEM_SIZE_MULT);
+            res_max_size *= MEM_SIZE_MULT;
+        }
+
+        res_arr[res_size].p = coeff;
+        res_arr[res_size].exp = exp;
+        res_size++;
+    }
+
+    if (res_size == 0)
+    {
+        MonosFree(res_arr);
+        return PolyZero();
+    }
+
+    if (res_size == 1 && res_arr[0].exp == 0 && PolyIsCoeff(&res_arr[0].p))
+    {
+        poly_coeff_t c = res_arr[0].p.coeff;
+        MonosFree(res_arr);
+        return PolyFromCoeff(c);
+    }
+
+    Poly res_poly;
+    res_poly.size = res_size;
+    res_poly.arr = res_arr;
+
+    return res_poly;
+}
+
+/**
+ * Odtwarza współczynnik z reszt modulo kolejne moduły algorytmem Garnera.
+ * Współczynnik jest liczbą z przedziału @f$(-M/2, M/2)@f$, gdzie @f$M@f$ to
+ * iloczyn modułów, i jest zwracany modulo @f$2^{64}@f$.
+ * @param[in] residues : reszty modulo kolejne moduły
+ * @param[in] primes : liczba modułów
+ * @param[in] inverses : odwrotności modułów, @p inverses[i][j] to odwrotność
+ * @f$p_j@f$ modulo @f$p_i@f$
+ * @return współczynnik
+ */
+static poly_coeff_t
+GarnerReconstruct(const uint32_t *residues, size_t primes,
+                  const uint32_t inverses[][NTT_PRIMES_COUNT])
+{
+    uint32_t digits[NTT_PRIMES_COUNT];
+    for (size_t i = 0; i < primes; i++)
+    {
+        uint32_t mod = NTT_PRIMES[i].mod;
+        uint64_t t = residues[i];
+        for (size_t j = 0; j < i; j++)
+            t = (t + mod - digits[j] % mod) % mod * inverses[i][j] % mod;
+        digits[i] = (uint32_t)t;
+    }
+
+    // cyfry (M - 1) / 2 w systemie o podstawach p_i to (p_i - 1) / 2
+    bool negative = false;
+    for (size_t i = primes; i-- > 0;)
+    {
+        uint32_t half = (NTT_PRIMES[i].mod - 1) / 2;
+        if (digits[i] != half)
+        {
+            negative = digits[i] > half;
+            break;
+        }
+    }
+
+    unsigned long res = 0;
+    unsigned long radix = 1;
+    for (size_t i = 0; i < primes; i++)
+    {
+        res += digits[i] * radix;
+        radix *= NTT_PRIMES[i].mod;
+    }
+
+    if (negative)
+        res -= radix;
+
+    return (poly_coeff_t)res;
+}
+
+/**
+ * Zwraca resztę z dzielenia współczynnika przez moduł.
+ * @param[in] c : współczynnik
+ * @param[in] mod : moduł
+ * @return @f$c \bmod mod@f$ z przedziału @f$[0, mod)@f$
+ */
+static uint32_t CoeffMod(poly_coeff_t c, uint32_t mod)
+{
+    poly_coeff_t r = c % (poly_coeff_t)mod;
+    return (uint32_t)(r < 0 ? r + (poly_coeff_t)mod : r);
+}
+
+bool PolyMulKroneckerIsWorth(const Poly *p, const Poly *q)
+{
+    // PolyMul pyta o to przy każdym mnożeniu, także współczynników, więc
+    // małe iloczyny są odrzucane bez przechodzenia całych drzew
+    if (PolyIsCoeff(p) || PolyIsCoeff(q) ||
+        !PolyMulHasProducts(p, q, KRONECKER_MIN_PRODUCTS))
+        return false;
+
+    KroneckerStats p_stats = {0};
+    KroneckerStats q_stats = {0};
+    PolyKroneckerStats(p, 0, &p_stats);
+    PolyKroneckerStats(q, 0, &q_stats);
+
+    double products = (double)p_stats.leaves * q_stats.leaves;
+
+    KroneckerPlan plan;
+    bool worth = KroneckerPlanInit(&plan, p, q, &p_stats, &q_stats);
+    if (worth)
+    {
+        double cost = (double)plan.primes * plan.ntt_size *
+                      BitLength(plan.ntt_size - 1);
+        worth = cost <= KRONECKER_MAX_COST_RATIO * products;
+    }
+    KroneckerPlanDestroy(&plan);
+
+    return worth;
+}
+
+/** Wspólne dane zadań puli wykonujących ::PolyMulKronecker */
+typedef struct
+{
+    const KroneckerPlan *plan;    ///< plan mnożenia
+    const poly_coeff_t *packed_p; ///< spakowane współczynniki @f$p@f$
+    const poly_coeff_t *packed_q; ///< spakowane współczynniki @f$q@f$
+    uint32_t *residues;           ///< reszty współczynników iloczynu
+    poly_coeff_t *res;            ///< współczynniki iloczynu
+    size_t chunks;                ///< liczba fragmentów w algorytmie Garnera
+    /** odwrotności modułów dla ::GarnerReconstruct */
+    uint32_t inverses[NTT_PRIMES_COUNT][NTT_PRIMES_COUNT];
+} KroneckerJob;
+
+/**
+ * Wyznacza reszty współczynników iloczynu modulo @p r -ty moduł.
+ * @param[in,out] arg : dane mnożenia typu ::KroneckerJob
+ * @param[in] r : indeks modułu
+ */
+static void KroneckerPrimeTask(void *arg, size_t r)
+{
+    KroneckerJob *job = arg;
+    const KroneckerPlan *plan = job->plan;
+    const NttPrime *prime = &NTT_PRIMES[r];
+    uint32_t mod = prime->mod;
+    uint32_t mod_inv = MontgomeryInv(mod);
+    size_t n = plan->ntt_size;
+
+    uint32_t *ntt_p = PolyMalloc(n * sizeof(uint32_t));
+    uint32_t *twiddles = PolyMalloc((n / 2 + 1) * sizeof(uint32_t));
+
+    for (size_t i = 0; i < n; i++)
+        ntt_p[i] = CoeffMod(job->packed_p[i], mod);
+    Ntt(ntt_p, n, prime, false, twiddles);
+
+    // przy podnoszeniu do kwadratu druga transformata jest taka sama
+    if (job->packed_q == job->packed_p)
+    {
+        for (size_t i = 0; i < n; i++)
+            ntt_p[i] = MontMul(ntt_p[i], ntt_p[i], mod, mod_inv);
+    }
+    else
+    {
+        uint32_t *ntt_q = PolyMalloc(n * sizeof(uint32_t));
+        for (size_t i = 0; i < n; i++)
+            ntt_q[i] = CoeffMod(job->packed_q[i], mod);
+        Ntt(ntt_q, n, prime, false, twiddles);
+
+        for (size_t i = 0; i < n; i++)
+            ntt_p[i] = MontMul(ntt_p[i], ntt_q[i], mod, mod_inv);
+        PolyFree(ntt_q);
+    }
+
+    Ntt(ntt_p, n, prime, true, twiddles);
+
+    // iloczyn punktowy podzielił wynik przez 2^32, a transformata
+    // odwrotna pomnożyła go przez n, więc wynik mnożę przez 2^32 / n
+    uint64_t two_32 = ((uint64_t)1 << 32) % mod;
+    uint64_t n_inv = PowMod((uint32_t)(n % mod), mod - 2, mod);
+    uint32_t scale = (uint32_t)(n_inv * two_32 % mod * two_32 % mod);
+    for (size_t i = 0; i < plan->res_len; i++)
+        job->residues[i * plan->primes + r] =
+            MontMul(ntt_p[i], scale, mod, mod_inv);
+
+    PolyFree(ntt_p);
+    PolyFree(twiddles);
+}
+
+/**
+ * Odtwarza współczynniki iloczynu z @p idx -tego fragmentu spakowanego
+ * ciągu.
+ * @param[in,out] arg : dane mnożenia typu ::KroneckerJob
+ * @param[in] idx : indeks fragmentu
+ */
+static void KroneckerGarnerTask(void *arg, size_t idx)
+{
+    KroneckerJob *job = arg;
+    const KroneckerPlan *plan = job->plan;
+    size_t begin = idx * plan->res_len / job->chunks;
+    size_t end = (idx + 1) * plan->res_len / job->chunks;
+
+    for (size_t i = begin; i < end; i++)
+        job->res[i] = GarnerReconstruct(job->residues + i * plan->primes,
+                                        plan->primes, job->inverses);
+}
+
+Poly PolyMulKronecker(const Poly *p, const Poly *q)
+{
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    KroneckerStats p_stats = {0};
+    KroneckerStats q_stats = {0};
+    PolyKroneckerStats(p, 0, &p_stats);
+    PolyKroneckerStats(q, 0, &q_stats);
+
+    KroneckerPlan plan;
+    if (!KroneckerPlanInit(&plan, p, q, &p_stats, &q_stats))
+    {
+        KroneckerPlanDestroy(&plan);
+        return PolyMulHeap(p, q);
+    }
+
+    size_t n = plan.ntt_size;
+    poly_coeff_t *packed_p = PolyMalloc(n * sizeof(poly_coeff_t));
+    memset(packed_p, 0, n * sizeof(poly_coeff_t));
+    PolyKroneckerPack(p, 0, &plan, 0, packed_p);
+
+    poly_coeff_t *packed_q = packed_p;
+    if (q != p)
+    {
+        packed_q = PolyMalloc(n * sizeof(poly_coeff_t));
+        memset(packed_q, 0, n * sizeof(poly_coeff_t));
+        PolyKroneckerPack(q, 0, &plan, 0, packed_q);
+    }
+
+    // reszty współczynników iloczynu są zapisywane obok siebie dla każdego
+    // spakowanego wykładnika, żeby algorytm Garnera czytał je po kolei
+    uint32_t *residues =
+        PolyMalloc(plan.res_len * plan.primes * sizeof(uint32_t));
+
+    KroneckerJob job = {.plan = &plan,
+                        .packed_p = packed_p,
+                        .packed_q = packed_q,
+                        .residues = residues,
+                        .res = packed_p,
+                        .chunks = PoolIsAvailable() ? PolyGetThreads() : 1};
+
+    // moduły są od siebie niezależne, więc transformaty dla nich mogą być
+    // wykonywane równolegle
+    PoolRun(KroneckerPrimeTask, &job, plan.primes);
+    if (packed_q != packed_p)
+        PolyFree(packed_q);
+
+    for (size_t i = 0; i < plan.primes; i++)
+        for (size_t j = 0; j < i; j++)
+            job.inverses[i][j] = PowMod(
+                NTT_PRIMES[j].mod, NTT_PRIMES[i].mod - 2, NTT_PRIMES[i].mod);
+
+    // packed_p ma co najmniej res_len elementów, więc przechowuje iloczyn
+    PoolRun(KroneckerGarnerTask, &job, job.chunks);
+    PolyFree(residues);
+
+    Poly res_poly = PolyKroneckerUnpack(packed_p, 0, &plan, 0);
+
+    PolyFree(packed_p);
+    KroneckerPlanDestroy(&plan);
+
+    return res_poly;
+}
+
+/** Wspólne dane zadań puli wykonujących ::PolyMulParallel */
+typedef struct
+{
+    const Poly *split; ///< wielomian dzielony na fragmenty
+    const Poly *other; ///< drugi czynnik
+    size_t chunks;     ///< liczba fragmentów
+    Poly *parts;       ///< iloczyny fragmentów przez drugi czynnik
+    size_t stride;     ///< odległość scalanych iloczynów w bieżącej rundzie
+    bool is_checked;   ///< czy wywołujący sprawdza przepełnienia
+} ParMulJob;
+
+/**
+ * Mnoży @p idx -ty fragment dzielonego wielomianu przez drugi czynnik.
+ * @param[in,out] arg : dane mnożenia typu ::ParMulJob
+ * @param[in] idx : indeks fragmentu
+ */
+static void ParMulChunkTask(void *arg, size_t idx)
+{
+    ParMulJob *job = arg;
+    size_t begin = idx * job->split->size / job->chunks;
+    size_t end = (idx + 1) * job->split->size / job->chunks;
+
+    // fragment dostaje własną tablicę, bo licznik odwołań leży przed
+    // tablicą, ale współdzieli jednomiany z dzielonym wielomianem; jedyny
+    // jednomian Cx^0 zastępuję współczynnikiem C, żeby fragment był
+    // w postaci uproszczonej
+    Poly chunk = {.size = end - begin};
+    chunk.arr = MonosAlloc(chunk.size);
+    for (size_t i = 0; i < chunk.size; i++)
+        chunk.arr[i] = MonoClone(&job->split->arr[begin + i]);
+
+    const Poly *chunk_ptr = &chunk;
+    if (chunk.size == 1 && chunk.arr[0].exp == 0 &&
+        PolyIsCoeff(&chunk.arr[0].p))
+        chunk_ptr = &chunk.arr[0].p;
+
+    // wątek puli liczy bez sprawdzania, jeśli wywołujący tak liczy
+    bool was_safe = PolyOverflowSetProvenSafe(!job->is_checked);
+    job->parts[idx] = PolyMul(chunk_ptr, job->other);
+    PolyOverflowSetProvenSafe(was_safe);
+    PolyDestroy(&chunk);
+}
+
+/**
+ * Dodaje do siebie iloczyny fragmentów odległe o @p stride w tablicy
+ * @p parts. Kolejność dodawania nie zależy od liczby wątków.
+ * @param[in,out] arg : dane mnożenia typu ::ParMulJob
+ * @param[in] idx : indeks pary iloczynów
+ */
+static void ParMulMergeTask(void *arg, size_t idx)
+{
+    ParMulJob *job = arg;
+    size_t i = 2 * idx * job->stride;
+
+    bool was_safe = PolyOverflowSetProvenSafe(!job->is_checked);
+    PolyAddTo(&job->parts[i], &job->parts[i + job->stride]);
+    PolyOverflowSetProvenSafe(was_safe);
+    PolyDestroy(&job->parts[i + job->stride]);
+}
+
+bool PolyMulParallelIsWorth(const Poly *p, const Poly *q)
+{
+    // PolyMul pyta o to przy każdym mnożeniu, więc najpierw sprawdzane są
+    // liczba wątków i rozmiary, a drzewa są przechodzone tylko do progu
+    return PoolIsAvailable() && !PolyIsCoeff(p) && !PolyIsCoeff(q) &&
+           (p->size >= 2 || q->size >= 2) &&
+           PolyMulHasProducts(p, q, PAR_MUL_MIN_PRODUCTS);
+}
+
+Poly PolyMulParallel(const Poly *p, const Poly *q)
+{
+    assert(!PolyIsCoeff(p) && !PolyIsCoeff(q));
+
+    ParMulJob job;
+    job.split = p->size >= q->size ? p : q;
+    job.other = p->size >= q->size ? q : p;
+    job.chunks = PolyGetThreads();
+    job.is_checked = PolyOverflowIsChecked();
+    if (job.chunks > job.split->size)
+        job.chunks = job.split->size;
+
+    job.parts = PolyMalloc(job.chunks * sizeof(Poly));
+
+    PoolRun(ParMulChunkTask, &job, job.chunks);
+
+    // iloczyny fragmentów są scalane parami w drzewie o ustalonym kształcie
+    for (job.stride = 1; job.stride < job.chunks; job.stride *= 2)
+        PoolRun(ParMulMergeTask, &job,
+                (job.chunks + job.stride - 1) / (2 * job.stride));
+
+    Poly res_poly = job.parts[0];
+    PolyFree(job.parts);
+
+    return res_poly;
+}
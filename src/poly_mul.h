@@ -0,0 +1,181 @@
+/** @file
+  Algorytmy mnożenia wielomianów rzadkich wielu zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_MUL_H__
+#define __POLY_MUL_H__
+
+#include "poly.h"
+#include <stdbool.h>
+
+/**
+ * Minimalna liczba iloczynów jednomianów (@f$|p|\cdot|q|@f$), od której
+ * ::PolyMul korzysta z mnożenia kopcowego.
+ */
+#define MUL_HEAP_MIN_PRODUCTS 64
+
+/**
+ * Minimalna liczba jednomianów każdego z czynników, od której ::PolyMul
+ * korzysta z mnożenia gęstego (::PolyMulDense). Próg wyznaczony benchmarkiem
+ * DenseMulBench.
+ */
+#define DENSE_MUL_MIN_SIZE 8
+
+/**
+ * Maksymalny stosunek rozpiętości wykładników do liczby jednomianów, przy
+ * którym wielomian jest uznawany za gęsty.
+ */
+#define DENSE_MUL_MAX_SPAN_RATIO 2
+
+/**
+ * Długość ciągów współczynników liczbowych, poniżej której algorytm Karatsuby
+ * mnoży je szkolną metodą. Próg wyznaczony benchmarkiem DenseMulBench.
+ */
+#define KARATSUBA_MIN_SIZE 32
+
+/**
+ * Długość ciągów współczynników będących wielomianami, poniżej której
+ * algorytm Karatsuby mnoży je szkolną metodą. Próg wyznaczony benchmarkiem
+ * DenseMulBench.
+ */
+#define KARATSUBA_POLY_MIN_SIZE 16
+
+/**
+ * Minimalna liczba iloczynów współczynników liczbowych czynników, od której
+ * ::PolyMul rozważa mnożenie przez podstawienie Kroneckera
+ * (::PolyMulKronecker). Próg wyznaczony benchmarkiem KroneckerMulBench.
+ */
+#define KRONECKER_MIN_PRODUCTS 4096
+
+/**
+ * Maksymalny stosunek kosztu transformat w ::PolyMulKronecker (liczba modułów
+ * razy @f$N\log_2 N@f$, gdzie @f$N@f$ to długość transformaty) do liczby
+ * iloczynów współczynników liczbowych, przy którym ::PolyMul wybiera
+ * podstawienie Kroneckera. Próg wyznaczony benchmarkiem KroneckerMulBench.
+ */
+#define KRONECKER_MAX_COST_RATIO 16
+
+/**
+ * Minimalna liczba iloczynów współczynników liczbowych czynników, od której
+ * ::PolyMul dzieli mnożenie między wątki ustawione przez ::PolySetThreads.
+ * Mniejsze iloczyny są liczone sekwencyjnie.
+ */
+#define PAR_MUL_MIN_PRODUCTS 65536
+
+/**
+ * Mnoży dwa wielomiany niebędące współczynnikami metodą kopcową (Johnson,
+ * Monagan-Pearce). Iloczyny jednomianów są wyznaczane malejąco po wykładnikach
+ * i od razu scalane z poprzednimi, więc nie trzeba ich sortować, a pamięć
+ * pomocnicza to @f$\mathrm{O}(\min(|p|, |q|))@f$ zamiast
+ * @f$\mathrm{O}(|p|\cdot|q|)@f$.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulHeap(const Poly *p, const Poly *q);
+
+/**
+ * Dodaje iloczyn wielomianów @f$a@f$ i @f$b@f$ do wielomianu @f$acc@f$, nie
+ * tworząc na ogół iloczynu @f$a \cdot b@f$. Iloczyny jednomianów są
+ * wyznaczane kopcem malejąco po wykładnikach i scalane na bieżąco
+ * z jednomianami @f$acc@f$, a iloczyny o tym samym wykładniku są dodawane
+ * rekurencyjnie tą samą funkcją. Jeśli iloczyn jest mały (mniej niż
+ * ::MUL_HEAP_MIN_PRODUCTS iloczynów jednomianów) albo mały względem
+ * @f$acc@f$, albo opłaca się szybszy algorytm mnożenia, wyznacza go funkcją
+ * ::PolyMul i dodaje funkcją ::PolyAddTo. Wielomiany muszą być w postaci
+ * uproszczonej i taki też jest wynik.
+ * @param[in,out] acc : wielomian @f$acc@f$
+ * @param[in] a : wielomian @f$a@f$
+ * @param[in] b : wielomian @f$b@f$
+ */
+void PolyMulAddTo(Poly *acc, const Poly *a, const Poly *b);
+
+/**
+ * Podnosi wielomian do kwadratu. Tak jak ::PolyMul wybiera algorytm
+ * mnożenia, ale w mnożeniu kopcowym i szkolnym wyznacza tylko iloczyny
+ * jednomianów @f$(i, j)@f$ dla @f$i \le j@f$ i podwaja te spoza przekątnej,
+ * a w podstawieniu Kroneckera wykonuje jedną transformatę mniej.
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$p^2@f$
+ */
+Poly PolySqr(const Poly *p);
+
+/**
+ * Sprawdza, czy wielomian jest gęsty względem swojej głównej zmiennej, tzn.
+ * czy nie jest współczynnikiem, ma co najmniej ::DENSE_MUL_MIN_SIZE
+ * jednomianów, a rozpiętość jego wykładników przekracza liczbę jednomianów
+ * co najwyżej ::DENSE_MUL_MAX_SPAN_RATIO razy.
+ * @param[in] p : wielomian @f$p@f$
+ * @return czy wielomian @f$p@f$ jest gęsty
+ */
+bool PolyIsDense(const Poly *p);
+
+/**
+ * Mnoży dwa wielomiany niebędące współczynnikami, traktując je jako gęste
+ * ciągi współczynników przy kolejnych potęgach głównej zmiennej. Ciągi są
+ * mnożone rekurencyjnie algorytmem Karatsuby, a współczynniki mogą być
+ * wielomianami kolejnych zmiennych. Jeśli wszystkie współczynniki są
+ * liczbami, używa szybszej wersji działającej na tablicach liczb.
+ * Złożoność to @f$\mathrm{O}(d^{\log_2 3})@f$ mnożeń współczynników, gdzie
+ * @f$d@f$ to rozpiętość wykładników.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulDense(const Poly *p, const Poly *q);
+
+/**
+ * Sprawdza, czy ::PolyMul powinien pomnożyć wielomiany @f$p@f$ i @f$q@f$
+ * funkcją ::PolyMulKronecker. Porównuje szacowany koszt transformat z liczbą
+ * iloczynów współczynników liczbowych (zob. ::KRONECKER_MIN_PRODUCTS
+ * i ::KRONECKER_MAX_COST_RATIO).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return czy opłaca się mnożenie przez podstawienie Kroneckera
+ */
+bool PolyMulKroneckerIsWorth(const Poly *p, const Poly *q);
+
+/**
+ * Mnoży dwa wielomiany niebędące współczynnikami przez podstawienie
+ * Kroneckera. Wszystkie zmienne są pakowane w jeden wykładnik na podstawie
+ * ograniczeń stopni iloczynu względem kolejnych zmiennych, powstałe ciągi
+ * współczynników są mnożone szybką transformatą teoretycznoliczbową (NTT)
+ * modulo kilka liczb pierwszych mieszczących się w 32 bitach, a współczynniki
+ * iloczynu są odtwarzane z chińskiego twierdzenia o resztach. Liczba modułów
+ * jest dobierana tak, aby wynik był dokładny. Jeśli spakowany iloczyn jest
+ * za długi dla transformaty, mnoży funkcją ::PolyMulHeap.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulKronecker(const Poly *p, const Poly *q);
+
+/**
+ * Sprawdza, czy ::PolyMul powinien pomnożyć wielomiany @f$p@f$ i @f$q@f$
+ * równolegle funkcją ::PolyMulParallel, tzn. czy pula wątków jest dostępna,
+ * a liczba iloczynów współczynników liczbowych to co najmniej
+ * ::PAR_MUL_MIN_PRODUCTS.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return czy opłaca się mnożenie równoległe
+ */
+bool PolyMulParallelIsWorth(const Poly *p, const Poly *q);
+
+/**
+ * Mnoży dwa wielomiany niebędące współczynnikami na wątkach puli. Dzieli
+ * wielomian o większej liczbie jednomianów na tyle ciągłych fragmentów, ile
+ * jest wątków, mnoży każdy z nich przez drugi czynnik funkcją ::PolyMul, a
+ * iloczyny scala parami w drzewie o ustalonym kształcie. Wynik jest taki sam
+ * jak przy mnożeniu sekwencyjnym.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulParallel(const Poly *p, const Poly *q);
+
+#endif
@@ -0,0 +1,138 @@
+/** @file
+  Implementacja sprawdzania przepełnień arytmetyki wielomianów rzadkich wielu
+  zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_overflow.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#ifdef POLY_OVERFLOW_CHECK
+/** Domyślny stan trybu sprawdzania przepełnień */
+#define OVERFLOW_CHECK_DEFAULT true
+#else
+/** Domyślny stan trybu sprawdzania przepełnień */
+#define OVERFLOW_CHECK_DEFAULT false
+#endif
+
+/** Czy tryb sprawdzania przepełnień jest włączony */
+static atomic_bool is_enabled = OVERFLOW_CHECK_DEFAULT;
+
+/**
+ * Czy bieżący wątek liczy iloczyn, dla którego oszacowanie wykluczyło
+ * przepełnienie
+ */
+static _Thread_local bool is_proven_safe;
+
+/** Liczba przepełnień działań na współczynnikach */
+static atomic_size_t coeff_overflows;
+
+/** Liczba przepełnień sum wykładników */
+static atomic_size_t exp_overflows;
+
+void PolySetOverflowCheck(bool enabled)
+{
+    atomic_store_explicit(&is_enabled, enabled, memory_order_relaxed);
+}
+
+bool PolyGetOverflowCheck(void)
+{
+    return atomic_load_explicit(&is_enabled, memory_order_relaxed);
+}
+
+bool PolyOverflowIsChecked(void)
+{
+    return !is_proven_safe && PolyGetOverflowCheck();
+}
+
+bool PolyOverflowSetProvenSafe(bool is_safe)
+{
+    bool was_safe = is_proven_safe;
+    is_proven_safe = is_safe;
+
+    return was_safe;
+}
+
+bool PolyOverflowOccurred(void)
+{
+    PolyOverflowStats stats = PolyOverflowGetStats();
+
+    return stats.coeffs > 0 || stats.exps > 0;
+}
+
+PolyOverflowStats PolyOverflowGetStats(void)
+{
+    return (PolyOverflowStats){
+        .coeffs = atomic_load_explicit(&coeff_overflows, memory_order_relaxed),
+        .exps = atomic_load_explicit(&exp_overflows, memory_order_relaxed)};
+}
+
+void PolyOverflowClear(void)
+{
+    atomic_store_explicit(&coeff_overflows, 0, memory_order_relaxed);
+    atomic_store_explicit(&exp_overflows, 0, memory_order_relaxed);
+}
+
+void PolyOverflowReport(PolyOverflowKind kind)
+{
+    if (!PolyGetOverflowCheck())
+        return;
+
+    atomic_size_t *counter =
+        kind == OVERFLOW_COEFF ? &coeff_overflows : &exp_overflows;
+    atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+}
+
+/**
+ * Wyznacza sumę modułów współczynników wielomianu, nasyconą do
+ * UINT64_MAX, i jego największy wykładnik.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in,out] norm : suma modułów, do której dodawane są moduły
+ * @param[in,out] max_exp : największy dotąd znaleziony wykładnik
+ */
+static void PolyBounds(const Poly *p, uint64_t *norm, poly_exp_t *max_exp)
+{
+    if (PolyIsCoeff(p))
+    {
+        // moduł liczony bez znaku jest poprawny także dla LONG_MIN
+        uint64_t abs = p->coeff < 0 ? 0 - (uint64_t)p->coeff
+                                    : (uint64_t)p->coeff;
+        if (__builtin_add_overflow(*norm, abs, norm))
+            *norm = UINT64_MAX;
+        return;
+    }
+
+    // wykładniki są posortowane malejąco
+    if (p->arr[0].exp > *max_exp)
+        *max_exp = p->arr[0].exp;
+
+    for (size_t i = 0; i < p->size; i++)
+        PolyBounds(&p->arr[i].p, norm, max_exp);
+}
+
+bool PolyMulFastIsSafe(const Poly *p, const Poly *q)
+{
+    assert(p != NULL && q != NULL);
+
+    if (!PolyOverflowIsChecked())
+        return true;
+
+    uint64_t p_norm = 0;
+    uint64_t q_norm = 0;
+    poly_exp_t p_exp = 0;
+    poly_exp_t q_exp = 0;
+    PolyBounds(p, &p_norm, &p_exp);
+    PolyBounds(q, &q_norm, &q_exp);
+
+    uint64_t norm;
+    return !__builtin_mul_overflow(p_norm, q_norm, &norm) &&
+           norm <= (uint64_t)LONG_MAX &&
+           (int64_t)p_exp + q_exp <= (int64_t)INT_MAX;
+}
@@ -0,0 +1,199 @@
+/** @file
+  Interfejs sprawdzania przepełnień arytmetyki wielomianów rzadkich wielu
+  zmiennych
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_OVERFLOW_H__
+#define __POLY_OVERFLOW_H__
+
+#include "poly.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Rodzaj przepełnienia */
+typedef enum
+{
+    OVERFLOW_COEFF, ///< przepełnienie działania na współczynnikach
+    OVERFLOW_EXP    ///< przepełnienie sumy wykładników
+} PolyOverflowKind;
+
+/** Liczniki przepełnień wykrytych w trybie sprawdzania */
+typedef struct
+{
+    /** liczba przepełnień działań na współczynnikach */
+    size_t coeffs;
+    /** liczba przepełnień sum wykładników */
+    size_t exps;
+} PolyOverflowStats;
+
+/**
+ * Włącza albo wyłącza tryb sprawdzania przepełnień. Działania na
+ * współczynnikach i wykładnikach zawsze dają wynik modulo @f$2^{64}@f$
+ * (@f$2^{32}@f$ dla wykładników), tak jak bez sprawdzania, ale w trybie
+ * sprawdzania każde przepełnienie jest liczone, a flaga
+ * ::PolyOverflowOccurred pozostaje ustawiona do wywołania
+ * ::PolyOverflowClear. Mnożenie używa wtedy szybkich algorytmów, które
+ * przepełnień nie wykrywają, tylko gdy oszacowanie wartości współczynników
+ * i wykładników iloczynu wyklucza przepełnienie. Tryb jest domyślnie
+ * włączony, jeśli biblioteka jest kompilowana z makrem POLY_OVERFLOW_CHECK.
+ *
+ * ::PolyEvalBatch i ::PolyProgramEvalBatch w trybie sprawdzania wyliczają
+ * wartości punkt po punkcie funkcjami ::PolyEval i ::PolyProgramEval, bez
+ * grup punktów. ::PolyProgramEvalMod liczy modulo, więc nie ma czego
+ * sprawdzać. Tryb nie dotyczy kodu ::PolyEmitC: wygenerowana funkcja działa
+ * poza biblioteką i zawsze liczy modulo @f$2^{64}@f$ bez sprawdzania.
+ * @param[in] enabled : czy sprawdzać przepełnienia
+ */
+void PolySetOverflowCheck(bool enabled);
+
+/**
+ * Sprawdza, czy tryb sprawdzania przepełnień jest włączony.
+ * @return czy tryb sprawdzania przepełnień jest włączony
+ */
+bool PolyGetOverflowCheck(void);
+
+/**
+ * Sprawdza, czy bieżąca operacja bieżącego wątku ma sprawdzać przepełnienia:
+ * tryb sprawdzania jest włączony, a operacja nie jest częścią iloczynu, dla
+ * którego oszacowanie wykluczyło przepełnienie (::PolyOverflowSetProvenSafe).
+ * Funkcje biblioteki odczytują to raz na wywołanie i wybierają wariant
+ * z działaniami sprawdzanymi (::CoeffAdd) albo bez sprawdzania
+ * (::CoeffAddUnchecked).
+ * @return czy sprawdzać przepełnienia
+ */
+bool PolyOverflowIsChecked(void);
+
+/**
+ * Oznacza, że działania wykonywane przez bieżący wątek do kolejnego
+ * wywołania na pewno się nie przepełniają, więc nie są sprawdzane.
+ * @param[in] is_safe : czy przepełnienie jest wykluczone
+ * @return poprzednia wartość, przywracana po zakończeniu takich działań
+ */
+bool PolyOverflowSetProvenSafe(bool is_safe);
+
+/**
+ * Sprawdza, czy od ostatniego wywołania ::PolyOverflowClear któreś
+ * działanie wykonane w trybie sprawdzania się przepełniło, więc jego wynik
+ * może być niepoprawny.
+ * @return czy wystąpiło przepełnienie
+ */
+bool PolyOverflowOccurred(void);
+
+/**
+ * Zwraca liczniki przepełnień wykrytych od ostatniego wywołania
+ * ::PolyOverflowClear.
+ * @return liczniki przepełnień
+ */
+PolyOverflowStats PolyOverflowGetStats(void);
+
+/** Zeruje liczniki przepełnień i flagę ::PolyOverflowOccurred. */
+void PolyOverflowClear(void);
+
+/**
+ * Zgłasza przepełnienie, jeśli tryb sprawdzania jest włączony. Bezpieczna
+ * dla wielu wątków.
+ * @param[in] kind : rodzaj przepełnienia
+ */
+void PolyOverflowReport(PolyOverflowKind kind);
+
+/**
+ * Sprawdza, czy iloczyn wielomianów niebędących współczynnikami można
+ * wyznaczyć algorytmem, który nie wykrywa przepełnień. Jeśli przepełnienia
+ * nie są sprawdzane (::PolyOverflowIsChecked), zawsze można, a wpp.
+ * przechodzi oba drzewa, więc jest wywoływana raz na iloczyn. Każdy
+ * współczynnik
+ * iloczynu i każda suma częściowa jest co do modułu nie większa od
+ * iloczynu sum modułów współczynników @f$p@f$ i @f$q@f$, a każdy wykładnik
+ * od sumy największych wykładników, więc przepełnienie jest wykluczone,
+ * gdy oba oszacowania się mieszczą.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return czy przepełnienie jest wykluczone albo nie jest sprawdzane
+ */
+bool PolyMulFastIsSafe(const Poly *p, const Poly *q);
+
+/**
+ * Dodaje współczynniki modulo @f$2^{64}@f$, zgłaszając przepełnienie.
+ * @param[in] a : współczynnik @f$a@f$
+ * @param[in] b : współczynnik @f$b@f$
+ * @return @f$a + b@f$
+ */
+static inline poly_coeff_t CoeffAdd(poly_coeff_t a, poly_coeff_t b)
+{
+    poly_coeff_t res;
+    if (__builtin_add_overflow(a, b, &res))
+        PolyOverflowReport(OVERFLOW_COEFF);
+
+    return res;
+}
+
+/**
+ * Mnoży współczynniki modulo @f$2^{64}@f$, zgłaszając przepełnienie.
+ * @param[in] a : współczynnik @f$a@f$
+ * @param[in] b : współczynnik @f$b@f$
+ * @return @f$a \cdot b@f$
+ */
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b)
+{
+    poly_coeff_t res;
+    if (__builtin_mul_overflow(a, b, &res))
+        PolyOverflowReport(OVERFLOW_COEFF);
+
+    return res;
+}
+
+/**
+ * Dodaje wykładniki modulo @f$2^{32}@f$, zgłaszając przepełnienie.
+ * @param[in] a : wykładnik @f$a@f$
+ * @param[in] b : wykładnik @f$b@f$
+ * @return @f$a + b@f$
+ */
+static inline poly_exp_t ExpAdd(poly_exp_t a, poly_exp_t b)
+{
+    poly_exp_t res;
+    if (__builtin_add_overflow(a, b, &res))
+        PolyOverflowReport(OVERFLOW_EXP);
+
+    return res;
+}
+
+/**
+ * Dodaje współczynniki modulo @f$2^{64}@f$ bez sprawdzania przepełnienia.
+ * @param[in] a : współczynnik @f$a@f$
+ * @param[in] b : współczynnik @f$b@f$
+ * @return @f$a + b@f$
+ */
+static inline poly_coeff_t CoeffAddUnchecked(poly_coeff_t a, poly_coeff_t b)
+{
+    // liczby bez znaku mają zdefiniowane przepełnienie
+    return (poly_coeff_t)((unsigned long)a + (unsigned long)b);
+}
+
+/**
+ * Mnoży współczynniki modulo @f$2^{64}@f$ bez sprawdzania przepełnienia.
+ * @param[in] a : współczynnik @f$a@f$
+ * @param[in] b : współczynnik @f$b@f$
+ * @return @f$a \cdot b@f$
+ */
+static inline poly_coeff_t CoeffMulUnchecked(poly_coeff_t a, poly_coeff_t b)
+{
+    return (poly_coeff_t)((unsigned long)a * (unsigned long)b);
+}
+
+/**
+ * Dodaje wykładniki modulo @f$2^{32}@f$ bez sprawdzania przepełnienia.
+ * @param[in] a : wykładnik @f$a@f$
+ * @param[in] b : wykładnik @f$b@f$
+ * @return @f$a + b@f$
+ */
+static inline poly_exp_t ExpAddUnchecked(poly_exp_t a, poly_exp_t b)
+{
+    return (poly_exp_t)((unsigned int)a + (unsigned int)b);
+}
+
+#endif
@@ -0,0 +1,215 @@
+/** @file
+  Implementacja puli wątków używanej przez operacje na wielomianach
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#include "poly_pool.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_lib.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+/**
+ * Pula wątków. Wykonuje naraz jedną grupę zadań, których indeksy wątki
+ * pobierają po kolei pod muteksem. Grupę zadań wywołującego wątku i zmianę
+ * liczby wątków chroni osobny muteks, więc wątki aplikacji wywołujące
+ * operacje jednocześnie nie nadpisują sobie nawzajem grupy zadań.
+ */
+typedef struct
+{
+    pthread_mutex_t run_mutex;    ///< muteks grupy zadań i liczby wątków
+    atomic_bool is_running;       ///< czy pula wykonuje grupę zadań
+    pthread_mutex_t mutex;        ///< muteks chroniący stan grupy zadań
+    pthread_cond_t work_cond;     ///< sygnalizuje nową grupę zadań lub koniec
+    pthread_cond_t done_cond;     ///< sygnalizuje wykonanie wszystkich zadań
+    pthread_t *workers;           ///< wątki puli
+    atomic_size_t workers_count;  ///< liczba wątków puli
+    bool stop;                    ///< czy wątki mają się zakończyć
+    unsigned long generation;     ///< numer bieżącej grupy zadań
+    void (*task)(void *, size_t); ///< funkcja wykonująca zadanie
+    void *arg;                    ///< argument wspólny dla zadań
+    size_t count;                 ///< liczba zadań w grupie
+    size_t next;                  ///< indeks kolejnego zadania do pobrania
+    size_t finished;              ///< liczba wykonanych zadań
+} Pool;
+
+/** Jedyna pula wątków */
+static Pool pool = {.run_mutex = PTHREAD_MUTEX_INITIALIZER,
+                    .mutex = PTHREAD_MUTEX_INITIALIZER,
+                    .work_cond = PTHREAD_COND_INITIALIZER,
+                    .done_cond = PTHREAD_COND_INITIALIZER};
+
+/** Czy bieżący wątek wykonuje zadanie puli */
+static _Thread_local bool in_task = false;
+
+/**
+ * Pobiera i wykonuje zadania bieżącej grupy, dopóki jakieś zostały.
+ * Wymaga zablokowanego muteksu puli, który jest zwalniany na czas zadań.
+ */
+static void PoolDrain(void)
+{
+    while (pool.next < pool.count)
+    {
+        size_t idx = pool.next++;
+        void (*task)(void *, size_t) = pool.task;
+        void *arg = pool.arg;
+
+        pthread_mutex_unlock(&pool.mutex);
+        task(arg, idx);
+        pthread_mutex_lock(&pool.mutex);
+
+        pool.finished++;
+        if (pool.finished == pool.count)
+            pthread_cond_broadcast(&pool.done_cond);
+    }
+}
+
+/**
+ * Pętla wątku puli: czeka na kolejne grupy zadań i pomaga je wykonać.
+ * @param[in] unused : nieużywany argument
+ * @return NULL
+ */
+static void *PoolWorker(void *unused)
+{
+    (void)unused;
+    in_task = true;
+
+    pthread_mutex_lock(&pool.mutex);
+    unsigned long seen = pool.generation;
+    while (true)
+    {
+        while (!pool.stop && pool.generation == seen)
+            pthread_cond_wait(&pool.work_cond, &pool.mutex);
+
+        if (pool.stop)
+            break;
+
+        seen = pool.generation;
+        PoolDrain();
+    }
+    pthread_mutex_unlock(&pool.mutex);
+    PolyScratchDestroy();
+    MonosPoolDestroy();
+
+    return NULL;
+}
+
+/**
+ * Kończy wszystkie wątki puli i zwalnia ich tablicę. Wywoływana pod
+ * muteksem grupy zadań.
+ */
+static void PoolStop(void)
+{
+    pthread_mutex_lock(&pool.mutex);
+    pool.stop = true;
+    pthread_cond_broadcast(&pool.work_cond);
+    pthread_mutex_unlock(&pool.mutex);
+
+    size_t workers_count = atomic_load(&pool.workers_count);
+    for (size_t i = 0; i < workers_count; i++)
+        pthread_join(pool.workers[i], NULL);
+
+    PolyFreeUntracked(pool.workers);
+    pool.workers = NULL;
+    atomic_store(&pool.workers_count, 0);
+    pool.stop = false;
+}
+
+void PolySetThreads(size_t n)
+{
+    if (n == 0)
+        n = 1;
+
+    // czeka na zakończenie grupy zadań wykonywanej przez inny wątek
+    pthread_mutex_lock(&pool.run_mutex);
+
+    if (n != atomic_load(&pool.workers_count) + 1)
+    {
+        PoolStop();
+        if (n > 1)
+        {
+            pool.workers = PolyMallocUntracked((n - 1) * sizeof(pthread_t));
+
+            // jeśli system nie pozwoli utworzyć wszystkich wątków, pula
+            // działa na tych, które udało się utworzyć
+            size_t created = 0;
+            while (created < n - 1 &&
+                   pthread_create(&pool.workers[created], NULL, PoolWorker,
+                                  NULL) == 0)
+                created++;
+            atomic_store(&pool.workers_count, created);
+        }
+    }
+
+    pthread_mutex_unlock(&pool.run_mutex);
+}
+
+size_t PolyGetThreads(void)
+{
+    return atomic_load(&pool.workers_count) + 1;
+}
+
+bool PoolIsAvailable(void)
+{
+    return PolyGetThreads() > 1 && !atomic_load(&pool.is_running) &&
+           !in_task && !PolyAllocIsTracking();
+}
+
+/**
+ * Wykonuje zadania po kolei w wywołującym wątku.
+ * @param[in] task : funkcja wykonująca zadanie
+ * @param[in,out] arg : argument wspólny dla zadań
+ * @param[in] count : liczba zadań
+ */
+static void PoolRunSerial(void (*task)(void *arg, size_t idx), void *arg,
+                          size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        task(arg, i);
+}
+
+void PoolRun(void (*task)(void *arg, size_t idx), void *arg, size_t count)
+{
+    // pula mogła zostać zajęta przez inny wątek albo zatrzymana po
+    // sprawdzeniu ::PoolIsAvailable przez wywołującego
+    if (!PoolIsAvailable() || count <= 1 ||
+        pthread_mutex_trylock(&pool.run_mutex) != 0)
+    {
+        PoolRunSerial(task, arg, count);
+        return;
+    }
+
+    if (atomic_load(&pool.workers_count) == 0)
+    {
+        pthread_mutex_unlock(&pool.run_mutex);
+        PoolRunSerial(task, arg, count);
+        return;
+    }
+
+    atomic_store(&pool.is_running, true);
+    pthread_mutex_lock(&pool.mutex);
+    pool.task = task;
+    pool.arg = arg;
+    pool.count = count;
+    pool.next = 0;
+    pool.finished = 0;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_cond);
+
+    // wątek wywołujący też wykonuje zadania
+    in_task = true;
+    PoolDrain();
+    while (pool.finished < pool.count)
+        pthread_cond_wait(&pool.done_cond, &pool.mutex);
+    in_task = false;
+
+    pthread_mutex_unlock(&pool.mutex);
+    atomic_store(&pool.is_running, false);
+    pthread_mutex_unlock(&pool.run_mutex);
+}
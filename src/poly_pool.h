@@ -0,0 +1,54 @@
+/** @file
+  Interfejs puli wątków używanej przez operacje na wielomianach
+
+  @authors Michał Molas
+  <mm429570@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date 2021
+*/
+
+#ifndef __POLY_POOL_H__
+#define __POLY_POOL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Ustawia liczbę wątków, na których mogą być wykonywane duże operacje na
+ * wielomianach. Wątek wywołujący operację też wykonuje jej część, więc pula
+ * uruchamia @f$n - 1@f$ dodatkowych wątków. Wartości 0 i 1 oznaczają pracę
+ * sekwencyjną i kończą wątki puli. Jeśli inny wątek wykonuje właśnie grupę
+ * zadań puli, czeka na jej zakończenie. Nie może być wywołana z zadania
+ * puli.
+ * @param[in] n : liczba wątków
+ */
+void PolySetThreads(size_t n);
+
+/**
+ * Zwraca liczbę wątków ustawioną przez ::PolySetThreads.
+ * @return liczba wątków, co najmniej 1
+ */
+size_t PolyGetThreads(void);
+
+/**
+ * Sprawdza, czy operacja może zostać zrównoleglona, tzn. czy ustawiono więcej
+ * niż jeden wątek, pula nie wykonuje grupy zadań innego wątku, a wywołujący
+ * wątek nie wykonuje właśnie zadania puli ani funkcji PolyTry... Zadania
+ * puli i funkcje PolyTry... zawsze działają sekwencyjnie.
+ * @return czy można użyć ::PoolRun
+ */
+bool PoolIsAvailable(void);
+
+/**
+ * Wykonuje równolegle zadania @p task(@p arg, i) dla @f$i = 0, \ldots,
+ * count - 1@f$ i czeka na zakończenie wszystkich. Zadania muszą być od siebie
+ * niezależne. Pula wykonuje naraz grupę zadań jednego wątku, więc jeśli jest
+ * niedostępna albo zajęta przez inny wątek, wykonuje je po kolei
+ * w wywołującym wątku.
+ * @param[in] task : funkcja wykonująca zadanie
+ * @param[in,out] arg : argument wspólny dla zadań
+ * @param[in] count : liczba zadań
+ */
+void PoolRun(void (*task)(void *arg, size_t idx), void *arg, size_t count);
+
+#endif
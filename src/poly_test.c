@@ -2,11 +2,26 @@
 #undef NDEBUG
 #endif
 
+#include "calc.h"
 #include "poly.h"
+#include "poly_acc.h"
+#include "poly_alloc.h"
+#include "poly_arena.h"
+#include "poly_eval.h"
+#include "poly_intern.h"
+#include "poly_lib.h"
+#include "poly_mul.h"
+#include "poly_overflow.h"
+#include "poly_pool.h"
+#include "stack.h"
 #include <assert.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -4140,6 +4155,1545 @@ static bool PolyFromMonosFinalTest(void) {
   return res;
 }
 
+/** TESTY ROZSZERZEŃ BIBLIOTEKI **/
+
+/* Stan generatora liczb pseudolosowych testów. Testy ustawiają go na
+ * początku, więc są powtarzalne. */
+static unsigned long rand_state;
+
+static unsigned long RandNext(void) {
+  rand_state = rand_state * 6364136223846793005UL + 1442695040888963407UL;
+  return rand_state >> 33;
+}
+
+/* Tworzy pseudolosowy wielomian o depth poziomach, z size jednomianami na
+ * każdym poziomie przed zsumowaniem, o wykładnikach mniejszych od max_exp
+ * i współczynnikach z przedziału [-max_coeff, max_coeff]. Zerowe
+ * współczynniki pomija PolyAddMonos. */
+static Poly RandPoly(int depth, size_t size, poly_exp_t max_exp,
+                     poly_coeff_t max_coeff) {
+  if (depth == 0) {
+    unsigned long range = 2 * (unsigned long)max_coeff + 1;
+    return C((poly_coeff_t)(RandNext() % range) - max_coeff);
+  }
+  Mono *monos = calloc(size, sizeof (Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < size; ++i) {
+    Poly p = RandPoly(depth - 1, size, max_exp, max_coeff);
+    poly_exp_t exp = (poly_exp_t)(RandNext() % (unsigned long)max_exp);
+    monos[i] = (Mono){.p = p, .exp = exp};
+  }
+  Poly res = PolyAddMonos(size, monos);
+  free(monos);
+  return res;
+}
+
+/* Mnoży wielomiany szkolnie, niezależnie od algorytmów biblioteki: każdy
+ * jednomian p przez każdy jednomian q, a jednomiany o równych wykładnikach
+ * sumuje PolyAddMonos. Współczynnik jest jednomianem o wykładniku 0.
+ * Przepełnienia dają wynik modulo 2^64, tak jak w bibliotece. */
+static Poly NaiveMul(const Poly *p, const Poly *q) {
+  if (PolyIsCoeff(p) && PolyIsCoeff(q))
+    return C((poly_coeff_t)((unsigned long)p->coeff *
+                            (unsigned long)q->coeff));
+  Mono p_coeff = {.p = *p, .exp = 0};
+  Mono q_coeff = {.p = *q, .exp = 0};
+  size_t p_size = PolyIsCoeff(p) ? 1 : p->size;
+  size_t q_size = PolyIsCoeff(q) ? 1 : q->size;
+  const Mono *p_arr = PolyIsCoeff(p) ? &p_coeff : p->arr;
+  const Mono *q_arr = PolyIsCoeff(q) ? &q_coeff : q->arr;
+  Mono *monos = calloc(p_size * q_size, sizeof (Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < p_size; ++i) {
+    for (size_t j = 0; j < q_size; ++j) {
+      Poly coeff = NaiveMul(&p_arr[i].p, &q_arr[j].p);
+      poly_exp_t exp = p_arr[i].exp + q_arr[j].exp;
+      monos[i * q_size + j] = (Mono){.p = coeff, .exp = exp};
+    }
+  }
+  Poly res = PolyAddMonos(p_size * q_size, monos);
+  free(monos);
+  return res;
+}
+
+/* Sprawdza, czy mul(p, q) jest równe iloczynowi szkolnemu. Usuwa p i q. */
+static bool TestMulWith(Poly p, Poly q,
+                        Poly (*mul)(const Poly *, const Poly *)) {
+  Poly expected = NaiveMul(&p, &q);
+  Poly res = mul(&p, &q);
+  bool is_eq = PolyIsEq(&res, &expected);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&res);
+  PolyDestroy(&expected);
+  return is_eq;
+}
+
+static bool MulHeapTest(void) {
+  bool res = true;
+  rand_state = 1;
+  // iloczyny o współczynnikach, które się skracają, i wielu zmiennych
+  for (int i = 0; i < 20; ++i) {
+    Poly p = RandPoly(1 + i % 3, 4 + i, 40, 3);
+    Poly q = RandPoly(1 + i % 2, 8 + i, 60, 3);
+    if (PolyIsCoeff(&p) || PolyIsCoeff(&q)) {
+      PolyDestroy(&p);
+      PolyDestroy(&q);
+      continue;
+    }
+    res &= TestMulWith(p, q, PolyMulHeap);
+  }
+  // ten sam wielomian jako oba czynniki
+  Poly p = RandPoly(2, 12, 30, 5);
+  Poly q = PolyClone(&p);
+  res &= TestMulWith(p, q, PolyMulHeap);
+  // iloczyny o wykładniku 1 sumują się do zera
+  res &= TestMulWith(P(C(1), 0, C(1), 1), P(C(-1), 0, C(1), 1),
+                     PolyMulHeap);
+  // PolyMul wybiera algorytm, więc też powinien zgadzać się z mnożeniem
+  // szkolnym
+  for (int i = 0; i < 10; ++i)
+    res &= TestMulWith(RandPoly(2, 10 + 3 * i, 50, 100),
+                       RandPoly(2, 12 + 2 * i, 50, 100), PolyMul);
+  return res;
+}
+
+/* Dodaje wielomiany, niezależnie od algorytmów biblioteki: sumuje
+ * PolyAddMonos jednomiany obu wielomianów. Współczynnik jest jednomianem
+ * o wykładniku 0. */
+static Poly NaiveAdd(const Poly *p, const Poly *q) {
+  size_t p_size = PolyIsCoeff(p) ? 1 : p->size;
+  size_t q_size = PolyIsCoeff(q) ? 1 : q->size;
+  Mono *monos = calloc(p_size + q_size, sizeof (Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < p_size; ++i)
+    monos[i] = PolyIsCoeff(p) ? (Mono){.p = PolyClone(p), .exp = 0}
+                              : MonoClone(&p->arr[i]);
+  for (size_t i = 0; i < q_size; ++i)
+    monos[p_size + i] = PolyIsCoeff(q) ? (Mono){.p = PolyClone(q), .exp = 0}
+                                       : MonoClone(&q->arr[i]);
+  Poly res = PolyAddMonos(p_size + q_size, monos);
+  free(monos);
+  return res;
+}
+
+/* Sprawdza, czy PolyAddTo(&p, &q) daje sumę jednomianów p i q. Usuwa p
+ * i q. */
+static bool TestAddTo(Poly p, Poly q) {
+  Poly expected = NaiveAdd(&p, &q);
+  PolyAddTo(&p, &q);
+  bool is_eq = PolyIsEq(&p, &expected);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&expected);
+  return is_eq;
+}
+
+static bool AddToMergeTest(void) {
+  bool res = true;
+  rand_state = 2;
+  // wielomiany podobnej długości są scalane w tablicy p
+  for (int i = 0; i < 20; ++i)
+    res &= TestAddTo(RandPoly(1 + i % 3, 5 + i, 30, 3),
+                     RandPoly(1 + i % 3, 5 + 2 * i, 30, 3));
+  // tablica p współdzielona z klonem jest kopiowana, a klon się nie zmienia
+  unsigned long state = rand_state;
+  Poly p = RandPoly(2, 20, 40, 10);
+  Poly p_copy = PolyClone(&p);
+  rand_state = state;
+  Poly p_orig = RandPoly(2, 20, 40, 10);
+  res &= TestAddTo(p, RandPoly(2, 20, 40, 10));
+  res &= PolyIsEq(&p_copy, &p_orig);
+  PolyDestroy(&p_copy);
+  PolyDestroy(&p_orig);
+  // suma przeciwnych wielomianów jest zerem
+  Poly q = RandPoly(3, 6, 10, 50);
+  Poly neg_q = PolyNeg(&q);
+  PolyAddTo(&q, &neg_q);
+  res &= PolyIsZero(&q);
+  PolyDestroy(&neg_q);
+  // dodanie współczynnika i do współczynnika
+  res &= TestAddTo(RandPoly(2, 8, 10, 3), C(7));
+  res &= TestAddTo(C(7), RandPoly(2, 8, 10, 3));
+  res &= TestAddTo(P(C(-7), 0, C(1), 1), C(7));
+  return res;
+}
+
+static bool AddToGallopTest(void) {
+  bool res = true;
+  rand_state = 3;
+  // p ma co najmniej ADD_GALLOP_RATIO razy więcej jednomianów niż q, więc
+  // miejsca jednomianów q są wyszukiwane
+  for (int i = 0; i < 20; ++i)
+    res &= TestAddTo(RandPoly(1 + i % 2, 200, 1000, 3),
+                     RandPoly(1 + i % 2, 1 + i % 5, 1200, 3));
+  // jednomiany q skracają się z pierwszym, środkowym i ostatnim
+  // jednomianem p
+  Poly p = RandPoly(2, 100, 300, 10);
+  size_t idx[] = {0, p.size / 2, p.size - 1};
+  Mono q_monos[3];
+  for (size_t i = 0; i < 3; ++i)
+    q_monos[i] = M(PolyNeg(&p.arr[idx[i]].p), p.arr[idx[i]].exp);
+  res &= TestAddTo(p, PolyAddMonos(3, q_monos));
+  // jednomiany q przed wszystkimi jednomianami p i za nimi
+  Poly r = RandPoly(1, 100, 300, 10);
+  Poly x = P(C(1), 1);
+  res &= TestAddTo(PolyMul(&r, &x), P(C(5), 0, C(6), 1000));
+  PolyDestroy(&r);
+  PolyDestroy(&x);
+  return res;
+}
+
+/* Tworzy wielomian z jednomianów o wykładnikach 2i dla i < count,
+ * w tablicy o pojemności co najmniej capacity. Jednomian i ma współczynnik
+ * sign * (i + 1), a co trzeci - podwielomian sign * (1 + ix). */
+static Poly SpareCapacityPoly(size_t count, size_t capacity, int sign) {
+  Mono *monos = PolyMallocMonos(capacity);
+  for (size_t i = 0; i < count; ++i) {
+    poly_coeff_t c = sign * (poly_coeff_t)(i + 1);
+    Poly coeff = i % 3 == 0 ? P(C(sign), 0, C(c), 1) : C(c);
+    monos[i] = M(coeff, (poly_exp_t)(2 * i));
+  }
+  return PolyAdoptMonos(count, monos);
+}
+
+static bool AddToNoRegrowTest(void) {
+  bool res = true;
+  for (size_t n = 4; n <= 64; n *= 2) {
+    // q ma te same wykładniki co p i przeciwne jednomiany, więc suma
+    // znosi się w całości, także w podwielomianach
+    Poly p = SpareCapacityPoly(n, 2 * n, 1);
+    Poly q = SpareCapacityPoly(n, n, -1);
+    res &= p.size + q.size <= MonosCapacity(p.arr);
+    PolyAddTo(&p, &q);
+    res &= PolyIsZero(&p);
+    PolyDestroy(&q);
+
+    // część jednomianów się znosi, część się sumuje, a część q ma nowe
+    // wykładniki; suma mieści się w pojemności p, więc nie jest powiększana
+    p = SpareCapacityPoly(n, 2 * n, 1);
+    Mono *arr = p.arr;
+    Mono *monos = PolyMallocMonos(n);
+    for (size_t i = 0; i < n; ++i) {
+      poly_exp_t exp = (poly_exp_t)(i % 4 == 3 ? 2 * i + 1 : 2 * i);
+      Poly coeff;
+      if (i % 4 == 0)
+        coeff = P(C(-1), 0, C(-(poly_coeff_t)(i + 1)), 1);
+      else if (i % 4 == 1)
+        coeff = C(-(poly_coeff_t)(i + 1));
+      else
+        coeff = C(5);
+      monos[i] = M(coeff, exp);
+    }
+    q = PolyAdoptMonos(n, monos);
+    res &= p.size + q.size <= MonosCapacity(p.arr);
+    Poly expected = NaiveAdd(&p, &q);
+    PolyAddTo(&p, &q);
+    res &= p.arr == arr && PolyIsEq(&p, &expected);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&expected);
+  }
+  return res;
+}
+
+static bool AddMonoToTest(void) {
+  bool res = true;
+  rand_state = 4;
+  // kolejne jednomiany są dodawane najpierw do współczynnika; co czwarty
+  // skraca się z jednomianem wielomianu
+  Poly p = C(3);
+  for (int i = 0; i < 300; ++i) {
+    Mono m;
+    if (i % 4 == 3 && !PolyIsCoeff(&p)) {
+      const Mono *n = &p.arr[RandNext() % p.size];
+      m = (Mono){.p = PolyNeg(&n->p), .exp = n->exp};
+    } else {
+      poly_exp_t exp = (poly_exp_t)(RandNext() % 60);
+      m = (Mono){.p = RandPoly(i % 3, 3, 20, 4), .exp = exp};
+    }
+    Mono m_copy = MonoClone(&m);
+    Poly q = PolyAddMonos(1, &m_copy);
+    Poly expected = NaiveAdd(&p, &q);
+    PolyAddMonoTo(&p, &m);
+    res &= PolyIsEq(&p, &expected);
+    PolyDestroy(&q);
+    PolyDestroy(&expected);
+  }
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool AccumulatorTest(void) {
+  bool res = true;
+  rand_state = 5;
+  // suma wielomianów i jednomianów, także współczynników
+  PolyAccumulator acc = PolyAccumulatorNew();
+  Poly expected = PolyZero();
+  for (int i = 0; i < 100; ++i) {
+    Poly p = RandPoly(i % 4, 4, 30, 5);
+    Poly sum = NaiveAdd(&expected, &p);
+    PolyDestroy(&expected);
+    expected = sum;
+    if (i % 2 == 0 || PolyIsCoeff(&p)) {
+      PolyAccumulatorAdd(&acc, p);
+    } else {
+      // wielomian jest dodawany jednomian po jednomianie
+      for (size_t j = 0; j < p.size; ++j)
+        PolyAccumulatorAddMono(&acc, p.arr[j]);
+      MonosFree(p.arr);
+    }
+  }
+  Poly sum = PolyAccumulatorFinalize(&acc);
+  res &= PolyIsEq(&sum, &expected);
+  // wielomian współdzielący tablicę z zebranym wielomianem się nie zmienia
+  unsigned long state = rand_state;
+  Poly p = RandPoly(2, 40, 50, 5);
+  rand_state = state;
+  Poly p_orig = RandPoly(2, 40, 50, 5);
+  PolyAccumulatorAdd(&acc, PolyClone(&p));
+  PolyAccumulatorAdd(&acc, PolyNeg(&p));
+  PolyAccumulatorAdd(&acc, PolyClone(&sum));
+  Poly sum2 = PolyAccumulatorFinalize(&acc);
+  res &= PolyIsEq(&sum2, &sum);
+  PolyDestroy(&sum2);
+  // zebrane wielomiany skracają się do zera, a wielomian o mniejszej
+  // liczbie jednomianów dostaje mniejszą tablicę
+  for (int i = 0; i < 10; ++i) {
+    PolyAccumulatorAdd(&acc, PolyClone(&p));
+    PolyAccumulatorAdd(&acc, PolyNeg(&p));
+  }
+  Poly zero = PolyAccumulatorFinalize(&acc);
+  res &= PolyIsZero(&zero);
+  PolyAccumulatorAdd(&acc, PolyClone(&p));
+  PolyAccumulatorAdd(&acc, PolyNeg(&p));
+  PolyAccumulatorAdd(&acc, P(C(1), 1, C(2), 5));
+  Poly small = PolyAccumulatorFinalize(&acc);
+  res &= !PolyIsCoeff(&small) && small.size == 2 &&
+         MonosCapacity(small.arr) == PolyRequiredSize(small.size);
+  PolyDestroy(&small);
+  // usunięcie akumulatora bez wyznaczania sumy
+  PolyAccumulatorAdd(&acc, PolyClone(&p));
+  PolyAccumulatorAddMono(&acc, M(C(4), 3));
+  PolyAccumulatorDestroy(&acc);
+  res &= PolyIsEq(&p, &p_orig);
+  PolyDestroy(&p);
+  PolyDestroy(&p_orig);
+  PolyDestroy(&sum);
+  PolyDestroy(&expected);
+  return res;
+}
+
+/* Sprawdza, czy MonosSort ustawia jednomiany o współczynnikach 0, 1, ...
+ * malejąco po wykładnikach, zachowując je wszystkie, a jednomiany o równych
+ * wykładnikach w kolejności współczynników, jeśli is_stable. */
+static bool TestMonosSort(Mono *monos, size_t size, bool is_stable) {
+  MonosSort(monos, size);
+  bool res = true;
+  bool *seen = calloc(size + 1, sizeof (bool));
+  CHECK_PTR(seen);
+  for (size_t i = 0; i < size; ++i) {
+    size_t idx = (size_t)monos[i].p.coeff;
+    res &= idx < size && !seen[idx];
+    if (idx < size)
+      seen[idx] = true;
+    if (i > 0) {
+      res &= monos[i - 1].exp >= monos[i].exp;
+      if (is_stable && monos[i - 1].exp == monos[i].exp)
+        res &= monos[i - 1].p.coeff < monos[i].p.coeff;
+    }
+  }
+  free(seen);
+  return res;
+}
+
+static bool MonosSortTest(void) {
+  bool res = true;
+  rand_state = 6;
+  const poly_exp_t extremes[] = {INT_MIN, -1, 0, 1, INT_MAX};
+  const size_t sizes[] = {0, 1, 5, 63, 64, 65, 200, 1000};
+  for (size_t s = 0; s < sizeof sizes / sizeof sizes[0]; ++s) {
+    size_t size = sizes[s];
+    Mono *monos = calloc(size + 1, sizeof (Mono));
+    CHECK_PTR(monos);
+    for (int pattern = 0; pattern < 5; ++pattern) {
+      for (size_t i = 0; i < size; ++i) {
+        poly_exp_t exp;
+        if (pattern == 0) // cały zakres, także ujemne
+          exp = (poly_exp_t)(uint32_t)(RandNext() << 1 ^ RandNext());
+        else if (pattern == 1) // mały zakres, wiele równych
+          exp = (poly_exp_t)(RandNext() % 20) - 10;
+        else if (pattern == 2) // wartości skrajne
+          exp = extremes[RandNext() % 5];
+        else if (pattern == 3) // rosnąco
+          exp = (poly_exp_t)i - (poly_exp_t)(size / 2);
+        else // malejąco
+          exp = (poly_exp_t)(size - i) * 1000;
+        monos[i] = (Mono){.p = C((poly_coeff_t)i), .exp = exp};
+      }
+      res &= TestMonosSort(monos, size, pattern != 3);
+    }
+    free(monos);
+  }
+  return res;
+}
+
+/* Sprawdza, czy mul(p, q) jest równe wynikowi PolyMulHeap. Usuwa p i q. */
+static bool TestMulAsHeap(Poly p, Poly q,
+                          Poly (*mul)(const Poly *, const Poly *)) {
+  Poly expected = PolyMulHeap(&p, &q);
+  Poly res = mul(&p, &q);
+  bool is_eq = PolyIsEq(&res, &expected);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&res);
+  PolyDestroy(&expected);
+  return is_eq;
+}
+
+static bool MulDenseTest(void) {
+  bool res = true;
+  rand_state = 7;
+  // długości poniżej i powyżej progów algorytmu Karatsuby, współczynniki
+  // liczbowe i wielomiany kolejnej zmiennej
+  const size_t sizes[] = {16, 20, 40, 100, 300};
+  for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; ++i) {
+    // RandPoly daje tyle samo jednomianów na każdym poziomie, więc
+    // wielomiany dwóch zmiennych są krótsze
+    for (int depth = 1; depth <= (sizes[i] <= 40 ? 2 : 1); ++depth) {
+      size_t n = sizes[i];
+      Poly p = RandPoly(depth, 2 * n, (poly_exp_t)n, 1000);
+      Poly q = RandPoly(depth, n, (poly_exp_t)(n / 2 + 4), 1000);
+      res &= PolyIsDense(&p) && PolyIsDense(&q);
+      res &= TestMulAsHeap(p, q, PolyMulDense);
+    }
+  }
+  // współczynniki, których iloczyny się przepełniają
+  Poly p = RandPoly(1, 64, 64, 1000);
+  Poly big = C(LONG_MAX / 3);
+  PolyMulByCoeffTo(&p, LONG_MAX / 7);
+  Poly q = PolyMul(&p, &big);
+  res &= TestMulAsHeap(p, q, PolyMulDense);
+  PolyDestroy(&big);
+  return res;
+}
+
+static bool MulKroneckerTest(void) {
+  bool res = true;
+  rand_state = 8;
+  // jedna i wiele zmiennych, rzadkie i gęste wykładniki
+  for (int i = 0; i < 6; ++i) {
+    int depth = 1 + i % 3;
+    size_t size = depth == 1 ? 300 : depth == 2 ? 30 : 10;
+    poly_exp_t max_exp = (poly_exp_t)(i < 3 ? size : 3 * size);
+    res &= TestMulAsHeap(RandPoly(depth, size, max_exp, 1000),
+                         RandPoly(depth, size, max_exp, 1000),
+                         PolyMulKronecker);
+  }
+  // współczynniki bliskie ograniczeniom typu, których iloczyny i ich sumy
+  // się przepełniają
+  const poly_coeff_t bounds[] = {LONG_MAX, LONG_MIN, LONG_MAX - 1,
+                                 LONG_MIN + 1, LONG_MAX / 2, -(1L << 40)};
+  for (size_t i = 0; i < 6; ++i) {
+    Poly p = RandPoly(2, 25, 40, 3);
+    Poly q = RandPoly(2, 25, 40, 3);
+    PolyMulByCoeffTo(&p, bounds[i]);
+    PolyMulByCoeffTo(&q, bounds[(i + 1) % 6]);
+    res &= TestMulAsHeap(p, q, PolyMulKronecker);
+  }
+  // małe iloczyny nie opłacają się, a duże tak
+  Poly small = RandPoly(2, 4, 10, 5);
+  Poly large = RandPoly(1, 2000, 4000, 5);
+  res &= !PolyMulKroneckerIsWorth(&small, &small);
+  res &= PolyMulKroneckerIsWorth(&large, &large);
+  PolyDestroy(&small);
+  PolyDestroy(&large);
+  return res;
+}
+
+/* Argumenty i wynik mnożenia w osobnym wątku aplikacji */
+typedef struct {
+  const Poly *p;
+  const Poly *q;
+  Poly res;
+} MulThreadArgs;
+
+static void *MulThread(void *arg) {
+  MulThreadArgs *args = arg;
+  args->res = PolyMul(args->p, args->q);
+  PolyScratchDestroy();
+  MonosPoolDestroy();
+  return NULL;
+}
+
+static bool MulParallelTest(void) {
+  bool res = true;
+  rand_state = 9;
+  Poly p = RandPoly(2, 24, 600, 1000);
+  Poly q = RandPoly(2, 20, 600, 1000);
+  Poly sparse = RandPoly(1, 400, 1 << 20, 1000);
+  Poly expected = PolyMulHeap(&p, &q);
+  Poly expected_sparse = PolyMulHeap(&sparse, &sparse);
+  // wynik nie zależy od liczby wątków
+  const size_t threads[] = {1, 2, 3, 8};
+  for (size_t i = 0; i < 4; ++i) {
+    PolySetThreads(threads[i]);
+    res &= PolyMulParallelIsWorth(&p, &q) == (threads[i] > 1);
+    Poly r = PolyMulParallel(&p, &q);
+    Poly s = PolyMul(&sparse, &sparse);
+    res &= PolyIsEq(&r, &expected) && PolyIsEq(&s, &expected_sparse);
+    PolyDestroy(&r);
+    PolyDestroy(&s);
+  }
+  // wątki aplikacji mnożące jednocześnie dzielą pulę
+  PolySetThreads(4);
+  MulThreadArgs args[4];
+  pthread_t tids[4];
+  for (size_t i = 0; i < 4; ++i) {
+    args[i] = (MulThreadArgs){.p = i % 2 ? &sparse : &p,
+                              .q = i % 2 ? &sparse : &q};
+    res &= pthread_create(&tids[i], NULL, MulThread, &args[i]) == 0;
+  }
+  for (size_t i = 0; i < 4; ++i) {
+    pthread_join(tids[i], NULL);
+    res &= PolyIsEq(&args[i].res, i % 2 ? &expected_sparse : &expected);
+    PolyDestroy(&args[i].res);
+  }
+  PolySetThreads(1);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&sparse);
+  PolyDestroy(&expected);
+  PolyDestroy(&expected_sparse);
+  return res;
+}
+
+static bool SqrTest(void) {
+  bool res = true;
+  rand_state = 10;
+  // małe, rzadkie, gęste i duże wielomiany, więc wszystkie algorytmy
+  // mnożenia, oraz współczynniki, których iloczyny się przepełniają
+  Poly polys[] = {C(-12345), C(LONG_MIN), P(C(1), 0, C(-1), 1),
+                  RandPoly(3, 4, 10, 100), RandPoly(1, 40, 1000, 100),
+                  RandPoly(2, 20, 20, 100), RandPoly(1, 300, 300, 100),
+                  RandPoly(1, 2000, 4000, 100), RandPoly(2, 15, 30, 1)};
+  PolyMulByCoeffTo(&polys[8], LONG_MAX / 5);
+  for (size_t i = 0; i < sizeof polys / sizeof polys[0]; ++i) {
+    Poly sqr = PolySqr(&polys[i]);
+    Poly expected = PolyMul(&polys[i], &polys[i]);
+    res &= PolyIsEq(&sqr, &expected);
+    PolyDestroy(&sqr);
+    PolyDestroy(&expected);
+    PolyDestroy(&polys[i]);
+  }
+  return res;
+}
+
+/* Sprawdza, czy PolyMulAddTo(&acc, &a, &b) daje acc + a * b i nie zmienia
+ * klonu acc współdzielącego z nim tablicę. Usuwa acc, a i b. */
+static bool TestMulAddTo(Poly acc, Poly a, Poly b) {
+  Poly prod = NaiveMul(&a, &b);
+  Poly expected = NaiveAdd(&acc, &prod);
+  Poly acc_clone = PolyClone(&acc);
+  Poly zero = PolyZero();
+  Poly acc_copy = NaiveAdd(&acc, &zero);
+  PolyMulAddTo(&acc, &a, &b);
+  bool is_eq = PolyIsEq(&acc, &expected) && PolyIsEq(&acc_clone, &acc_copy);
+  PolyDestroy(&acc);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&prod);
+  PolyDestroy(&expected);
+  PolyDestroy(&acc_clone);
+  PolyDestroy(&acc_copy);
+  return is_eq;
+}
+
+static bool MulAddToTest(void) {
+  bool res = true;
+  rand_state = 11;
+  // acc zerowy, współczynnik, mały i duży względem iloczynu, dla iloczynów
+  // wyznaczanych w całości i scalanych kopcem z acc
+  for (int i = 0; i < 24; ++i) {
+    size_t acc_size = (size_t[]){0, 1, 5, 1000}[i % 4];
+    Poly acc = acc_size == 0 ? PolyZero()
+               : acc_size == 1 ? C(7)
+               : RandPoly(1 + i % 2, acc_size, 2000, 5);
+    Poly a = RandPoly(1 + i % 2, 2 + i, 50, 3);
+    Poly b = RandPoly(1 + i / 2 % 2, 8 + i, 80, 3);
+    res &= TestMulAddTo(acc, a, b);
+  }
+
+  // acc jest jednym z czynników
+  Poly p = RandPoly(2, 12, 30, 3);
+  Poly q = RandPoly(2, 12, 30, 3);
+  Poly expected = NaiveMul(&p, &q);
+  PolyAddTo(&expected, &p);
+  PolyMulAddTo(&p, &p, &q);
+  res &= PolyIsEq(&p, &expected);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&expected);
+  return res;
+}
+
+/* Sprawdza, czy polecenie MUL_ADD kalkulatora zastępuje trzeci wielomian
+ * od wierzchołka stosu sumą jego i iloczynu dwóch wielomianów z wierzchu. */
+static bool CalcMulAddTest(void) {
+  bool res = true;
+  rand_state = 111;
+  for (int i = 0; i < 8; ++i) {
+    Poly acc = i % 2 == 0 ? C(i) : RandPoly(2, 6, 40, 5);
+    Poly a = RandPoly(1 + i % 2, 3 + i, 30, 5);
+    Poly b = RandPoly(2, 10, 30, 5);
+    Poly prod = NaiveMul(&a, &b);
+    Poly expected = NaiveAdd(&acc, &prod);
+
+    Stack stack = StackNewEmpty();
+    StackPush(&stack, C(1));
+    StackPush(&stack, acc);
+    StackPush(&stack, b);
+    StackPush(&stack, a);
+    InstMulAdd(&stack);
+    res &= stack.size == 2 && PolyIsEq(StackPeek(&stack), &expected);
+    StackDestroy(&stack);
+    PolyDestroy(&prod);
+    PolyDestroy(&expected);
+  }
+  return res;
+}
+
+static bool ArenaTest(void) {
+  bool res = true;
+  rand_state = 12;
+  PolyArena arena = PolyArenaNew();
+  Poly p = RandPoly(3, 10, 50, 100);
+  Poly q = RandPoly(2, 30, 50, 100);
+  Poly coeff = C(-5);
+
+  // kopie w arenie są równe oryginałom i działają jak zwykłe wielomiany
+  Poly p_arena = PolyCloneInto(&arena, &p);
+  Poly q_arena = PolyCloneInto(&arena, &q);
+  Poly coeff_arena = PolyCloneInto(&arena, &coeff);
+  res &= PolyIsEq(&p_arena, &p) && PolyIsEq(&q_arena, &q);
+  res &= PolyIsEq(&coeff_arena, &coeff);
+  res &= p_arena.arr != p.arr && q_arena.arr != q.arr;
+  Poly prod = PolyMul(&p_arena, &q_arena);
+  Poly expected = PolyMul(&p, &q);
+  res &= PolyIsEq(&prod, &expected);
+  PolyDestroy(&prod);
+  PolyDestroy(&expected);
+
+  // kopia wielomianu z areny przeżywa arenę
+  Poly p_clone = PolyClone(&p_arena);
+
+  // pamięć przydzielona po zapamiętaniu miejsca jest przydzielana ponownie
+  PolyArenaMark mark = PolyArenaGetMark(&arena);
+  void *first = PolyArenaAlloc(&arena, 100);
+  void *big = PolyArenaAlloc(&arena, 4 * ARENA_BLOCK_SIZE);
+  res &= first != NULL && big != NULL;
+  res &= (uintptr_t)first % _Alignof(max_align_t) == 0;
+  memset(big, 0xab, 4 * ARENA_BLOCK_SIZE);
+  PolyArenaRelease(&arena, mark);
+  res &= PolyArenaAlloc(&arena, 100) == first;
+  res &= PolyIsEq(&p_arena, &p) && PolyIsEq(&q_arena, &q);
+
+  // po wyczyszczeniu arena przydziela pamięć od początku
+  PolyArenaReset(&arena);
+  PolyArenaMark start = PolyArenaGetMark(&arena);
+  Poly q_again = PolyCloneInto(&arena, &q);
+  res &= PolyIsEq(&q_again, &q);
+  PolyArenaRelease(&arena, start);
+  res &= PolyCloneInto(&arena, &q).arr == q_again.arr;
+
+  PolyArenaDestroy(&arena);
+  res &= arena.first == NULL && arena.current == NULL && arena.used == 0;
+  res &= PolyIsEq(&p_clone, &p);
+  PolyDestroy(&p_clone);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  return res;
+}
+
+/* Sprawdza liczniki statystyk ponownego używania tablic jednomianów. */
+static bool StatsEq(size_t allocs, size_t hits, size_t frees,
+                    size_t recycled) {
+  MonosPoolStats stats = MonosPoolGetStats();
+  return stats.allocs == allocs && stats.hits == hits &&
+         stats.frees == frees && stats.recycled == recycled;
+}
+
+static bool MonosPoolStatsTest(void) {
+  bool res = true;
+  MonosPoolDestroy();
+  MonosPoolResetStats();
+  res &= StatsEq(0, 0, 0, 0);
+
+  // tablica z klasy rozmiarów jest odkładana i brana ponownie
+  Mono *arr = MonosAlloc(4 * INIT_SIZE);
+  res &= StatsEq(1, 0, 0, 0);
+  MonosFree(arr);
+  res &= StatsEq(1, 0, 1, 1);
+  res &= MonosAlloc(4 * INIT_SIZE) == arr;
+  res &= StatsEq(2, 1, 1, 1);
+
+  // zmiana pojemności to przydzielenie i zwolnienie tablicy
+  arr = MonosRealloc(arr, 8 * INIT_SIZE);
+  res &= StatsEq(3, 1, 2, 1) && MonosCapacity(arr) == 8 * INIT_SIZE;
+  res &= MonosPoolGetStats().reallocs == 1;
+  MonosFree(arr);
+  res &= StatsEq(3, 1, 3, 2);
+
+  // tablica spoza klas rozmiarów nie jest odkładana
+  arr = MonosAlloc(3 * INIT_SIZE);
+  MonosFree(arr);
+  res &= StatsEq(4, 1, 4, 2);
+
+  // lista wolnych tablic jednej klasy jest ograniczona
+  Mono *arrs[MONOS_POOL_MAX_FREE + 1];
+  for (size_t i = 0; i <= MONOS_POOL_MAX_FREE; ++i)
+    arrs[i] = MonosAlloc(INIT_SIZE);
+  for (size_t i = 0; i <= MONOS_POOL_MAX_FREE; ++i)
+    MonosFree(arrs[i]);
+  res &= StatsEq(5 + MONOS_POOL_MAX_FREE, 1, 5 + MONOS_POOL_MAX_FREE,
+                 2 + MONOS_POOL_MAX_FREE);
+
+  MonosPoolResetStats();
+  res &= StatsEq(0, 0, 0, 0);
+  MonosPoolDestroy();
+  return res;
+}
+
+/* Sprawdza, czy dodawanie nie tworzy tablic, które zaraz są powiększane
+ * albo zwalniane. */
+static bool AddAllocsTest(void) {
+  bool res = true;
+
+  // stała plus współdzielony, internowany wielomian, którego wyraz wolny
+  // się skraca: jedna kopia q, bez tablicy jednomianu Cx^0
+  Poly q_own = P(C(-5), 0, C(2), 1, C(3), 2);
+  Poly q = PolyIntern(&q_own);
+  Poly q_shared = PolyClone(&q);
+  Poly c = C(5);
+  MonosPoolResetStats();
+  Poly sum = PolyAdd(&c, &q_shared);
+  MonosPoolStats stats = MonosPoolGetStats();
+  res &= stats.allocs == 1 && stats.reallocs == 0;
+  Poly expected = P(C(2), 1, C(3), 2);
+  res &= PolyIsEq(&sum, &expected) && PolyIsEq(&q_shared, &q_own);
+  PolyDestroy(&sum);
+  PolyDestroy(&expected);
+
+  // współdzielony wielomian jest kopiowany od razu do tablicy mieszczącej
+  // sumę
+  Poly p = P(C(1), 0, C(1), 4);
+  Poly p_shared = PolyClone(&p);
+  Poly r = P(C(1), 1, C(1), 2, C(1), 3, C(1), 5, C(1), 6);
+  MonosPoolResetStats();
+  PolyAddTo(&p_shared, &r);
+  stats = MonosPoolGetStats();
+  res &= stats.allocs == 1 && stats.reallocs == 0;
+  expected = NaiveAdd(&p, &r);
+  res &= PolyIsEq(&p_shared, &expected);
+  PolyDestroy(&expected);
+
+  MonosPoolResetStats();
+  PolyDestroy(&p_shared);
+  PolyDestroy(&p);
+  PolyDestroy(&r);
+  PolyDestroy(&q_shared);
+  PolyDestroy(&q);
+  PolyDestroy(&q_own);
+  PolyInternCollect();
+  return res;
+}
+
+/* Alokator, który po wyczerpaniu limitu przydziałów zwraca NULL, i liczy
+ * przydzielone bloki. */
+typedef struct {
+  size_t live;
+  size_t budget;
+  bool is_limited;
+} FailingAllocator;
+
+static bool FailingAllocatorTake(FailingAllocator *a) {
+  if (a->is_limited && a->budget == 0)
+    return false;
+  if (a->is_limited)
+    a->budget--;
+  return true;
+}
+
+static void *FailingMalloc(size_t size, void *ctx) {
+  FailingAllocator *a = ctx;
+  if (!FailingAllocatorTake(a))
+    return NULL;
+  void *ptr = malloc(size);
+  if (ptr != NULL)
+    a->live++;
+  return ptr;
+}
+
+static void *FailingRealloc(void *ptr, size_t size, void *ctx) {
+  if (ptr == NULL)
+    return FailingMalloc(size, ctx);
+  if (!FailingAllocatorTake(ctx))
+    return NULL;
+  return realloc(ptr, size);
+}
+
+static void FailingFree(void *ptr, void *ctx) {
+  FailingAllocator *a = ctx;
+  if (ptr != NULL)
+    a->live--;
+  free(ptr);
+}
+
+/* Liczba bloków przydzielonych przez wielomiany, bez pamięci podręcznej
+ * bieżącego wątku. */
+static size_t FailingAllocatorLive(FailingAllocator *a) {
+  MonosPoolDestroy();
+  PolyScratchDestroy();
+  return a->live;
+}
+
+typedef enum {
+  TRY_CLONE, TRY_ADD, TRY_SUB, TRY_MUL, TRY_AT, TRY_COMPOSE, TRY_COMPOSE_TO,
+  TRY_OPS
+} TryOp;
+
+static bool RunTryOp(TryOp op, Poly *p, const Poly *q, size_t k, Poly qs[],
+                     Poly *res) {
+  switch (op) {
+    case TRY_CLONE:
+      return PolyTryClone(p, res);
+    case TRY_ADD:
+      return PolyTryAdd(p, q, res);
+    case TRY_SUB:
+      return PolyTrySub(p, q, res);
+    case TRY_MUL:
+      return PolyTryMul(p, q, res);
+    case TRY_AT:
+      return PolyTryAt(p, -3, res);
+    case TRY_COMPOSE:
+      return PolyTryCompose(p, k, qs, res);
+    default:
+      return PolyTryComposeTo(p, k, qs);
+  }
+}
+
+static bool AllocatorTest(void) {
+  bool res = true;
+  FailingAllocator a = {0, 0, false};
+  PolySetAllocator(FailingMalloc, FailingRealloc, FailingFree, &a);
+  rand_state = 14;
+  Poly p = RandPoly(2, 6, 8, 50);
+  Poly q = RandPoly(2, 5, 8, 50);
+  Poly qs[] = {RandPoly(1, 2, 2, 5), RandPoly(2, 2, 2, 5)};
+  size_t k = sizeof qs / sizeof qs[0];
+  // kopie do porównań nie współdzielą tablic z wejściem
+  Poly zero = PolyZero();
+  Poly p_copy = NaiveAdd(&p, &zero);
+  Poly q_copy = NaiveAdd(&q, &zero);
+
+  // każda operacja kończy się niepowodzeniem przy każdym limicie
+  // przydziałów mniejszym niż potrzebny i wtedy nie zostawia pamięci
+  for (TryOp op = 0; op < TRY_OPS; ++op) {
+    bool is_done = false;
+    for (size_t budget = 0; !is_done && budget < 100000; ++budget) {
+      Poly p_op = op == TRY_COMPOSE_TO ? PolyClone(&p) : p;
+      Poly qs_op[] = {PolyClone(&qs[0]), PolyClone(&qs[1])};
+      Poly res_op = PolyZero();
+      size_t live = FailingAllocatorLive(&a);
+
+      a.budget = budget;
+      a.is_limited = true;
+      is_done = RunTryOp(op, &p_op, &q, k, qs_op, &res_op);
+      a.is_limited = false;
+
+      if (!is_done) {
+        res &= FailingAllocatorLive(&a) == live;
+        res &= PolyIsEq(&p_op, &p_copy) && PolyIsEq(&q, &q_copy);
+        res &= PolyIsEq(&qs_op[0], &qs[0]) && PolyIsEq(&qs_op[1], &qs[1]);
+        for (size_t i = 0; i < k; ++i)
+          PolyDestroy(&qs_op[i]);
+      } else if (op != TRY_COMPOSE_TO) {
+        for (size_t i = 0; i < k; ++i)
+          PolyDestroy(&qs_op[i]);
+      }
+      if (op == TRY_COMPOSE_TO)
+        PolyDestroy(&p_op);
+      PolyDestroy(&res_op);
+    }
+    res &= is_done;
+  }
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&qs[0]);
+  PolyDestroy(&qs[1]);
+  PolyDestroy(&p_copy);
+  PolyDestroy(&q_copy);
+  res &= FailingAllocatorLive(&a) == 0;
+  PolySetAllocator(NULL, NULL, NULL, NULL);
+  return res;
+}
+
+/* Zmienia wielomian w miejscu jedną z funkcji modyfikujących. */
+static void MutateInPlace(int op, Poly *p, const Poly *q) {
+  switch (op) {
+    case 0:
+      PolyAddTo(p, q);
+      break;
+    case 1:
+      PolyNegTo(p);
+      break;
+    case 2:
+      PolyMulByCoeffTo(p, -7);
+      break;
+    case 3: {
+      Mono m = MonoClone(&q->arr[0]);
+      PolyAddMonoTo(p, &m);
+      break;
+    }
+    case 4:
+      PolyMulAddTo(p, q, q);
+      break;
+    default: {
+      Poly qs[] = {PolyClone(q), C(2)};
+      PolyComposeTo(p, 2, qs);
+      break;
+    }
+  }
+}
+
+static bool CowTest(void) {
+  bool res = true;
+  for (int op = 0; op < 6; ++op) {
+    for (int mutate_clone = 0; mutate_clone < 2; ++mutate_clone) {
+      rand_state = 15;
+      Poly p = RandPoly(3, 6, 20, 50);
+      Poly q = RandPoly(2, 5, 20, 50);
+      rand_state = 15;
+      Poly p_copy = RandPoly(3, 6, 20, 50);
+      Poly expected = PolyClone(&p_copy);
+      MutateInPlace(op, &expected, &q);
+
+      // klon współdzieli tablice z oryginałem, także tablice podwielomianów
+      Poly clone = PolyClone(&p);
+      Poly sub_clone = PolyClone(&p.arr[p.size - 1].p);
+      Poly *mutated = mutate_clone ? &clone : &p;
+      Poly *kept = mutate_clone ? &p : &clone;
+      MutateInPlace(op, mutated, &q);
+      res &= PolyIsEq(mutated, &expected) && PolyIsEq(kept, &p_copy);
+      res &= PolyIsEq(&sub_clone, &p_copy.arr[p_copy.size - 1].p);
+
+      PolyDestroy(&p);
+      PolyDestroy(&q);
+      PolyDestroy(&p_copy);
+      PolyDestroy(&expected);
+      PolyDestroy(&clone);
+      PolyDestroy(&sub_clone);
+    }
+  }
+  return res;
+}
+
+static bool OwnMonosCowTest(void) {
+  bool res = true;
+  for (int adopt = 0; adopt < 2; ++adopt) {
+    // nieposortowane wykładniki, powtórzony wykładnik i podwielomian
+    Mono *monos = adopt ? PolyMallocMonos(4) : calloc(4, sizeof (Mono));
+    assert(monos != NULL);
+    monos[0] = M(C(3), 2);
+    monos[1] = M(P(C(1), 0, C(2), 1), 1);
+    monos[2] = M(C(-1), 2);
+    monos[3] = M(C(5), 0);
+    Poly p = adopt ? PolyAdoptMonos(4, monos) : PolyOwnMonos(4, monos);
+    Poly expected = P(C(5), 0, P(C(1), 0, C(2), 1), 1, C(2), 2);
+    res &= PolyIsEq(&p, &expected);
+    if (adopt)
+      res &= p.arr == monos;
+    res &= MonosRefCount(p.arr) == 1 && !MonosIsShared(p.arr);
+
+    // klon współdzieli tablicę, zmiana klonu ją kopiuje
+    Poly clone = PolyClone(&p);
+    res &= clone.arr == p.arr && MonosRefCount(p.arr) == 2;
+    Poly one = C(1);
+    PolyAddTo(&clone, &one);
+    res &= clone.arr != p.arr && MonosRefCount(p.arr) == 1;
+    res &= MonosRefCount(clone.arr) == 1;
+    res &= clone.arr[1].p.arr == p.arr[1].p.arr;
+    res &= MonosRefCount(p.arr[1].p.arr) == 2;
+    res &= PolyIsEq(&p, &expected);
+
+    // zmiana oryginału nie psuje klonu
+    Poly clone_copy = PolyClone(&clone);
+    PolyNegTo(&p);
+    res &= PolyIsEq(&clone, &clone_copy);
+    Poly neg = PolyNeg(&expected);
+    res &= PolyIsEq(&p, &neg);
+
+    PolyDestroy(&p);
+    PolyDestroy(&expected);
+    PolyDestroy(&clone);
+    PolyDestroy(&clone_copy);
+    PolyDestroy(&neg);
+  }
+
+  // pusta tablica z PolyMallocMonos
+  Poly zero = PolyAdoptMonos(0, PolyMallocMonos(0));
+  res &= PolyIsZero(&zero);
+  PolyFreeMonos(PolyMallocMonos(3));
+  return res;
+}
+
+static bool InternTest(void) {
+  bool res = true;
+  PolyInternClear();
+  PolyInternStats stats = PolyInternGetStats();
+  res &= stats.arrays == 0 && stats.monos == 0;
+
+  // równe wielomiany i równe podwielomiany współdzielą tablice
+  rand_state = 16;
+  Poly p = RandPoly(3, 5, 20, 9);
+  rand_state = 16;
+  Poly p_copy = RandPoly(3, 5, 20, 9);
+  Poly p_interned = PolyIntern(&p);
+  Poly p_copy_interned = PolyIntern(&p_copy);
+  Poly p_again = PolyIntern(&p_interned);
+  res &= p_interned.arr != p.arr && p_interned.arr == p_copy_interned.arr;
+  res &= p_again.arr == p_interned.arr;
+  res &= PolyIsEq(&p_interned, &p) && PolyIsEq(&p_interned, &p_copy_interned);
+
+  // tablica wspólnego podwielomianu jest liczona raz
+  PolyInternStats before = PolyInternGetStats();
+  Poly s = RandPoly(1, 6, 10, 9);
+  Poly a = P(PolyClone(&s), 1);
+  Poly b = P(C(1), 0, PolyClone(&s), 2);
+  Poly a_interned = PolyIntern(&a);
+  Poly b_interned = PolyIntern(&b);
+  res &= a_interned.arr[0].p.arr == b_interned.arr[0].p.arr;
+  res &= !PolyIsEq(&a_interned, &b_interned);
+  stats = PolyInternGetStats();
+  res &= stats.arrays == before.arrays + 3;
+  res &= stats.monos == before.monos + 3 + s.size;
+
+  // zmiana w miejscu kopiuje internowaną tablicę
+  PolyNegTo(&p_copy_interned);
+  PolyNegTo(&p_copy);
+  res &= PolyIsEq(&p_copy_interned, &p_copy) && PolyIsEq(&p_interned, &p);
+  res &= p_copy_interned.arr != p_interned.arr;
+
+  // nieużywane tablice są usuwane, a używane zostają
+  PolyDestroy(&a_interned);
+  PolyDestroy(&b_interned);
+  PolyDestroy(&p_copy_interned);
+  PolyInternCollect();
+  PolyInternStats collected = PolyInternGetStats();
+  res &= collected.arrays < stats.arrays && collected.arrays > 0;
+  Poly p_after = PolyIntern(&p);
+  res &= p_after.arr == p_interned.arr;
+  PolyDestroy(&p_interned);
+  PolyDestroy(&p_again);
+  PolyDestroy(&p_after);
+  PolyInternCollect();
+  stats = PolyInternGetStats();
+  res &= stats.arrays == 0 && stats.monos == 0;
+
+  // po wyczyszczeniu tablicy wielomiany pozostają ważne
+  a_interned = PolyIntern(&a);
+  PolyInternClear();
+  stats = PolyInternGetStats();
+  res &= stats.arrays == 0 && PolyIsEq(&a_interned, &a);
+  b_interned = PolyIntern(&a);
+  res &= b_interned.arr != a_interned.arr && PolyIsEq(&b_interned, &a);
+  PolyDestroy(&a_interned);
+  PolyDestroy(&b_interned);
+  PolyInternClear();
+
+  PolyDestroy(&p);
+  PolyDestroy(&p_copy);
+  PolyDestroy(&s);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  return res;
+}
+
+/* Stopień wielomianu wyznaczony przejściem drzewa. */
+static poly_exp_t NaiveDeg(const Poly *p) {
+  if (PolyIsCoeff(p))
+    return PolyIsZero(p) ? -1 : 0;
+  poly_exp_t deg = -1;
+  for (size_t i = 0; i < p->size; ++i) {
+    poly_exp_t coeff_deg = p->arr[i].exp + NaiveDeg(&p->arr[i].p);
+    deg = coeff_deg > deg ? coeff_deg : deg;
+  }
+  return deg;
+}
+
+/* Stopień wielomianu względem zmiennej wyznaczony przejściem drzewa. */
+static poly_exp_t NaiveDegBy(const Poly *p, size_t var_idx) {
+  if (PolyIsCoeff(p))
+    return PolyIsZero(p) ? -1 : 0;
+  poly_exp_t deg = 0;
+  for (size_t i = 0; i < p->size; ++i) {
+    poly_exp_t coeff_deg = var_idx == 0 ? p->arr[i].exp
+                           : NaiveDegBy(&p->arr[i].p, var_idx - 1);
+    deg = coeff_deg > deg ? coeff_deg : deg;
+  }
+  return deg;
+}
+
+/* Sprawdza stopnie i równość wielomianu z kopią, która nie współdzieli
+ * z nim tablicy. */
+static bool TestCachedMeta(const Poly *p) {
+  bool res = PolyDeg(p) == NaiveDeg(p);
+  for (size_t i = 0; i < 5; ++i)
+    res &= PolyDegBy(p, i) == NaiveDegBy(p, i);
+  Poly zero = PolyZero();
+  Poly copy = NaiveAdd(p, &zero);
+  res &= PolyIsEq(p, &copy) && PolyIsEq(&copy, p);
+  PolyDestroy(&copy);
+  return res;
+}
+
+static bool CacheTest(void) {
+  bool res = true;
+  rand_state = 17;
+  Poly p = RandPoly(3, 6, 20, 9);
+  Poly q = RandPoly(3, 6, 20, 9);
+  res &= TestCachedMeta(&p) && !PolyIsEq(&p, &q);
+
+  // zmiany w miejscu po zapamiętaniu metadanych, także w głębi drzewa
+  // i w tablicach współdzielonych z klonem
+  for (int i = 0; i < 12; ++i) {
+    int op = i / 2;
+    Poly clone = i % 2 == 0 ? PolyZero() : PolyClone(&p);
+    poly_exp_t clone_deg = PolyDeg(&clone);
+    switch (op) {
+      case 0: {
+        Poly high = P(C(1), 100);
+        PolyAddTo(&p, &high);
+        PolyDestroy(&high);
+        break;
+      }
+      case 1: {
+        Mono leading = MonoClone(&p.arr[0]);
+        PolyNegTo(&leading.p);
+        PolyAddMonoTo(&p, &leading);
+        break;
+      }
+      case 2: {
+        Poly deep = P(P(P(C(1), 60), 0), p.arr[1].exp);
+        PolyAddTo(&p, &deep);
+        PolyDestroy(&deep);
+        break;
+      }
+      case 3:
+        PolyNegTo(&p);
+        break;
+      case 4:
+        PolyMulByCoeffTo(&p, 3);
+        break;
+      default:
+        PolyAddTo(&p, &q);
+        break;
+    }
+    res &= TestCachedMeta(&p) && TestCachedMeta(&clone);
+    res &= PolyDeg(&clone) == clone_deg && !PolyIsEq(&p, &clone);
+    PolyDestroy(&clone);
+  }
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  return res;
+}
+
+static bool SizeofTest(void) {
+  // wielomian i jednomian są upakowane, żeby tablice jednomianów były małe
+  return sizeof (Poly) == 12 && sizeof (Mono) == 16;
+}
+
+/* Wartość wielomianu wyznaczona kolejnymi wywołaniami PolyAt. */
+static poly_coeff_t NaiveEval(const Poly *p, size_t k,
+                              const poly_coeff_t x[]) {
+  Poly q = PolyClone(p);
+  for (size_t i = 0; !PolyIsCoeff(&q); ++i) {
+    Poly at = PolyAt(&q, i < k ? x[i] : 0);
+    PolyDestroy(&q);
+    q = at;
+  }
+  return q.coeff;
+}
+
+static bool EvalTest(void) {
+  bool res = true;
+  rand_state = 21;
+  // wartości, których potęgi się przepełniają lub zerują modulo 2^64,
+  // i mniej wartości niż zmiennych
+  const poly_coeff_t values[] = {0, 1, -1, 2, -3, 1L << 32, LONG_MAX,
+                                 LONG_MIN, 123456789, -987654321};
+  const size_t values_count = sizeof values / sizeof values[0];
+  for (int i = 0; i < 40; ++i) {
+    Poly p = RandPoly(1 + i % 3, 3 + i % 5, 200, LONG_MAX / 2);
+    poly_coeff_t x[3];
+    for (size_t j = 0; j < 3; ++j)
+      x[j] = i % 2 == 0 ? values[RandNext() % values_count]
+                        : (poly_coeff_t)(RandNext() << 33 ^ RandNext());
+    for (size_t k = 0; k <= 3; ++k)
+      res &= PolyEval(&p, k, x) == NaiveEval(&p, k, x);
+    PolyDestroy(&p);
+  }
+  return res;
+}
+
+/* Sprawdza, czy PolyEvalBatch daje wartości PolyEval we wszystkich
+ * punktach. */
+static bool TestEvalBatch(const Poly *p, size_t k, size_t n_points) {
+  poly_coeff_t *xs = calloc(k * n_points + 1, sizeof (poly_coeff_t));
+  poly_coeff_t *out = calloc(n_points + 1, sizeof (poly_coeff_t));
+  CHECK_PTR(xs);
+  CHECK_PTR(out);
+  // małe wartości i wartości, których potęgi się przepełniają
+  for (size_t i = 0; i < k * n_points; ++i)
+    xs[i] = i % 3 == 0 ? (poly_coeff_t)(RandNext() << 33 ^ RandNext())
+                       : (poly_coeff_t)(RandNext() % 7) - 3;
+  // ścieżka bez instrukcji AVX2 i ścieżka AVX2, jeśli jest dostępna
+  bool res = true;
+  for (int avx2 = 0; avx2 < 2; ++avx2) {
+    PolySetEvalAvx2(avx2);
+    res &= avx2 || !PolyGetEvalAvx2();
+    PolyEvalBatch(p, k, n_points, xs, out);
+    for (size_t i = 0; i < n_points; ++i)
+      res &= out[i] == PolyEval(p, k, xs + i * k);
+  }
+  free(xs);
+  free(out);
+  return res;
+}
+
+static bool EvalBatchTest(void) {
+  bool res = true;
+  rand_state = 22;
+  size_t threads = PolyGetThreads();
+  // liczby punktów niepodzielne przez EVAL_LANES i dzielone między wątki
+  const size_t n_points[] = {0, 1, EVAL_LANES - 1, EVAL_LANES,
+                             3 * EVAL_LANES + 5, EVAL_PAR_MIN_POINTS + 3};
+  for (size_t t = 1; t <= 3; t += 2) {
+    PolySetThreads(t);
+    for (int i = 0; i < 6; ++i) {
+      Poly p = i == 0 ? C(-42) : RandPoly(i % 3 + 1, 4, 70, LONG_MAX / 2);
+      for (size_t j = 0; j < sizeof n_points / sizeof n_points[0]; ++j)
+        res &= TestEvalBatch(&p, (size_t)i % 4, n_points[j]);
+      PolyDestroy(&p);
+    }
+  }
+  PolySetThreads(threads);
+  return res;
+}
+
+static bool ProgramTest(void) {
+  bool res = true;
+  rand_state = 23;
+  const uint32_t mods[] = {1, 7, 1000003, UINT32_MAX};
+  for (int i = 0; i < 24; ++i) {
+    // małe współczynniki i wykładniki, dla których wartości się mieszczą,
+    // i duże, dla których się przepełniają
+    bool is_small = i % 2 == 0;
+    Poly p = i < 2 ? C(i - 7)
+                   : RandPoly(1 + i % 3, 4, is_small ? 5 : 90,
+                              is_small ? 9 : LONG_MAX / 2);
+    PolyProgram prog = PolyProgramCompile(&p);
+
+    const size_t n_points = 2 * EVAL_LANES + 3;
+    poly_coeff_t xs[3 * (2 * EVAL_LANES + 3)];
+    poly_coeff_t out[2 * EVAL_LANES + 3];
+    size_t k = (size_t)i % 4;
+    for (size_t j = 0; j < sizeof xs / sizeof xs[0]; ++j)
+      xs[j] = is_small ? (poly_coeff_t)(RandNext() % 7) - 3
+                       : (poly_coeff_t)(RandNext() << 33 ^ RandNext());
+
+    PolyProgramEvalBatch(&prog, k, n_points, xs, out);
+    for (size_t j = 0; j < n_points; ++j) {
+      poly_coeff_t val = PolyEval(&p, k, xs + j * k);
+      res &= PolyProgramEval(&prog, k, xs + j * k) == val && out[j] == val;
+      for (size_t m = 0; is_small && m < sizeof mods / sizeof mods[0]; ++m) {
+        poly_coeff_t mod = (poly_coeff_t)mods[m];
+        poly_coeff_t expected = (val % mod + mod) % mod;
+        res &= PolyProgramEvalMod(&prog, k, xs + j * k, mods[m]) == expected;
+      }
+    }
+
+    PolyProgramDestroy(&prog);
+    res &= prog.code == NULL && prog.size == 0 && prog.regs == 0;
+    PolyDestroy(&p);
+  }
+  return res;
+}
+
+/* Zwraca kod wypisany przez PolyEmitC. Wynik należy zwolnić funkcją
+ * free. */
+static char *EmitToString(const Poly *p, const char *fn_name) {
+  FILE *file = tmpfile();
+  CHECK_PTR(file);
+  PolyEmitC(p, file, fn_name);
+  long size = ftell(file);
+  char *code = calloc((size_t)size + 1, 1);
+  CHECK_PTR(code);
+  rewind(file);
+  size_t read = fread(code, 1, (size_t)size, file);
+  fclose(file);
+  code[read] = '\0';
+  return code;
+}
+
+/* Sprawdza, czy kod zawiera stałe wszystkich współczynników liczbowych
+ * wielomianu. */
+static bool EmitHasCoeffs(const Poly *p, const char *code) {
+  if (PolyIsCoeff(p)) {
+    char constant[32];
+    sprintf(constant, "%ldUL;", p->coeff < 0 ? -p->coeff : p->coeff);
+    return strstr(code, constant) != NULL;
+  }
+  bool res = true;
+  for (size_t i = 0; i < p->size; ++i)
+    res &= EmitHasCoeffs(&p->arr[i].p, code);
+  return res;
+}
+
+static bool EmitCTest(void) {
+  bool res = true;
+  Poly p = P(C(3), 0, C(-5), 2);
+  char *code = EmitToString(&p, "f");
+  res &= strcmp(code, "long f(const long x[])\n"
+                      "{\n"
+                      "    const unsigned long x0 = x[0];\n"
+                      "    const unsigned long x0_2 = x0 * x0;\n"
+                      "    unsigned long r0;\n"
+                      "    r0 = -5UL;\n"
+                      "    r0 = r0 * x0_2 + 3UL;\n"
+                      "    return (long)r0;\n"
+                      "}\n") == 0;
+  free(code);
+  PolyDestroy(&p);
+
+  p = C(LONG_MIN);
+  code = EmitToString(&p, "g");
+  res &= strstr(code, "long g(const long x[])\n") == code;
+  res &= strstr(code, "(void)x;") != NULL;
+  res &= strstr(code, "r0 = -9223372036854775808UL;") != NULL;
+  free(code);
+
+  // kod jest powtarzalny i zawiera wszystkie współczynniki wielomianu
+  rand_state = 24;
+  p = RandPoly(3, 4, 40, 1000000);
+  code = EmitToString(&p, "poly_fn");
+  char *again = EmitToString(&p, "poly_fn");
+  res &= strcmp(code, again) == 0;
+  res &= strstr(code, "long poly_fn(const long x[])\n") == code;
+  // rejestr na każdą zmienną, a współczynniki liczbowe są stałymi
+  res &= strstr(code, "unsigned long r0, r1, r2;") != NULL;
+  res &= EmitHasCoeffs(&p, code);
+  free(code);
+  free(again);
+  PolyDestroy(&p);
+  return res;
+}
+
+/* Sprawdza flagę i liczniki przepełnień. */
+static bool OverflowStatsEq(size_t coeffs, size_t exps) {
+  PolyOverflowStats stats = PolyOverflowGetStats();
+  return stats.coeffs == coeffs && stats.exps == exps &&
+         PolyOverflowOccurred() == (coeffs + exps > 0);
+}
+
+/* Wykonuje działania, które się przepełniają, i zwraca ich wyniki. */
+static void OverflowingOps(Poly res[3], poly_coeff_t *eval) {
+  Poly max = C(LONG_MAX);
+  Poly one = C(1);
+  res[0] = PolyAdd(&max, &one);
+  rand_state = 25;
+  Poly p = RandPoly(2, 12, 30, LONG_MAX / 2);
+  Poly q = RandPoly(2, 12, 30, LONG_MAX / 2);
+  res[1] = PolyMul(&p, &q);
+  res[2] = NaiveMul(&p, &q);
+  Poly linear = P(C(LONG_MAX), 1);
+  *eval = PolyEval(&linear, 1, (poly_coeff_t[]){3});
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&linear);
+}
+
+static bool OverflowCheckTest(void) {
+  bool res = true;
+  bool was_enabled = PolyGetOverflowCheck();
+
+  // bez sprawdzania przepełnienia nie są zgłaszane
+  PolySetOverflowCheck(false);
+  PolyOverflowClear();
+  Poly unchecked[3];
+  poly_coeff_t unchecked_eval;
+  OverflowingOps(unchecked, &unchecked_eval);
+  res &= OverflowStatsEq(0, 0);
+
+  // ze sprawdzaniem wyniki są takie same, modulo 2^64, a przepełnienia
+  // są liczone
+  PolySetOverflowCheck(true);
+  PolyOverflowClear();
+  Poly small = P(C(2), 3);
+  Poly small_sqr = PolyMul(&small, &small);
+  res &= OverflowStatsEq(0, 0);
+  Poly checked[3];
+  poly_coeff_t checked_eval;
+  OverflowingOps(checked, &checked_eval);
+  PolyOverflowStats stats = PolyOverflowGetStats();
+  res &= PolyOverflowOccurred() && stats.coeffs > 0 && stats.exps == 0;
+  res &= PolyIsCoeff(&checked[0]) && checked[0].coeff == LONG_MIN;
+  res &= checked_eval == (poly_coeff_t)((unsigned long)LONG_MAX * 3);
+  res &= unchecked_eval == checked_eval;
+  res &= PolyIsEq(&checked[1], &checked[2]);
+  for (size_t i = 0; i < 3; ++i) {
+    res &= PolyIsEq(&unchecked[i], &checked[i]);
+    PolyDestroy(&unchecked[i]);
+    PolyDestroy(&checked[i]);
+  }
+
+  // po wyzerowaniu liczone są tylko nowe przepełnienia
+  PolyOverflowClear();
+  res &= OverflowStatsEq(0, 0);
+  Poly max = C(LONG_MAX);
+  Poly sum = PolyAdd(&max, &max);
+  res &= OverflowStatsEq(1, 0);
+  Poly high = P(C(1), INT_MAX);
+  Poly x = P(C(1), 1);
+  Poly prod = PolyMul(&high, &x);
+  res &= OverflowStatsEq(1, 1);
+
+  PolyDestroy(&small);
+  PolyDestroy(&small_sqr);
+  PolyDestroy(&sum);
+  PolyDestroy(&high);
+  PolyDestroy(&x);
+  PolyDestroy(&prod);
+  PolyOverflowClear();
+  PolySetOverflowCheck(was_enabled);
+  return res;
+}
+
+/* Sprawdza, czy PolyEvalBatch i PolyProgramEvalBatch dają te same wyniki
+ * i zgłaszają te same przepełnienia co PolyEval i PolyProgramEval. */
+static bool TestCheckedBatch(const Poly *p, size_t k, size_t n_points,
+                             const poly_coeff_t xs[]) {
+  bool res = true;
+  poly_coeff_t *out = calloc(n_points, sizeof (poly_coeff_t));
+  poly_coeff_t *expected = calloc(n_points, sizeof (poly_coeff_t));
+  CHECK_PTR(out);
+  CHECK_PTR(expected);
+  PolyProgram prog = PolyProgramCompile(p);
+  for (int use_prog = 0; use_prog < 2; ++use_prog) {
+    PolyOverflowClear();
+    for (size_t i = 0; i < n_points; ++i)
+      expected[i] = use_prog ? PolyProgramEval(&prog, k, xs + i * k)
+                             : PolyEval(p, k, xs + i * k);
+    PolyOverflowStats stats = PolyOverflowGetStats();
+    res &= stats.coeffs > 0;
+    PolyOverflowClear();
+    if (use_prog)
+      PolyProgramEvalBatch(&prog, k, n_points, xs, out);
+    else
+      PolyEvalBatch(p, k, n_points, xs, out);
+    res &= OverflowStatsEq(stats.coeffs, stats.exps);
+    for (size_t i = 0; i < n_points; ++i)
+      res &= out[i] == expected[i];
+  }
+  PolyProgramDestroy(&prog);
+  free(out);
+  free(expected);
+  return res;
+}
+
+static bool OverflowModesTest(void) {
+  bool res = true;
+  bool was_enabled = PolyGetOverflowCheck();
+  size_t threads = PolyGetThreads();
+  PolySetOverflowCheck(true);
+
+  // przerwana funkcja PolyTry... nie zostawia wyłączonego sprawdzania,
+  // także gdy przerwie iloczyn liczony bez sprawdzania
+  FailingAllocator a = {0, 0, false};
+  PolySetAllocator(FailingMalloc, FailingRealloc, FailingFree, &a);
+  rand_state = 26;
+  Poly p = RandPoly(2, 8, 20, 1000);
+  Poly q = RandPoly(2, 8, 20, 1000);
+  Poly max = C(LONG_MAX);
+  size_t failures = 0;
+  bool is_done = false;
+  for (size_t budget = 0; !is_done; ++budget) {
+    Poly prod = PolyZero();
+    a.budget = budget;
+    a.is_limited = true;
+    is_done = PolyTryMul(&p, &q, &prod);
+    a.is_limited = false;
+    failures += !is_done;
+    res &= PolyOverflowIsChecked();
+    PolyOverflowClear();
+    Poly sum = PolyAdd(&max, &max);
+    res &= OverflowStatsEq(1, 0);
+    PolyDestroy(&sum);
+    PolyDestroy(&prod);
+  }
+  res &= failures > 0;
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  res &= FailingAllocatorLive(&a) == 0;
+  PolySetAllocator(NULL, NULL, NULL, NULL);
+
+  // iloczyn, dla którego oszacowanie wyklucza przepełnienie, nic nie
+  // zgłasza, a po nim sprawdzanie działa dalej
+  for (size_t t = 1; t <= 3; t += 2) {
+    PolySetThreads(t);
+    rand_state = 26;
+    p = RandPoly(2, 40, 60, 1000);
+    q = RandPoly(2, 40, 60, 1000);
+    PolyOverflowClear();
+    Poly prod = PolyMul(&p, &q);
+    Poly sqr = PolyMul(&p, &p);
+    res &= OverflowStatsEq(0, 0) && PolyOverflowIsChecked();
+    Poly expected = NaiveMul(&p, &q);
+    Poly expected_sqr = NaiveMul(&p, &p);
+    res &= PolyIsEq(&prod, &expected) && PolyIsEq(&sqr, &expected_sqr);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+    PolyDestroy(&prod);
+    PolyDestroy(&sqr);
+    PolyDestroy(&expected);
+    PolyDestroy(&expected_sqr);
+  }
+
+  // wyliczanie w wielu punktach sprawdza przepełnienia punkt po punkcie,
+  // także na kilku wątkach
+  const size_t k = 2;
+  const size_t n_points = EVAL_PAR_MIN_POINTS + 3;
+  poly_coeff_t *xs = calloc(k * n_points, sizeof (poly_coeff_t));
+  CHECK_PTR(xs);
+  for (size_t i = 0; i < k * n_points; ++i)
+    xs[i] = i % 3 == 0 ? (poly_coeff_t)(RandNext() << 33 ^ RandNext())
+                       : (poly_coeff_t)(RandNext() % 7) - 3;
+  p = RandPoly(2, 6, 40, LONG_MAX / 2);
+  for (size_t t = 1; t <= 3; t += 2) {
+    PolySetThreads(t);
+    res &= TestCheckedBatch(&p, k, n_points, xs);
+  }
+  PolyDestroy(&p);
+  free(xs);
+
+  PolySetThreads(threads);
+  PolyOverflowClear();
+  PolySetOverflowCheck(was_enabled);
+  return res;
+}
+
 /** GRUPY TESTÓW **/
 
 static bool SimpleNegGroup(void) {
@@ -4226,7 +5780,35 @@ static const test_list_t test_list[] = {
   TEST(PolyFromMonosMainTest),
   TEST(PolyFromMonosZeroTest),
   TEST(PolyFromMonosExampleGroup),
-  TEST(PolyFromMonosFinalTest)
+  TEST(PolyFromMonosFinalTest),
+  TEST(MulHeapTest),
+  TEST(AddToMergeTest),
+  TEST(AddToGallopTest),
+  TEST(AddToNoRegrowTest),
+  TEST(AddMonoToTest),
+  TEST(AccumulatorTest),
+  TEST(MonosSortTest),
+  TEST(MulDenseTest),
+  TEST(MulKroneckerTest),
+  TEST(MulParallelTest),
+  TEST(SqrTest),
+  TEST(MulAddToTest),
+  TEST(CalcMulAddTest),
+  TEST(ArenaTest),
+  TEST(MonosPoolStatsTest),
+  TEST(AddAllocsTest),
+  TEST(AllocatorTest),
+  TEST(CowTest),
+  TEST(OwnMonosCowTest),
+  TEST(InternTest),
+  TEST(CacheTest),
+  TEST(SizeofTest),
+  TEST(EvalTest),
+  TEST(EvalBatchTest),
+  TEST(ProgramTest),
+  TEST(EmitCTest),
+  TEST(OverflowCheckTest),
+  TEST(OverflowModesTest)
 };
 
 int main(int argc, char *argv[]) {